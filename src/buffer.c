@@ -1,4 +1,557 @@
 #include "buffer.h"
+#include "lz.h"
+#include "clock.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/* Configuración global del volcado a disco */
+static int spill_mem_lines = 0;         /* 0 = volcado desactivado */
+static char spill_dir[700] = "";
+static int next_buffer_id = 0;
+
+/* Eliminar el contenido de un directorio (sin recursión) y el propio directorio */
+static void remove_dir(const char *path) {
+    DIR *dir = opendir(path);
+    if (dir) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] == '.') continue;
+            char file[1024];
+            snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+            unlink(file);
+        }
+        closedir(dir);
+    }
+    rmdir(path);
+}
+
+/* Inicializar el directorio de volcado
+ * Los segmentos se guardan en $XDG_CACHE_HOME/ircchat/scrollback-<pid>/
+ * (o ~/.cache/ircchat/...). Se eliminan los directorios de procesos
+ * que ya no existen (restos de una sesión anterior terminada de golpe).
+ */
+void buffer_spill_init(int mem_lines) {
+    spill_mem_lines = 0;
+    spill_dir[0] = '\0';
+    if (mem_lines <= 0) return;
+
+    char cache_dir[512];
+    const char *cache = getenv("XDG_CACHE_HOME");
+    if (cache && cache[0] != '\0') {
+        snprintf(cache_dir, sizeof(cache_dir), "%s", cache);
+    } else {
+        const char *home = getenv("HOME");
+        if (!home) return;
+        snprintf(cache_dir, sizeof(cache_dir), "%s/.cache", home);
+    }
+    mkdir(cache_dir, 0700);
+
+    char base[600];
+    snprintf(base, sizeof(base), "%s/ircchat", cache_dir);
+    mkdir(base, 0700);
+
+    /* Limpiar directorios huérfanos de otras sesiones */
+    DIR *dir = opendir(base);
+    if (dir) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            int pid = 0;
+            if (sscanf(entry->d_name, "scrollback-%d", &pid) == 1 && pid > 0 &&
+                kill(pid, 0) == -1 && errno == ESRCH) {
+                char stale[1024];
+                snprintf(stale, sizeof(stale), "%s/%s", base, entry->d_name);
+                remove_dir(stale);
+            }
+        }
+        closedir(dir);
+    }
+
+    snprintf(spill_dir, sizeof(spill_dir), "%s/scrollback-%d", base, (int)getpid());
+    if (mkdir(spill_dir, 0700) == -1 && errno != EEXIST) {
+        spill_dir[0] = '\0';
+        return;
+    }
+
+    spill_mem_lines = mem_lines;
+}
+
+/* Eliminar el directorio de volcado al salir */
+void buffer_spill_shutdown(void) {
+    if (spill_dir[0] != '\0') {
+        remove_dir(spill_dir);
+    }
+    spill_dir[0] = '\0';
+    spill_mem_lines = 0;
+}
+
+/* Ruta del archivo de un segmento */
+static void segment_path(const MessageBuffer *buf, int seg_index, char *path, size_t size) {
+    snprintf(path, size, "%s/buf%d-%d.seg", spill_dir, buf->id, seg_index);
+}
+
+/* Liberar todos los segmentos de un buffer y borrar sus archivos */
+static void spill_release(MessageBuffer *buf) {
+    if (buf->spill_file) {
+        fclose(buf->spill_file);
+        buf->spill_file = NULL;
+    }
+
+    for (int i = 0; i < buf->segment_count; i++) {
+        SpillSegment *seg = &buf->segments[i];
+        if (seg->map) {
+            munmap(seg->map, seg->map_len);
+        }
+        free(seg->offsets);
+
+        char path[1024];
+        segment_path(buf, i, path, sizeof(path));
+        unlink(path);
+    }
+
+    free(buf->segments);
+    buf->segments = NULL;
+    buf->segment_count = 0;
+    buf->segment_capacity = 0;
+    buf->spilled = 0;
+}
+
+/* Obtener el segmento donde escribir, abriendo uno nuevo si el actual está lleno */
+static SpillSegment* spill_current_segment(MessageBuffer *buf) {
+    if (buf->segment_count > 0 && buf->spill_file) {
+        SpillSegment *last = &buf->segments[buf->segment_count - 1];
+        if (last->line_count < SPILL_SEGMENT_LINES) {
+            return last;
+        }
+        fclose(buf->spill_file);
+        buf->spill_file = NULL;
+    }
+
+    if (buf->segment_count == buf->segment_capacity) {
+        int new_capacity = buf->segment_capacity ? buf->segment_capacity * 2 : 8;
+        SpillSegment *segments = realloc(buf->segments, sizeof(SpillSegment) * new_capacity);
+        if (!segments) return NULL;
+        buf->segments = segments;
+        buf->segment_capacity = new_capacity;
+    }
+
+    char path[1024];
+    segment_path(buf, buf->segment_count, path, sizeof(path));
+    buf->spill_file = fopen(path, "wb");
+    if (!buf->spill_file) return NULL;
+
+    SpillSegment *seg = &buf->segments[buf->segment_count];
+    seg->offsets = malloc(sizeof(uint32_t) * SPILL_SEGMENT_LINES);
+    if (!seg->offsets) {
+        fclose(buf->spill_file);
+        buf->spill_file = NULL;
+        unlink(path);
+        return NULL;
+    }
+    seg->first_line = buf->spilled;
+    seg->line_count = 0;
+    seg->size = 0;
+    seg->map = NULL;
+    seg->map_len = 0;
+    seg->last_used = 0;
+    buf->segment_count++;
+
+    return seg;
+}
+
+/* Escribir una línea en el segmento actual
+ * Cada línea se escribe con su '\0' final para que el mapeo
+ * pueda devolverse directamente como cadena C.
+ */
+static bool spill_write_line(MessageBuffer *buf, const char *line, size_t len) {
+    SpillSegment *seg = spill_current_segment(buf);
+    if (!seg || fwrite(line, 1, len + 1, buf->spill_file) != len + 1) {
+        buf->spill_enabled = false;
+        return false;
+    }
+
+    seg->offsets[seg->line_count++] = (uint32_t)seg->size;
+    seg->size += len + 1;
+    buf->spilled++;
+    return true;
+}
+
+/* Liberar un slot de la caché de bloques */
+static void block_cache_release(BlockCacheSlot *slot) {
+    if (slot->owned) {
+        free(slot->raw);
+    }
+    slot->raw = NULL;
+    slot->owned = false;
+    slot->first_line = -1;
+}
+
+/* Liberar todos los bloques fríos y la caché de bloques */
+static void cold_release(MessageBuffer *buf) {
+    for (int i = 0; i < BLOCK_CACHE_SLOTS; i++) {
+        block_cache_release(&buf->cache[i]);
+    }
+    for (int i = 0; i < buf->block_count; i++) {
+        free(buf->blocks[i].data);
+    }
+
+    free(buf->blocks);
+    buf->blocks = NULL;
+    buf->block_count = 0;
+    buf->block_capacity = 0;
+    buf->cold_lines = 0;
+    buf->pending_blocks = 0;
+}
+
+/* Invalidar el slot de caché de un bloque (si está cacheado) */
+static void block_cache_invalidate(MessageBuffer *buf, int first_line) {
+    for (int i = 0; i < BLOCK_CACHE_SLOTS; i++) {
+        if (buf->cache[i].first_line == first_line) {
+            block_cache_release(&buf->cache[i]);
+        }
+    }
+}
+
+/* Obtener un bloque descomprimido desde la caché LRU, cargándolo si hace falta */
+static BlockCacheSlot* block_cache_get(MessageBuffer *buf, int block_index) {
+    ColdBlock *block = &buf->blocks[block_index];
+    BlockCacheSlot *victim = NULL;
+
+    for (int i = 0; i < BLOCK_CACHE_SLOTS; i++) {
+        BlockCacheSlot *slot = &buf->cache[i];
+        if (slot->first_line == block->first_line) {
+            slot->last_used = ++buf->cache_clock;
+            return slot;
+        }
+        if (!victim || (victim->first_line != -1 &&
+                        (slot->first_line == -1 || slot->last_used < victim->last_used))) {
+            victim = slot;
+        }
+    }
+
+    block_cache_release(victim);
+
+    if (block->state == BLOCK_COMPRESSED) {
+        victim->raw = malloc(block->raw_size);
+        if (!victim->raw) return NULL;
+        if (!lz_decompress(block->data, block->stored_size,
+                           (unsigned char *)victim->raw, block->raw_size)) {
+            free(victim->raw);
+            victim->raw = NULL;
+            return NULL;
+        }
+        victim->owned = true;
+    } else {
+        /* Bloque sin comprimir: usar sus datos directamente */
+        victim->raw = (char *)block->data;
+        victim->owned = false;
+    }
+
+    uint32_t pos = 0;
+    for (int i = 0; i < block->line_count; i++) {
+        victim->offsets[i] = pos;
+        pos += strlen(victim->raw + pos) + 1;
+    }
+
+    victim->first_line = block->first_line;
+    victim->last_used = ++buf->cache_clock;
+    return victim;
+}
+
+/* Sellar las BLOCK_LINES líneas más antiguas de la lista en un bloque frío
+ * Solo se sella si quedan BUFFER_HOT_LINES líneas recientes sin comprimir
+ * y el bloque queda fuera de la región visible (con margen).
+ */
+static bool seal_oldest_block(MessageBuffer *buf) {
+    if (!buf->enabled || buf->mem_count < BUFFER_HOT_LINES + BLOCK_LINES) return false;
+
+    int base = buf->spilled + buf->cold_lines;
+    int view_start = buf->count - 1 - buf->view_offset - BUFFER_VIEW_MARGIN;
+    if (base + BLOCK_LINES - 1 >= view_start) return false;
+
+    if (buf->block_count == buf->block_capacity) {
+        int new_capacity = buf->block_capacity ? buf->block_capacity * 2 : 16;
+        ColdBlock *blocks = realloc(buf->blocks, sizeof(ColdBlock) * new_capacity);
+        if (!blocks) return false;
+        buf->blocks = blocks;
+        buf->block_capacity = new_capacity;
+    }
+
+    /* Calcular tamaño y concatenar las líneas */
+    size_t raw_size = 0;
+    MessageNode *node = buf->head;
+    for (int i = 0; i < BLOCK_LINES; i++) {
+        raw_size += strlen(node->message) + 1;
+        node = node->next;
+    }
+
+    unsigned char *data = malloc(raw_size);
+    if (!data) return false;
+
+    size_t pos = 0;
+    node = buf->head;
+    for (int i = 0; i < BLOCK_LINES; i++) {
+        size_t len = strlen(node->message) + 1;
+        memcpy(data + pos, node->message, len);
+        pos += len;
+
+        MessageNode *next = node->next;
+        free(node->message);
+        free(node);
+        node = next;
+    }
+
+    buf->head = node;
+    buf->head->prev = NULL;
+    if (buf->hint_index < base + BLOCK_LINES) {
+        buf->hint_node = NULL;
+    }
+
+    ColdBlock *block = &buf->blocks[buf->block_count++];
+    block->first_line = base;
+    block->line_count = BLOCK_LINES;
+    block->state = BLOCK_PENDING;
+    block->raw_size = (uint32_t)raw_size;
+    block->stored_size = (uint32_t)raw_size;
+    block->data = data;
+
+    buf->mem_count -= BLOCK_LINES;
+    buf->mem_bytes -= raw_size - BLOCK_LINES;
+    buf->cold_lines += BLOCK_LINES;
+    buf->pending_blocks++;
+    return true;
+}
+
+/* Volcar a disco el bloque frío más antiguo */
+static bool spill_oldest_block(MessageBuffer *buf) {
+    ColdBlock *block = &buf->blocks[0];
+
+    char *raw = (char *)block->data;
+    bool allocated = false;
+    if (block->state == BLOCK_COMPRESSED) {
+        raw = malloc(block->raw_size);
+        if (!raw) return false;
+        allocated = true;
+        if (!lz_decompress(block->data, block->stored_size, (unsigned char *)raw, block->raw_size)) {
+            free(raw);
+            buf->spill_enabled = false;
+            return false;
+        }
+    }
+
+    block_cache_invalidate(buf, block->first_line);
+
+    size_t pos = 0;
+    int written = 0;
+    while (written < block->line_count) {
+        size_t len = strlen(raw + pos);
+        if (!spill_write_line(buf, raw + pos, len)) break;
+        pos += len + 1;
+        written++;
+    }
+
+    if (written < block->line_count) {
+        /* Error de escritura: el resto del bloque se queda en memoria sin comprimir */
+        if (written > 0) {
+            unsigned char *rest = malloc(block->raw_size - pos);
+            if (rest) {
+                memcpy(rest, raw + pos, block->raw_size - pos);
+                if (block->state != BLOCK_PENDING) buf->pending_blocks++;
+                free(block->data);
+                block->data = rest;
+                block->state = BLOCK_PENDING;
+                block->first_line += written;
+                block->line_count -= written;
+                block->raw_size -= (uint32_t)pos;
+                block->stored_size = block->raw_size;
+                buf->cold_lines -= written;
+            }
+        }
+        if (allocated) free(raw);
+        return false;
+    }
+
+    if (allocated) free(raw);
+    if (block->state == BLOCK_PENDING) buf->pending_blocks--;
+    free(block->data);
+
+    buf->cold_lines -= block->line_count;
+    buf->block_count--;
+    memmove(&buf->blocks[0], &buf->blocks[1], sizeof(ColdBlock) * buf->block_count);
+    return true;
+}
+
+/* Volcar a disco el mensaje más antiguo de la lista en memoria */
+static bool spill_oldest_node(MessageBuffer *buf) {
+    MessageNode *node = buf->head;
+    if (!node || node == buf->tail) return false;
+
+    size_t len = strlen(node->message);
+    if (!spill_write_line(buf, node->message, len)) return false;
+
+    /* Quitar el nodo de la lista en memoria */
+    buf->head = node->next;
+    buf->head->prev = NULL;
+    if (buf->hint_node == node) {
+        buf->hint_node = NULL;
+    }
+    free(node->message);
+    free(node);
+
+    buf->mem_count--;
+    buf->mem_bytes -= len;
+    return true;
+}
+
+/* Volcar a disco lo más antiguo que haya en memoria (bloques fríos primero) */
+static bool spill_oldest(MessageBuffer *buf) {
+    if (buf->block_count > 0) {
+        return spill_oldest_block(buf);
+    }
+    return spill_oldest_node(buf);
+}
+
+/* Asegurar que un segmento está mapeado y cubre hasta end_offset */
+static bool spill_map_segment(MessageBuffer *buf, int seg_index, size_t end_offset) {
+    SpillSegment *seg = &buf->segments[seg_index];
+
+    if (seg->map && seg->map_len >= end_offset) {
+        seg->last_used = ++buf->map_clock;
+        return true;
+    }
+
+    /* El segmento en escritura puede tener datos aún en el buffer de stdio */
+    if (seg_index == buf->segment_count - 1 && buf->spill_file) {
+        fflush(buf->spill_file);
+    }
+
+    if (seg->map) {
+        munmap(seg->map, seg->map_len);
+        seg->map = NULL;
+        seg->map_len = 0;
+    }
+
+    /* Liberar el mapeo menos usado si se alcanzó el máximo */
+    int mapped = 0;
+    int lru = -1;
+    for (int i = 0; i < buf->segment_count; i++) {
+        if (!buf->segments[i].map) continue;
+        mapped++;
+        if (lru == -1 || buf->segments[i].last_used < buf->segments[lru].last_used) {
+            lru = i;
+        }
+    }
+    if (mapped >= SPILL_MAX_MAPPED && lru != -1) {
+        munmap(buf->segments[lru].map, buf->segments[lru].map_len);
+        buf->segments[lru].map = NULL;
+        buf->segments[lru].map_len = 0;
+    }
+
+    char path[1024];
+    segment_path(buf, seg_index, path, sizeof(path));
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return false;
+
+    void *map = mmap(NULL, seg->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    seg->map = map;
+    seg->map_len = seg->size;
+    seg->last_used = ++buf->map_clock;
+    return true;
+}
+
+/* Obtener una línea volcada a disco */
+static const char* spill_get_line(MessageBuffer *buf, int index) {
+    /* Búsqueda binaria del segmento que contiene el índice */
+    int lo = 0;
+    int hi = buf->segment_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (buf->segments[mid].first_line <= index) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    SpillSegment *seg = &buf->segments[lo];
+    int line = index - seg->first_line;
+    if (line < 0 || line >= seg->line_count) return NULL;
+
+    size_t end = (line + 1 < seg->line_count) ? seg->offsets[line + 1] : seg->size;
+    if (!spill_map_segment(buf, lo, end)) return NULL;
+
+    return seg->map + seg->offsets[line];
+}
+
+/* Quitar secuencias ANSI de una línea
+ * Si map no es NULL, map[i] guarda el offset en src del carácter i de dst.
+ * Devuelve la longitud de dst.
+ */
+static size_t search_strip(const char *src, char *dst, size_t size, int *map) {
+    size_t len = 0;
+    int i = 0;
+
+    while (src[i] != '\0' && len + 1 < size) {
+        if (src[i] == '\033' && src[i + 1] == '[') {
+            /* Saltar parámetros hasta el byte final (0x40-0x7E) */
+            i += 2;
+            while (src[i] != '\0' && !(src[i] >= 0x40 && src[i] <= 0x7E)) i++;
+            if (src[i] != '\0') i++;
+            continue;
+        }
+        if (map) map[len] = i;
+        dst[len++] = src[i++];
+    }
+    if (map) map[len] = i;
+
+    dst[len] = '\0';
+    return len;
+}
+
+/* Bit de la firma correspondiente a un trigrama (sin distinguir mayúsculas) */
+static uint32_t search_trigram_bit(const char *p) {
+    uint32_t tri = ((uint32_t)tolower((unsigned char)p[0]) << 16) |
+                   ((uint32_t)tolower((unsigned char)p[1]) << 8) |
+                   (uint32_t)tolower((unsigned char)p[2]);
+    return (tri * 2654435761u) >> 19 & (SEARCH_CHUNK_BITS - 1);
+}
+
+/* Añadir los trigramas de una línea a la firma de su bloque */
+static void search_index_line(MessageBuffer *buf, int index, const char *msg) {
+    int chunk = index / SEARCH_CHUNK_LINES;
+
+    while (chunk >= buf->search_chunks) {
+        if (buf->search_chunks == buf->search_capacity) {
+            int new_capacity = buf->search_capacity ? buf->search_capacity * 2 : 16;
+            uint64_t *bits = realloc(buf->search_bits,
+                                     sizeof(uint64_t) * SEARCH_CHUNK_WORDS * new_capacity);
+            if (!bits) return;
+            buf->search_bits = bits;
+            buf->search_capacity = new_capacity;
+        }
+        memset(buf->search_bits + (size_t)buf->search_chunks * SEARCH_CHUNK_WORDS, 0,
+               sizeof(uint64_t) * SEARCH_CHUNK_WORDS);
+        buf->search_chunks++;
+    }
+
+    char text[MAX_MSG_LEN * 2];
+    size_t len = search_strip(msg, text, sizeof(text), NULL);
+    uint64_t *sig = buf->search_bits + (size_t)chunk * SEARCH_CHUNK_WORDS;
+
+    for (size_t i = 0; i + 3 <= len; i++) {
+        uint32_t bit = search_trigram_bit(text + i);
+        sig[bit / 64] |= (uint64_t)1 << (bit % 64);
+    }
+}
 
 /* Crear un nuevo buffer de mensajes */
 MessageBuffer* buffer_create(void) {
@@ -7,10 +560,39 @@ MessageBuffer* buffer_create(void) {
 
     buf->head = NULL;
     buf->tail = NULL;
-    buf->current_view = NULL;
     buf->count = 0;
     buf->view_offset = 0;
     buf->enabled = true;
+    buf->spill_enabled = (spill_mem_lines > 0);
+    buf->id = next_buffer_id++;
+    buf->mem_count = 0;
+    buf->mem_bytes = 0;
+    buf->spilled = 0;
+    buf->segments = NULL;
+    buf->segment_count = 0;
+    buf->segment_capacity = 0;
+    buf->spill_file = NULL;
+    buf->map_clock = 0;
+    buf->blocks = NULL;
+    buf->block_count = 0;
+    buf->block_capacity = 0;
+    buf->cold_lines = 0;
+    buf->pending_blocks = 0;
+    for (int i = 0; i < BLOCK_CACHE_SLOTS; i++) {
+        buf->cache[i].first_line = -1;
+        buf->cache[i].raw = NULL;
+        buf->cache[i].owned = false;
+        buf->cache[i].last_used = 0;
+    }
+    buf->cache_clock = 0;
+    buf->search_bits = NULL;
+    buf->search_chunks = 0;
+    buf->search_capacity = 0;
+    buf->time_marks = NULL;
+    buf->time_mark_count = 0;
+    buf->time_mark_capacity = 0;
+    buf->hint_node = NULL;
+    buf->hint_index = 0;
 
     return buf;
 }
@@ -27,11 +609,45 @@ void buffer_destroy(MessageBuffer *buf) {
         current = next;
     }
 
+    cold_release(buf);
+    spill_release(buf);
+    free(buf->search_bits);
+    free(buf->time_marks);
     free(buf);
 }
 
+/* Registrar en el índice temporal la línea index recibida en when
+ * Solo se añade una marca cuando cambia el minuto; un reloj que retrocede
+ * no genera marcas para mantener el índice ordenado.
+ */
+static void time_index_line(MessageBuffer *buf, int index, time_t when) {
+    time_t minute = when - (when % 60);
+
+    if (buf->time_mark_count > 0 &&
+        buf->time_marks[buf->time_mark_count - 1].minute >= minute) {
+        return;
+    }
+
+    if (buf->time_mark_count == buf->time_mark_capacity) {
+        int new_capacity = buf->time_mark_capacity ? buf->time_mark_capacity * 2 : 64;
+        TimeMark *marks = realloc(buf->time_marks, sizeof(TimeMark) * new_capacity);
+        if (!marks) return;
+        buf->time_marks = marks;
+        buf->time_mark_capacity = new_capacity;
+    }
+
+    buf->time_marks[buf->time_mark_count].minute = minute;
+    buf->time_marks[buf->time_mark_count].first_line = index;
+    buf->time_mark_count++;
+}
+
 /* Añadir un mensaje al buffer */
 void buffer_add_message(MessageBuffer *buf, const char *msg) {
+    buffer_add_message_at(buf, msg, clock_now());
+}
+
+/* Añadir un mensaje recibido en un instante dado */
+void buffer_add_message_at(MessageBuffer *buf, const char *msg, time_t when) {
     if (!buf || !msg) return;
 
     if (!buf->enabled) {
@@ -47,6 +663,7 @@ void buffer_add_message(MessageBuffer *buf, const char *msg) {
             node->prev = NULL;
             buf->head = buf->tail = node;
             buf->count = 1;
+            buf->mem_count = 1;
         }
         return;
     }
@@ -66,10 +683,23 @@ void buffer_add_message(MessageBuffer *buf, const char *msg) {
 
     buf->tail = node;
     buf->count++;
+    buf->mem_count++;
+    buf->mem_bytes += strlen(msg);
+
+    search_index_line(buf, buf->count - 1, msg);
+    time_index_line(buf, buf->count - 1, when);
+
+    /* Si estamos navegando, mantener la vista anclada en el mismo mensaje */
+    if (buf->view_offset > 0) {
+        buf->view_offset++;
+    }
+
+    /* Sellar líneas antiguas en bloques fríos (se comprimen después en buffer_compact) */
+    while (seal_oldest_block(buf));
 
-    /* Si no estamos navegando (view_offset == 0), mantener la vista al final */
-    if (buf->view_offset == 0 || !buf->current_view) {
-        buf->current_view = buf->tail;
+    /* Volcar a disco los mensajes más antiguos si se supera el umbral */
+    while (buf->spill_enabled && buf->mem_count + buf->cold_lines > spill_mem_lines) {
+        if (!spill_oldest(buf)) break;
     }
 }
 
@@ -85,19 +715,35 @@ void buffer_clear(MessageBuffer *buf) {
         current = next;
     }
 
+    cold_release(buf);
+    spill_release(buf);
+
+    free(buf->search_bits);
+    buf->search_bits = NULL;
+    buf->search_chunks = 0;
+    buf->search_capacity = 0;
+
+    free(buf->time_marks);
+    buf->time_marks = NULL;
+    buf->time_mark_count = 0;
+    buf->time_mark_capacity = 0;
+
     buf->head = NULL;
     buf->tail = NULL;
-    buf->current_view = NULL;
     buf->count = 0;
+    buf->mem_count = 0;
+    buf->mem_bytes = 0;
     buf->view_offset = 0;
+    buf->hint_node = NULL;
+    buf->hint_index = 0;
+    buf->spill_enabled = (spill_mem_lines > 0);
 }
 
 /* Scroll hacia arriba (mensajes más antiguos) */
 void buffer_scroll_up(MessageBuffer *buf) {
     if (!buf || !buf->enabled) return;
 
-    if (buf->current_view && buf->current_view->prev) {
-        buf->current_view = buf->current_view->prev;
+    if (buf->view_offset < buf->count - 1) {
         buf->view_offset++;
     }
 }
@@ -106,10 +752,8 @@ void buffer_scroll_up(MessageBuffer *buf) {
 void buffer_scroll_down(MessageBuffer *buf) {
     if (!buf || !buf->enabled) return;
 
-    if (buf->current_view && buf->current_view->next) {
-        buf->current_view = buf->current_view->next;
+    if (buf->view_offset > 0) {
         buf->view_offset--;
-        if (buf->view_offset < 0) buf->view_offset = 0;
     }
 }
 
@@ -117,7 +761,6 @@ void buffer_scroll_down(MessageBuffer *buf) {
 void buffer_scroll_top(MessageBuffer *buf) {
     if (!buf || !buf->enabled) return;
 
-    buf->current_view = buf->head;
     buf->view_offset = buf->count > 0 ? buf->count - 1 : 0;
 }
 
@@ -125,57 +768,267 @@ void buffer_scroll_top(MessageBuffer *buf) {
 void buffer_scroll_bottom(MessageBuffer *buf) {
     if (!buf || !buf->enabled) return;
 
-    buf->current_view = buf->tail;
     buf->view_offset = 0;
 }
 
-/* Obtener mensajes visibles para renderizar */
-char** buffer_get_visible_messages(MessageBuffer *buf, int max_messages, int *count) {
-    if (!buf) {
-        *count = 0;
-        return NULL;
+/* Obtener una línea de un bloque frío */
+static const char* cold_get_line(MessageBuffer *buf, int index) {
+    /* Búsqueda binaria del bloque que contiene el índice */
+    int lo = 0;
+    int hi = buf->block_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (buf->blocks[mid].first_line <= index) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
     }
 
-    *count = 0;
+    ColdBlock *block = &buf->blocks[lo];
+    int line = index - block->first_line;
+    if (line < 0 || line >= block->line_count) return NULL;
 
-    if (buf->count == 0) {
-        return NULL;
+    BlockCacheSlot *slot = block_cache_get(buf, lo);
+    if (!slot) return NULL;
+
+    return slot->raw + slot->offsets[line];
+}
+
+/* Obtener un mensaje por índice global (0 = más antiguo)
+ * Las líneas volcadas a disco se leen del segmento mapeado y las de
+ * bloques fríos de la caché de bloques descomprimidos; el puntero es
+ * válido hasta la siguiente llamada que modifique o lea el buffer.
+ */
+const char* buffer_get_line(MessageBuffer *buf, int index) {
+    if (!buf || index < 0 || index >= buf->count) return NULL;
+
+    if (index < buf->spilled) {
+        return spill_get_line(buf, index);
     }
 
-    /* Allocar array para máximo de mensajes */
-    int alloc_size = (max_messages < buf->count) ? max_messages : buf->count;
-    char **messages = malloc(sizeof(char*) * alloc_size);
-    if (!messages) return NULL;
+    int hot_base = buf->spilled + buf->cold_lines;
+    if (index < hot_base) {
+        return cold_get_line(buf, index);
+    }
 
-    /* Determinar punto final: current_view si estamos navegando, tail si no */
-    MessageNode *end_node = buf->current_view ? buf->current_view : buf->tail;
-    if (!end_node) {
-        free(messages);
-        return NULL;
+    /* Elegir el punto de partida más cercano: head, tail o último acceso */
+    MessageNode *node = buf->head;
+    int pos = hot_base;
+
+    if (buf->count - 1 - index < index - pos) {
+        node = buf->tail;
+        pos = buf->count - 1;
+    }
+    if (buf->hint_node && abs(buf->hint_index - index) < abs(pos - index)) {
+        node = buf->hint_node;
+        pos = buf->hint_index;
     }
 
-    /* Retroceder desde end_node para encontrar el punto inicial */
-    MessageNode *start_node = end_node;
-    int available = 1;
+    while (node && pos < index) {
+        node = node->next;
+        pos++;
+    }
+    while (node && pos > index) {
+        node = node->prev;
+        pos--;
+    }
+    if (!node) return NULL;
+
+    buf->hint_node = node;
+    buf->hint_index = index;
+    return node->message;
+}
+
+/* Comprimir hasta max_blocks bloques pendientes
+ * Pensado para llamarse desde el bucle principal en pequeñas dosis,
+ * de modo que la compresión nunca bloquee la interfaz.
+ * Devuelve el número de bloques procesados.
+ */
+int buffer_compact(MessageBuffer *buf, int max_blocks) {
+    if (!buf) return 0;
+
+    /* Sellar lo que quedó pendiente mientras la vista estaba encima */
+    while (seal_oldest_block(buf));
+
+    int done = 0;
+    for (int i = 0; i < buf->block_count && done < max_blocks && buf->pending_blocks > 0; i++) {
+        ColdBlock *block = &buf->blocks[i];
+        if (block->state != BLOCK_PENDING) continue;
 
-    MessageNode *temp = end_node->prev;
-    while (temp && available < alloc_size) {
-        start_node = temp;
-        available++;
-        temp = temp->prev;
+        size_t bound = lz_compress_bound(block->raw_size);
+        unsigned char *out = malloc(bound);
+        size_t size = out ? lz_compress(block->data, block->raw_size, out, bound) : 0;
+
+        if (size > 0 && size < block->raw_size) {
+            unsigned char *shrunk = realloc(out, size);
+            if (shrunk) out = shrunk;
+
+            /* Si el bloque estaba en la caché, el slot se queda con el texto original */
+            bool cached = false;
+            for (int j = 0; j < BLOCK_CACHE_SLOTS; j++) {
+                if (buf->cache[j].first_line == block->first_line) {
+                    buf->cache[j].owned = true;
+                    cached = true;
+                }
+            }
+            if (!cached) {
+                free(block->data);
+            }
+
+            block->data = out;
+            block->stored_size = (uint32_t)size;
+            block->state = BLOCK_COMPRESSED;
+        } else {
+            free(out);
+            block->state = BLOCK_STORED;
+        }
+
+        buf->pending_blocks--;
+        done++;
     }
 
-    /* Llenar el array en orden desde start_node hasta end_node (inclusive) */
-    temp = start_node;
-    while (temp) {
-        if (*count >= alloc_size) break;
+    return done;
+}
+
+/* Obtener estadísticas de memoria del buffer */
+void buffer_get_stats(MessageBuffer *buf, BufferStats *stats) {
+    memset(stats, 0, sizeof(BufferStats));
+    if (!buf) return;
+
+    stats->total_lines = buf->count;
+    stats->hot_lines = buf->mem_count;
+    stats->cold_lines = buf->cold_lines;
+    stats->spilled_lines = buf->spilled;
+    stats->blocks = buf->block_count;
+    stats->pending_blocks = buf->pending_blocks;
+    stats->hot_bytes = buf->mem_bytes;
+
+    for (int i = 0; i < buf->block_count; i++) {
+        stats->cold_raw_bytes += buf->blocks[i].raw_size;
+        stats->cold_stored_bytes += buf->blocks[i].stored_size;
+    }
+    for (int i = 0; i < buf->segment_count; i++) {
+        stats->spilled_bytes += buf->segments[i].size;
+    }
+    stats->index_bytes = sizeof(uint64_t) * SEARCH_CHUNK_WORDS * (size_t)buf->search_capacity;
+}
 
-        messages[*count] = temp->message;
-        (*count)++;
+/* Primera línea recibida en el minuto de when o después
+ * Búsqueda binaria sobre el índice temporal; vale igual para líneas en
+ * memoria, comprimidas o volcadas a disco. Devuelve -1 si no hay ninguna.
+ */
+int buffer_find_time(MessageBuffer *buf, time_t when) {
+    if (!buf || buf->time_mark_count == 0) return -1;
 
-        if (temp == end_node) break;
-        temp = temp->next;
+    time_t minute = when - (when % 60);
+    int lo = 0;
+    int hi = buf->time_mark_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (buf->time_marks[mid].minute < minute) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo == buf->time_mark_count) return -1;
+    return buf->time_marks[lo].first_line;
+}
+
+/* Minuto en que se recibió una línea (0 si no se conoce) */
+time_t buffer_line_time(MessageBuffer *buf, int index) {
+    if (!buf || buf->time_mark_count == 0 || index < buf->time_marks[0].first_line) return 0;
+
+    int lo = 0;
+    int hi = buf->time_mark_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (buf->time_marks[mid].first_line <= index) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    return buf->time_marks[lo].minute;
+}
+
+/* Buscar una coincidencia en una línea
+ * Busca text (sin distinguir mayúsculas) o la regex en el texto visible de
+ * la línea. Si hay coincidencia, start/end son offsets de bytes en line
+ * (end exclusivo), para poder resaltar la coincidencia.
+ */
+bool buffer_match_span(const char *line, const char *text, const regex_t *regex, int *start, int *end) {
+    if (!line) return false;
+
+    char plain[MAX_MSG_LEN * 2];
+    int map[MAX_MSG_LEN * 2];
+    search_strip(line, plain, sizeof(plain), map);
+
+    int s, e;
+    if (regex) {
+        regmatch_t match;
+        if (regexec(regex, plain, 1, &match, 0) != 0) return false;
+        s = match.rm_so;
+        e = match.rm_eo;
+    } else {
+        if (!text || text[0] == '\0') return false;
+        const char *found = strcasestr(plain, text);
+        if (!found) return false;
+        s = found - plain;
+        e = s + strlen(text);
+    }
+
+    if (start) *start = map[s];
+    if (end) *end = (e > s) ? map[e - 1] + 1 : map[s];
+    return true;
+}
+
+/* Buscar hacia atrás la línea más reciente con índice <= from que coincida
+ * Con texto se descartan bloques enteros mirando su firma de trigramas, así
+ * que solo se leen (y descomprimen) los bloques candidatos. Con regex se
+ * recorre todo el buffer.
+ * Devuelve el índice global de la línea o -1 si no hay coincidencias.
+ */
+int buffer_search(MessageBuffer *buf, const char *text, const regex_t *regex, int from) {
+    if (!buf || (!regex && (!text || text[0] == '\0'))) return -1;
+    if (from >= buf->count) from = buf->count - 1;
+    if (from < 0) return -1;
+
+    /* Firma de la consulta */
+    uint64_t query[SEARCH_CHUNK_WORDS];
+    bool use_index = false;
+    if (!regex && buf->enabled && strlen(text) >= 3) {
+        memset(query, 0, sizeof(query));
+        for (size_t i = 0; i + 3 <= strlen(text); i++) {
+            uint32_t bit = search_trigram_bit(text + i);
+            query[bit / 64] |= (uint64_t)1 << (bit % 64);
+        }
+        use_index = true;
+    }
+
+    for (int chunk = from / SEARCH_CHUNK_LINES; chunk >= 0; chunk--) {
+        if (use_index && chunk < buf->search_chunks) {
+            const uint64_t *sig = buf->search_bits + (size_t)chunk * SEARCH_CHUNK_WORDS;
+            bool candidate = true;
+            for (int w = 0; w < SEARCH_CHUNK_WORDS && candidate; w++) {
+                candidate = (sig[w] & query[w]) == query[w];
+            }
+            if (!candidate) continue;
+        }
+
+        int first = chunk * SEARCH_CHUNK_LINES;
+        int last = first + SEARCH_CHUNK_LINES - 1;
+        if (last > from) last = from;
+
+        for (int i = last; i >= first; i--) {
+            if (buffer_match_span(buffer_get_line(buf, i), text, regex, NULL, NULL)) {
+                return i;
+            }
+        }
     }
 
-    return messages;
+    return -1;
 }
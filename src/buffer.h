@@ -2,6 +2,31 @@
 #define BUFFER_H
 
 #include "common.h"
+#include <stdint.h>
+#include <regex.h>
+#include <time.h>
+
+/* Volcado de scrollback a disco */
+#define SPILL_SEGMENT_LINES 4096        /* Líneas máximas por segmento */
+#define SPILL_MAX_MAPPED 4              /* Segmentos mapeados a la vez por buffer */
+#define DEFAULT_BUFFER_MEM_LINES 5000   /* Líneas en memoria antes de volcar */
+
+/* Bloques fríos comprimidos */
+#define BLOCK_LINES 128                 /* Líneas por bloque sellado */
+#define BUFFER_HOT_LINES 256            /* Líneas recientes que nunca se comprimen */
+#define BUFFER_VIEW_MARGIN 256          /* Margen alrededor de la vista que no se sella */
+#define BLOCK_CACHE_SLOTS 8             /* Bloques descomprimidos en la caché LRU */
+
+/* Índice de búsqueda por trigramas */
+#define SEARCH_CHUNK_LINES 64           /* Líneas por firma de trigramas */
+#define SEARCH_CHUNK_BITS 8192          /* Bits por firma (potencia de 2) */
+#define SEARCH_CHUNK_WORDS (SEARCH_CHUNK_BITS / 64)
+
+/* Marca del índice temporal: primera línea recibida en un minuto */
+typedef struct {
+    time_t minute;              /* Inicio del minuto (múltiplo de 60) */
+    int first_line;             /* Índice global de la primera línea de ese minuto */
+} TimeMark;
 
 /* Nodo de la lista de mensajes */
 typedef struct MessageNode {
@@ -10,25 +35,121 @@ typedef struct MessageNode {
     struct MessageNode *prev;
 } MessageNode;
 
+/* Segmento de scrollback volcado a disco (append-only) */
+typedef struct {
+    int first_line;             /* Índice global de la primera línea del segmento */
+    int line_count;
+    uint32_t *offsets;          /* Offset de cada línea dentro del archivo */
+    size_t size;                /* Bytes escritos en el archivo */
+    char *map;                  /* Mapeo en memoria (NULL si no está mapeado) */
+    size_t map_len;
+    unsigned long last_used;    /* Reloj LRU de mapeos */
+} SpillSegment;
+
+/* Estado de un bloque frío */
+typedef enum {
+    BLOCK_PENDING,              /* Sellado, pendiente de comprimir */
+    BLOCK_COMPRESSED,           /* Comprimido */
+    BLOCK_STORED                /* No compresible, guardado tal cual */
+} BlockState;
+
+/* Bloque de líneas antiguas sellado (líneas concatenadas con '\0') */
+typedef struct {
+    int first_line;             /* Índice global de la primera línea */
+    int line_count;
+    BlockState state;
+    uint32_t raw_size;          /* Tamaño sin comprimir */
+    uint32_t stored_size;       /* Tamaño ocupado en memoria */
+    unsigned char *data;
+} ColdBlock;
+
+/* Bloque descomprimido en la caché LRU */
+typedef struct {
+    int first_line;             /* -1 si el slot está libre */
+    char *raw;
+    bool owned;                 /* raw se liberó con malloc (bloque comprimido) */
+    uint32_t offsets[BLOCK_LINES];
+    unsigned long last_used;
+} BlockCacheSlot;
+
 /* Buffer de mensajes */
 typedef struct {
-    MessageNode *head;
+    MessageNode *head;          /* Mensaje más antiguo en memoria */
     MessageNode *tail;
-    MessageNode *current_view;  /* Para navegación con Ctrl-Arriba/Abajo */
-    int count;
+    int count;                  /* Total de mensajes (memoria + disco) */
     int view_offset;            /* Offset desde el final del buffer */
     bool enabled;               /* Buffer activado/desactivado */
+    /* Volcado a disco de mensajes antiguos */
+    bool spill_enabled;         /* Volcado activo para este buffer */
+    int id;                     /* Identificador para nombres de segmento */
+    int mem_count;              /* Mensajes en la lista en memoria (sin comprimir) */
+    size_t mem_bytes;           /* Bytes de texto en la lista en memoria */
+    int spilled;                /* Mensajes volcados a disco */
+    SpillSegment *segments;
+    int segment_count;
+    int segment_capacity;
+    FILE *spill_file;           /* Segmento abierto para escritura */
+    unsigned long map_clock;
+    /* Bloques fríos comprimidos (entre el volcado a disco y la lista) */
+    ColdBlock *blocks;
+    int block_count;
+    int block_capacity;
+    int cold_lines;             /* Líneas en bloques fríos */
+    int pending_blocks;         /* Bloques sellados sin comprimir */
+    BlockCacheSlot cache[BLOCK_CACHE_SLOTS];
+    unsigned long cache_clock;
+    /* Índice de búsqueda: una firma de trigramas por cada SEARCH_CHUNK_LINES líneas */
+    uint64_t *search_bits;
+    int search_chunks;
+    int search_capacity;
+    /* Índice temporal disperso (una marca por minuto con mensajes) */
+    TimeMark *time_marks;
+    int time_mark_count;
+    int time_mark_capacity;
+    /* Caché del último acceso por índice (acceso secuencial O(1)) */
+    MessageNode *hint_node;
+    int hint_index;
 } MessageBuffer;
 
+/* Estadísticas de memoria de un buffer */
+typedef struct {
+    int total_lines;
+    int hot_lines;
+    int cold_lines;
+    int spilled_lines;
+    int blocks;
+    int pending_blocks;
+    size_t hot_bytes;
+    size_t cold_raw_bytes;      /* Tamaño original de los bloques comprimidos */
+    size_t cold_stored_bytes;   /* Memoria ocupada por los bloques fríos */
+    size_t spilled_bytes;
+    size_t index_bytes;         /* Memoria del índice de búsqueda */
+} BufferStats;
+
 /* Funciones del buffer */
 MessageBuffer* buffer_create(void);
 void buffer_destroy(MessageBuffer *buf);
 void buffer_add_message(MessageBuffer *buf, const char *msg);
+void buffer_add_message_at(MessageBuffer *buf, const char *msg, time_t when);
 void buffer_clear(MessageBuffer *buf);
 void buffer_scroll_up(MessageBuffer *buf);
 void buffer_scroll_down(MessageBuffer *buf);
 void buffer_scroll_top(MessageBuffer *buf);
 void buffer_scroll_bottom(MessageBuffer *buf);
-char** buffer_get_visible_messages(MessageBuffer *buf, int max_lines, int *count);
+const char* buffer_get_line(MessageBuffer *buf, int index);
+int buffer_compact(MessageBuffer *buf, int max_blocks);
+void buffer_get_stats(MessageBuffer *buf, BufferStats *stats);
+
+/* Índice temporal */
+int buffer_find_time(MessageBuffer *buf, time_t when);
+time_t buffer_line_time(MessageBuffer *buf, int index);
+
+/* Búsqueda en el scrollback */
+int buffer_search(MessageBuffer *buf, const char *text, const regex_t *regex, int from);
+bool buffer_match_span(const char *line, const char *text, const regex_t *regex, int *start, int *end);
+
+/* Volcado a disco (global para todos los buffers) */
+void buffer_spill_init(int mem_lines);
+void buffer_spill_shutdown(void);
 
 #endif /* BUFFER_H */
@@ -0,0 +1,107 @@
+#include "clock.h"
+
+/* Formato cacheado y su última salida */
+typedef struct {
+    char format[CLOCK_FORMAT_LEN];
+    char text[CLOCK_STRING_LEN];
+    time_t last_used;           /* Para reutilizar el slot menos usado */
+} ClockSlot;
+
+static time_t clock_second = 0;         /* 0 = aún sin leer la hora */
+static struct tm clock_tm;
+static ClockSlot slots[CLOCK_MAX_FORMATS];
+static int slot_count = 0;
+
+/* Formatear la hora actual con el formato de un slot */
+static void clock_render(ClockSlot *slot) {
+    if (strftime(slot->text, sizeof(slot->text), slot->format, &clock_tm) == 0) {
+        slot->text[0] = '\0';
+    }
+}
+
+/* Leer la hora; si cambió el segundo, recalcular la hora local y las cadenas */
+time_t clock_update(void) {
+    time_t now = time(NULL);
+    if (now != clock_second) {
+        clock_second = now;
+        localtime_r(&now, &clock_tm);
+        for (int i = 0; i < slot_count; i++) {
+            clock_render(&slots[i]);
+        }
+    }
+    return now;
+}
+
+/* Hora de la vuelta actual del bucle */
+time_t clock_now(void) {
+    if (clock_second == 0) clock_update();
+    return clock_second;
+}
+
+/* Hora local de la vuelta actual del bucle */
+const struct tm* clock_local(void) {
+    if (clock_second == 0) clock_update();
+    return &clock_tm;
+}
+
+/* Hora actual con un formato strftime
+ * La primera vez que se pide un formato se le asigna un slot (reutilizando
+ * el menos usado si no quedan); después solo se devuelve la cadena cacheada.
+ */
+const char* clock_format(const char *format) {
+    if (!format) return "";
+    if (clock_second == 0) clock_update();
+
+    ClockSlot *slot = NULL;
+    for (int i = 0; i < slot_count; i++) {
+        if (strcmp(slots[i].format, format) == 0) {
+            slot = &slots[i];
+            break;
+        }
+    }
+
+    if (!slot) {
+        if (strlen(format) >= CLOCK_FORMAT_LEN) return "";
+
+        if (slot_count < CLOCK_MAX_FORMATS) {
+            slot = &slots[slot_count++];
+        } else {
+            slot = &slots[0];
+            for (int i = 1; i < slot_count; i++) {
+                if (slots[i].last_used < slot->last_used) {
+                    slot = &slots[i];
+                }
+            }
+        }
+        strcpy(slot->format, format);
+        clock_render(slot);
+    }
+
+    slot->last_used = clock_second;
+    return slot->text;
+}
+
+/* Convertir el valor de TTFORMAT o /ttformat a formato strftime
+ * Acepta los nombres HH:MM:SS y HH:MM o cualquier formato con '%' que
+ * produzca una hora no vacía que quepa en CLOCK_STRING_LEN.
+ */
+bool clock_parse_format(const char *value, char *dest, size_t size) {
+    if (!value || !dest || size == 0) return false;
+
+    const char *format = value;
+    if (strcmp(value, "HH:MM:SS") == 0) {
+        format = "%H:%M:%S";
+    } else if (strcmp(value, "HH:MM") == 0) {
+        format = "%H:%M";
+    } else if (!strchr(value, '%')) {
+        return false;
+    }
+
+    if (strlen(format) >= CLOCK_FORMAT_LEN || strlen(format) >= size) return false;
+
+    char test[CLOCK_STRING_LEN];
+    if (strftime(test, sizeof(test), format, clock_local()) == 0) return false;
+
+    strcpy(dest, format);
+    return true;
+}
@@ -0,0 +1,24 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include "common.h"
+#include <time.h>
+
+/* Reloj de la interfaz con resolución de segundos
+ * clock_update() se llama una vez por vuelta del bucle principal; solo
+ * cuando cambia el segundo se recalcula la hora local y se reformatean las
+ * cadenas de los formatos en uso. El resto de llamadas copian lo calculado.
+ * No es seguro entre hilos (el logger lleva su propia caché).
+ */
+
+#define CLOCK_MAX_FORMATS 8     /* Formatos strftime cacheados a la vez */
+#define CLOCK_FORMAT_LEN 64     /* Longitud máxima de un formato */
+#define CLOCK_STRING_LEN 64     /* Longitud máxima de la hora formateada */
+
+time_t clock_update(void);
+time_t clock_now(void);
+const struct tm* clock_local(void);
+const char* clock_format(const char *format);
+bool clock_parse_format(const char *value, char *dest, size_t size);
+
+#endif /* CLOCK_H */
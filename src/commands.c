@@ -1,4 +1,7 @@
 #include "commands.h"
+#include "logger.h"
+#include "clock.h"
+#include "grep.h"
 #include <time.h>
 #include <stdarg.h>
 
@@ -15,17 +18,22 @@ static Command command_table[] = {
     {"wl", cmd_window_list, "Listar todas las ventanas"},
     {"wc", cmd_window_close, "Cerrar ventana: /wc [n] (sin número cierra la actual)"},
     {"clear", cmd_clear, "Limpiar pantalla de la ventana activa"},
+    {"goto", cmd_goto, "Ir a una hora del scrollback: /goto HH:MM o /goto AAAA-MM-DD HH:MM"},
+    {"grep", cmd_grep, "Buscar en los logs: /grep [-r] [-w ventana] [--since T] [--until T] <texto|regex>, /grep stop"},
+    {"search", cmd_search, "Buscar en el scrollback: /search [-a] [-r] <texto|regex>, /search (siguiente), /search -c"},
+    {"split", cmd_split, "Dividir la pantalla: /split h|v [n], /split close, /split off, /split (paneles)"},
     {"buffer", cmd_buffer, "Activar/desactivar buffer: /buffer on|off"},
     {"silent", cmd_silent, "Modo silencioso: /silent on|off (oculta JOIN/QUIT/PART)"},
     {"ok", cmd_ok, "Borrar todas las notificaciones (C, M, *, +)"},
     {"log", cmd_log, "Activar/desactivar logging: /log on|off"},
     {"timestamp", cmd_timestamp, "Activar/desactivar timestamps: /timestamp on|off"},
-    {"ttformat", cmd_ttformat, "Formato de timestamp: /ttformat HH:MM:SS o /ttformat HH:MM"},
-    {"list", cmd_list, "Listar canales: /list [num <n>] [users <n>|<min>-<max>] [order] [search <patrón>]"},
+    {"ttformat", cmd_ttformat, "Formato de timestamp: /ttformat HH:MM:SS, /ttformat HH:MM o formato strftime (/ttformat %H:%M)"},
+    {"list", cmd_list, "Listar canales: /list [num <n>] [users <n>|<min>-<max>] [order [users|name|topic]] [search <patrón>] [refresh], /list bench [n]"},
     {"raw", cmd_raw, "Enviar comando IRC raw: /raw <comando IRC>"},
     {"whois", cmd_whois, "Información de usuario: /whois <nick>"},
     {"wii", cmd_wii, "Información de usuario: /wii <nick> (whois + whowas)"},
     {"debug", cmd_debug, "Modo debug: /debug on|off (abre ventana de depuración)"},
+    {"stats", cmd_stats, "Estadísticas de memoria del scrollback y del render"},
     {NULL, NULL, NULL}
 };
 
@@ -56,6 +64,7 @@ void cmd_help(CommandContext *ctx, const char *args) {
     wm_add_message(ctx->wm, 0, "");
     wm_add_message(ctx->wm, 0, ANSI_BOLD ANSI_CYAN "=== Navegación ===" ANSI_RESET);
     wm_add_message(ctx->wm, 0, ANSI_GRAY "Cambio de ventanas: /w1, /w2, /w3, etc. o Alt+0-9" ANSI_RESET);
+    wm_add_message(ctx->wm, 0, ANSI_GRAY "Paneles: /split h|v [n], Ctrl-W pasa al panel siguiente" ANSI_RESET);
     wm_add_message(ctx->wm, 0, ANSI_GRAY "Navegación buffer: Ctrl-Arriba, Ctrl-Abajo, Ctrl-B (inicio), Ctrl-E (fin)" ANSI_RESET);
     wm_add_message(ctx->wm, 0, ANSI_GRAY "Historial comandos: Arriba, Abajo" ANSI_RESET);
     wm_add_message(ctx->wm, 0, ANSI_GRAY "Autocompletar nicks: TAB" ANSI_RESET);
@@ -165,6 +174,7 @@ void cmd_join(CommandContext *ctx, const char *args) {
             if (win->buffer) {
                 win->buffer->enabled = ctx->config->buffer_enabled;
             }
+            window_preload_log(win, ctx->config->log_preload_lines);
             if (ctx->config->log_enabled) {
                 window_open_log(win);
             }
@@ -262,6 +272,7 @@ void cmd_msg(CommandContext *ctx, const char *args) {
             if (priv_win->buffer) {
                 priv_win->buffer->enabled = ctx->config->buffer_enabled;
             }
+            window_preload_log(priv_win, ctx->config->log_preload_lines);
             if (ctx->config->log_enabled) {
                 window_open_log(priv_win);
             }
@@ -295,15 +306,20 @@ void cmd_window_list(CommandContext *ctx, const char *args) {
                 case WIN_CHANNEL: type_str = "Canal"; break;
                 case WIN_PRIVATE: type_str = "Privado"; break;
                 case WIN_LIST: type_str = "Lista"; break;
+                case WIN_GREP: type_str = "Búsqueda"; break;
                 default: type_str = "Desconocido"; break;
             }
 
             const char *active = (i == ctx->wm->active_window) ? ANSI_GREEN " [ACTIVA]" ANSI_RESET : "";
 
-            /* Indicador de actividad para ventanas privadas */
-            const char *activity = "";
-            if (win->type == WIN_PRIVATE && (win->has_unread || win->is_new)) {
-                activity = ANSI_RED " +" ANSI_RESET;
+            /* Mensajes sin leer (y menciones entre ellos) */
+            char activity[64] = "";
+            if (win->highlight_count > 0) {
+                snprintf(activity, sizeof(activity), ANSI_MAGENTA " +%d (%d menciones)" ANSI_RESET,
+                         win->unread_count, win->highlight_count);
+            } else if (win->unread_count > 0 || win->is_new) {
+                snprintf(activity, sizeof(activity), "%s +%d" ANSI_RESET,
+                         win->type == WIN_PRIVATE ? ANSI_RED : ANSI_YELLOW, win->unread_count);
             }
 
             snprintf(msg, sizeof(msg), ANSI_YELLOW "[%d]" ANSI_RESET " %s - %s%s%s",
@@ -385,11 +401,81 @@ void cmd_clear(CommandContext *ctx, const char *args) {
 
     Window *win = wm_get_active_window(ctx->wm);
     if (win && win->buffer) {
+        window_clear_search(win);
         buffer_clear(win->buffer);
         wm_add_message(ctx->wm, win->id, ANSI_GRAY "Pantalla limpiada" ANSI_RESET);
     }
 }
 
+/* Comando: split */
+void cmd_split(CommandContext *ctx, const char *args) {
+    WindowManager *wm = ctx->wm;
+    char msg[MAX_MSG_LEN];
+
+    /* Sin argumentos: mostrar los paneles */
+    if (!args || args[0] == '\0') {
+        if (wm->pane_count <= 1) {
+            wm_add_message(wm, 0, ANSI_GRAY "Pantalla sin dividir (usa /split h|v [n])" ANSI_RESET);
+            return;
+        }
+        snprintf(msg, sizeof(msg), ANSI_BOLD ANSI_CYAN "=== Paneles (%s) ===" ANSI_RESET,
+                 wm->split == SPLIT_VERTICAL ? "lado a lado" : "apilados");
+        wm_add_message(wm, 0, msg);
+        for (int i = 0; i < wm->pane_count; i++) {
+            Window *win = wm->panes[i] >= 0 ? wm_get_window(wm, wm->panes[i]) : NULL;
+            if (win) {
+                snprintf(msg, sizeof(msg), "  %d: [%d] %s%s", i + 1, win->id, win->title,
+                         i == wm->active_pane ? ANSI_GREEN " [ACTIVO]" ANSI_RESET : "");
+            } else {
+                snprintf(msg, sizeof(msg), "  %d: " ANSI_GRAY "(vacío)" ANSI_RESET "%s", i + 1,
+                         i == wm->active_pane ? ANSI_GREEN " [ACTIVO]" ANSI_RESET : "");
+            }
+            wm_add_message(wm, 0, msg);
+        }
+        return;
+    }
+
+    char mode[16];
+    int win_id = -1;
+    if (sscanf(args, "%15s %d", mode, &win_id) < 1) return;
+
+    if (strcmp(mode, "off") == 0) {
+        wm_unsplit(wm);
+        wm_add_message(wm, 0, ANSI_GRAY "Pantalla sin dividir" ANSI_RESET);
+        return;
+    }
+
+    if (strcmp(mode, "close") == 0) {
+        if (wm->pane_count <= 1) {
+            wm_add_message(wm, 0, ANSI_RED "Error: No hay paneles que cerrar" ANSI_RESET);
+            return;
+        }
+        wm_close_pane(wm);
+        return;
+    }
+
+    SplitMode split;
+    if (strcmp(mode, "h") == 0) {
+        split = SPLIT_HORIZONTAL;
+    } else if (strcmp(mode, "v") == 0) {
+        split = SPLIT_VERTICAL;
+    } else {
+        wm_add_message(wm, 0, ANSI_RED "Error: Uso /split h|v [n], /split close, /split off" ANSI_RESET);
+        return;
+    }
+
+    if (wm->pane_count >= MAX_PANES) {
+        snprintf(msg, sizeof(msg), ANSI_RED "Error: Máximo %d paneles" ANSI_RESET, MAX_PANES);
+        wm_add_message(wm, 0, msg);
+        return;
+    }
+
+    if (!wm_split(wm, split, win_id)) {
+        snprintf(msg, sizeof(msg), ANSI_RED "Error: La ventana %d no existe o ya está en un panel" ANSI_RESET, win_id);
+        wm_add_message(wm, 0, msg);
+    }
+}
+
 /* Comando: buffer */
 void cmd_buffer(CommandContext *ctx, const char *args) {
     if (!args || args[0] == '\0') {
@@ -496,14 +582,8 @@ void cmd_ok(CommandContext *ctx, const char *args) {
     *ctx->notify_alert = false;
     *ctx->mention_alert = false;
 
-    /* Borrar flags de actividad en todas las ventanas */
-    for (int i = 0; i < MAX_WINDOWS; i++) {
-        Window *win = wm_get_window(ctx->wm, i);
-        if (win) {
-            win->has_unread = false;
-            win->is_new = false;
-        }
-    }
+    /* Borrar la actividad de todas las ventanas */
+    wm_clear_all_activity(ctx->wm);
 
     wm_add_message(ctx->wm, 0, ANSI_GREEN "Todas las notificaciones borradas" ANSI_RESET);
 }
@@ -525,7 +605,7 @@ void cmd_log(CommandContext *ctx, const char *args) {
         /* Abrir logs para todas las ventanas existentes */
         for (int i = 0; i < MAX_WINDOWS; i++) {
             Window *win = wm_get_window(ctx->wm, i);
-            if (win && !win->log_file) {
+            if (win && win->log_id < 0) {
                 window_open_log(win);
             }
         }
@@ -537,11 +617,12 @@ void cmd_log(CommandContext *ctx, const char *args) {
         /* Cerrar logs de todas las ventanas */
         for (int i = 0; i < MAX_WINDOWS; i++) {
             Window *win = wm_get_window(ctx->wm, i);
-            if (win && win->log_file) {
+            if (win && win->log_id >= 0) {
                 window_close_log(win);
             }
         }
 
+        logger_flush();
         wm_add_message(ctx->wm, 0, ANSI_YELLOW "Logging desactivado" ANSI_RESET);
     } else {
         wm_add_message(ctx->wm, 0, ANSI_RED "Error: Uso /log on|off" ANSI_RESET);
@@ -585,23 +666,59 @@ void cmd_ttformat(CommandContext *ctx, const char *args) {
         return;
     }
 
-    /* Validar formato */
-    if (strcmp(args, "HH:MM:SS") == 0) {
-        strncpy(ctx->config->timestamp_format, "HH:MM:SS", sizeof(ctx->config->timestamp_format) - 1);
-        ctx->config->timestamp_format[sizeof(ctx->config->timestamp_format) - 1] = '\0';
-        wm_add_message(ctx->wm, 0, ANSI_GREEN "Formato de timestamp: HH:MM:SS" ANSI_RESET);
-    } else if (strcmp(args, "HH:MM") == 0) {
-        strncpy(ctx->config->timestamp_format, "HH:MM", sizeof(ctx->config->timestamp_format) - 1);
-        ctx->config->timestamp_format[sizeof(ctx->config->timestamp_format) - 1] = '\0';
-        wm_add_message(ctx->wm, 0, ANSI_GREEN "Formato de timestamp: HH:MM" ANSI_RESET);
+    /* Validar formato (HH:MM:SS, HH:MM o strftime) */
+    if (clock_parse_format(args, ctx->config->timestamp_format, sizeof(ctx->config->timestamp_format))) {
+        char msg[MAX_MSG_LEN];
+        snprintf(msg, sizeof(msg), ANSI_GREEN "Formato de timestamp: %s (ejemplo: %s)" ANSI_RESET,
+                 ctx->config->timestamp_format, clock_format(ctx->config->timestamp_format));
+        wm_add_message(ctx->wm, 0, msg);
     } else {
-        wm_add_message(ctx->wm, 0, ANSI_RED "Error: Uso /ttformat HH:MM:SS o /ttformat HH:MM" ANSI_RESET);
+        wm_add_message(ctx->wm, 0, ANSI_RED "Error: Uso /ttformat HH:MM:SS, /ttformat HH:MM o un formato strftime (/ttformat %d/%m %H:%M)" ANSI_RESET);
     }
 }
 
+/* Benchmark de /list: n respuestas 322 sintéticas (nombres, usuarios y
+ * topics pseudoaleatorios) por el mismo camino que las del servidor */
+static void list_bench(CommandContext *ctx, Window *list_win, int count) {
+    static const char *words[] = { "linux", "debian", "music", "chat", "help", "games", "dev", "español",
+                                   "news", "art", "python", "irc", "retro", "anime", "radio", "books" };
+    int word_count = (int)(sizeof(words) / sizeof(words[0]));
+    unsigned int seed = 2463534242u;
+    char line[MAX_MSG_LEN];
+
+    struct timespec t0, t1, t2;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < count; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        /* Pocos canales grandes y muchos pequeños, como en una red real */
+        int users = (int)(seed % 1000 < 950 ? seed % 50 + 1 : seed % 5000 + 1);
+        snprintf(line, sizeof(line), ":irc.bench 322 yo #%s-%s%u %d :Canal de %s y %s, número %d",
+                 words[seed % word_count], words[(seed >> 8) % word_count], seed % 100000, users,
+                 words[(seed >> 16) % word_count], words[(seed >> 24) % word_count], i);
+        window_add_list_reply(list_win, line);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    window_finalize_channel_list(list_win);
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+    double receive_ms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+    double finalize_ms = (t2.tv_sec - t1.tv_sec) * 1000.0 + (t2.tv_nsec - t1.tv_nsec) / 1e6;
+    char msg[MAX_MSG_LEN];
+    snprintf(msg, sizeof(msg),
+             ANSI_CYAN "Benchmark LIST: %d canales sintéticos, %.1f ms recepción y filtros, %.1f ms orden y vista" ANSI_RESET,
+             count, receive_ms, finalize_ms);
+    wm_add_message(ctx->wm, list_win->id, msg);
+    wm_add_message(ctx->wm, 0, msg);
+}
+
 /* Comando: list */
 void cmd_list(CommandContext *ctx, const char *args) {
-    if (!ctx->irc->connected) {
+    /* /list bench [n]: medir con una respuesta sintética sin servidor */
+    bool bench = args && strncasecmp(args, "bench", 5) == 0 && (args[5] == ' ' || args[5] == '\0');
+
+    if (!bench && !ctx->irc->connected) {
         wm_add_message(ctx->wm, 0, ANSI_RED "Error: No estás conectado a un servidor" ANSI_RESET);
         return;
     }
@@ -637,14 +754,18 @@ void cmd_list(CommandContext *ctx, const char *args) {
     /* Limpiar lista anterior */
     window_clear_channel_list(list_win);
     list_win->list_receiving = true;
-    list_win->list_ordered = false;
+    list_win->list_server_filtered = false;
+    list_win->list_server_total = 0;
+    list_win->list_sort = LIST_SORT_NONE;
     list_win->list_filter[0] = '\0';
     list_win->list_limit = 0;
     list_win->list_min_users = 0;
     list_win->list_max_users = 0;
 
     /* Parsear argumentos */
-    bool order = false;
+    ListSort order = LIST_SORT_NONE;
+    int bench_count = 100000;
+    bool refresh = false;
     char search_pattern[256] = "";
     int limit = 0;
     int min_users = 0;
@@ -658,7 +779,31 @@ void cmd_list(CommandContext *ctx, const char *args) {
         char *token = strtok(args_copy, " ");
         while (token) {
             if (strcasecmp(token, "order") == 0) {
-                order = true;
+                /* Criterio opcional: users (por defecto), name o topic */
+                order = LIST_SORT_USERS;
+                token = strtok(NULL, " ");
+                if (token && strcasecmp(token, "users") == 0) {
+                    token = strtok(NULL, " ");
+                } else if (token && strcasecmp(token, "name") == 0) {
+                    order = LIST_SORT_NAME;
+                    token = strtok(NULL, " ");
+                } else if (token && strcasecmp(token, "topic") == 0) {
+                    order = LIST_SORT_TOPIC;
+                    token = strtok(NULL, " ");
+                }
+                continue;
+            } else if (strcasecmp(token, "bench") == 0) {
+                /* Número opcional de canales sintéticos */
+                token = strtok(NULL, " ");
+                char *end = NULL;
+                long count = token ? strtol(token, &end, 10) : 0;
+                if (count > 0 && *end == '\0') {
+                    bench_count = count > 10000000 ? 10000000 : (int)count;
+                    token = strtok(NULL, " ");
+                }
+                continue;
+            } else if (strcasecmp(token, "refresh") == 0) {
+                refresh = true;
             } else if (strcasecmp(token, "search") == 0) {
                 /* Siguiente token es el patrón */
                 token = strtok(NULL, " ");
@@ -715,9 +860,7 @@ void cmd_list(CommandContext *ctx, const char *args) {
     }
 
     /* Configurar opciones de la lista */
-    if (order) {
-        list_win->list_ordered = true;
-    }
+    list_win->list_sort = order;
 
     if (search_pattern[0] != '\0') {
         window_filter_channel_list(list_win, search_pattern);
@@ -732,19 +875,83 @@ void cmd_list(CommandContext *ctx, const char *args) {
         list_win->list_max_users = max_users;
     }
 
-    /* Enviar comando LIST al servidor */
-    irc_send(ctx->irc, "LIST");
-
     /* Cambiar a la ventana de lista */
     wm_switch_to(ctx->wm, list_win_id);
 
+    if (bench) {
+        /* Los canales sintéticos no deben mezclarse con la caché */
+        window_clear_list_cache(list_win);
+        list_bench(ctx, list_win, bench_count);
+        return;
+    }
+
+    /* Caché de la última lista completa de esta conexión: si no ha caducado
+     * se responde con ella sin pedir nada al servidor; si aún está llegando,
+     * se vuelve a filtrar lo recibido y se sigue esperando al 323 */
+    bool same_session = list_win->list_cache_session == ctx->irc->session;
+    bool filling = same_session && list_win->list_caching;
+    bool cached = !refresh && same_session && ctx->config->list_cache_ttl > 0 && list_win->list_cache_time > 0 &&
+                  time(NULL) - list_win->list_cache_time < ctx->config->list_cache_ttl;
+
+    char list_cmd[MAX_MSG_LEN] = "LIST";
+    if (cached || filling) {
+        window_replay_list_cache(list_win);
+    } else {
+        window_clear_list_cache(list_win);
+
+        /* Con ELIST (005) el servidor filtra por usuarios (U: >n excluye n, <n
+         * también) y por máscara (M); el filtro local sigue activo por si algún
+         * servidor no aplica alguna condición */
+        size_t cmd_len = strlen(list_cmd);
+        char sep = ' ';
+        if (ctx->irc->elist_mask && search_pattern[0] != '\0' && !strchr(search_pattern, ',')) {
+            cmd_len += snprintf(list_cmd + cmd_len, sizeof(list_cmd) - cmd_len, "%c%s", sep, search_pattern);
+            sep = ',';
+        }
+        if (ctx->irc->elist_users && min_users > 1) {
+            cmd_len += snprintf(list_cmd + cmd_len, sizeof(list_cmd) - cmd_len, "%c>%d", sep, min_users - 1);
+            sep = ',';
+        }
+        if (ctx->irc->elist_users && max_users > 0) {
+            cmd_len += snprintf(list_cmd + cmd_len, sizeof(list_cmd) - cmd_len, "%c<%d", sep, max_users + 1);
+            sep = ',';
+        }
+        list_win->list_server_filtered = sep == ',';
+        list_win->list_server_total = ctx->irc->channel_total;
+
+        /* Solo una lista completa sirve para responder luego a otros filtros */
+        list_win->list_caching = ctx->config->list_cache_ttl > 0 && !list_win->list_server_filtered;
+        list_win->list_cache_session = ctx->irc->session;
+
+        /* Enviar comando LIST al servidor */
+        irc_send(ctx->irc, list_cmd);
+    }
+
     /* Mostrar mensaje inicial */
     char msg[MAX_MSG_LEN];
-    snprintf(msg, sizeof(msg), ANSI_BOLD ANSI_CYAN "=== Solicitando lista de canales ===" ANSI_RESET);
+    if (cached) {
+        snprintf(msg, sizeof(msg), ANSI_BOLD ANSI_CYAN "=== Lista de canales (caché, %d canales) ===" ANSI_RESET,
+                 list_win->list_cache_count);
+    } else {
+        snprintf(msg, sizeof(msg), ANSI_BOLD ANSI_CYAN "=== Solicitando lista de canales ===" ANSI_RESET);
+    }
     wm_add_message(ctx->wm, list_win_id, msg);
 
-    if (order) {
-        wm_add_message(ctx->wm, list_win_id, ANSI_YELLOW "Opción: Ordenar por usuarios" ANSI_RESET);
+    bool client_filters = search_pattern[0] != '\0' || min_users > 1 || max_users > 0;
+    if (list_win->list_server_filtered) {
+        snprintf(msg, sizeof(msg), ANSI_YELLOW "Filtro en el servidor (ELIST): %s" ANSI_RESET, list_cmd);
+        wm_add_message(ctx->wm, list_win_id, msg);
+    } else if (client_filters && !cached && !filling) {
+        wm_add_message(ctx->wm, list_win_id, ANSI_GRAY "El servidor no anuncia ELIST: se filtra en el cliente" ANSI_RESET);
+    }
+    if (!list_win->list_server_filtered && !cached && !filling && !ctx->irc->safelist) {
+        wm_add_message(ctx->wm, list_win_id, ANSI_GRAY "El servidor no anuncia SAFELIST: la lista completa puede tardar" ANSI_RESET);
+    }
+
+    if (order != LIST_SORT_NONE) {
+        snprintf(msg, sizeof(msg), ANSI_YELLOW "Opción: Ordenar por %s" ANSI_RESET,
+                 order == LIST_SORT_NAME ? "nombre" : order == LIST_SORT_TOPIC ? "topic" : "usuarios");
+        wm_add_message(ctx->wm, list_win_id, msg);
     }
 
     if (search_pattern[0] != '\0') {
@@ -768,7 +975,15 @@ void cmd_list(CommandContext *ctx, const char *args) {
         wm_add_message(ctx->wm, list_win_id, msg);
     }
 
-    wm_add_message(ctx->wm, list_win_id, ANSI_GRAY "Recibiendo datos del servidor..." ANSI_RESET);
+    if (cached) {
+        window_finalize_channel_list(list_win);
+    } else if (filling) {
+        snprintf(msg, sizeof(msg), ANSI_GRAY "La lista aún está llegando (%d canales hasta ahora)..." ANSI_RESET,
+                 list_win->list_cache_count);
+        wm_add_message(ctx->wm, list_win_id, msg);
+    } else {
+        wm_add_message(ctx->wm, list_win_id, ANSI_GRAY "Recibiendo datos del servidor..." ANSI_RESET);
+    }
 }
 
 /* Comando: raw */
@@ -893,6 +1108,411 @@ void cmd_debug(CommandContext *ctx, const char *args) {
     }
 }
 
+/* Comando: stats */
+void cmd_stats(CommandContext *ctx, const char *args) {
+    (void)args; /* No usado */
+
+    wm_add_message(ctx->wm, 0, ANSI_BOLD ANSI_CYAN "=== Memoria del scrollback ===" ANSI_RESET);
+
+    size_t total_raw = 0;
+    size_t total_mem = 0;
+
+    for (int i = 0; i < MAX_WINDOWS; i++) {
+        Window *win = wm_get_window(ctx->wm, i);
+        if (!win) continue;
+
+        BufferStats st;
+        buffer_get_stats(win->buffer, &st);
+
+        /* Memoria real frente a la que ocuparía todo sin comprimir */
+        size_t raw = st.hot_bytes + st.cold_raw_bytes;
+        size_t mem = st.hot_bytes + st.cold_stored_bytes;
+        int saved = raw > 0 ? (int)(100 - (mem * 100) / raw) : 0;
+        total_raw += raw;
+        total_mem += mem;
+
+        char msg[MAX_MSG_LEN];
+        snprintf(msg, sizeof(msg),
+                 ANSI_YELLOW "[%d]" ANSI_RESET " %s: %d líneas (%d en memoria, %d comprimidas en %d bloques, %d en disco) "
+                 "%zu KB -> %zu KB (%d%% ahorro)",
+                 i, win->title, st.total_lines, st.hot_lines, st.cold_lines, st.blocks,
+                 st.spilled_lines, raw / 1024, mem / 1024, saved);
+        wm_add_message(ctx->wm, 0, msg);
+
+        snprintf(msg, sizeof(msg), "    %d bloques pendientes de comprimir, %zu KB en disco, índice de búsqueda %zu KB",
+                 st.pending_blocks, st.spilled_bytes / 1024, st.index_bytes / 1024);
+        wm_add_message(ctx->wm, 0, msg);
+    }
+
+    int saved = total_raw > 0 ? (int)(100 - (total_mem * 100) / total_raw) : 0;
+    char msg[MAX_MSG_LEN];
+    snprintf(msg, sizeof(msg), ANSI_CYAN "Total en memoria: %zu KB -> %zu KB (%d%% ahorro)" ANSI_RESET,
+             total_raw / 1024, total_mem / 1024, saved);
+    wm_add_message(ctx->wm, 0, msg);
+
+    /* Salida al terminal: un write por frame salvo escrituras parciales */
+    if (ctx->term) {
+        const ScreenStats *rs = &ctx->term->screen.stats;
+        unsigned long long avg = rs->frames > 0 ? rs->total_bytes / rs->frames : 0;
+        snprintf(msg, sizeof(msg),
+                 ANSI_CYAN "Render: %lu frames, último %zu bytes en %u write(s), media %llu bytes/frame, %lu writes en total, %lu con scroll del terminal" ANSI_RESET,
+                 rs->frames, rs->last_bytes, rs->last_syscalls, avg, rs->total_syscalls, rs->scrolls);
+        wm_add_message(ctx->wm, 0, msg);
+
+        snprintf(msg, sizeof(msg),
+                 ANSI_CYAN "Redibujado: máximo %d fps, %lu peticiones agrupadas en frames posteriores, %lu redimensionados" ANSI_RESET,
+                 ctx->term->max_fps, ctx->term->coalesced, ctx->term->resizes);
+        wm_add_message(ctx->wm, 0, msg);
+    }
+
+    /* Logger asíncrono */
+    LoggerStats ls;
+    logger_get_stats(&ls);
+    snprintf(msg, sizeof(msg),
+             ANSI_CYAN "Logs: %d/%d abiertos (%lu aperturas, %lu cierres por falta de sitio), %llu líneas encoladas, "
+             "%llu descartadas, %llu KB escritos en %lu writes "
+             "(%lu vaciados, %lu fsync), cola %zu/%zu KB, %lu cambios de día, %lu comprimidos" ANSI_RESET,
+             ls.open_files, ls.max_open, ls.opens, ls.evictions, ls.queued, ls.dropped, ls.written_bytes / 1024, ls.writes,
+             ls.flushes, ls.fsyncs, ls.queue_used / 1024, ls.queue_capacity / 1024,
+             ls.rotations, ls.compressed);
+    wm_add_message(ctx->wm, 0, msg);
+}
+
+/* Búsqueda en todas las ventanas (/search -a) */
+static bool search_all_windows = false;
+
+/* Informar de la coincidencia actual de una ventana */
+static void search_report(CommandContext *ctx, Window *win, bool wrapped) {
+    char msg[MAX_MSG_LEN];
+    snprintf(msg, sizeof(msg), ANSI_CYAN "Búsqueda: coincidencia en [%d] %s, línea %d de %d%s" ANSI_RESET,
+             win->id, win->title, win->search.line + 1, win->buffer->count,
+             wrapped ? " (continuando desde el final)" : "");
+    wm_add_message(ctx->wm, 0, msg);
+}
+
+/* Buscar desde el final en las ventanas siguientes a start y activar la primera con coincidencias */
+static Window* search_other_windows(CommandContext *ctx, int start) {
+    for (int k = 1; k < MAX_WINDOWS; k++) {
+        Window *win = wm_get_window(ctx->wm, (start + k) % MAX_WINDOWS);
+        if (win && win->search.active && window_search_next(win, win->buffer->count - 1)) {
+            wm_switch_to(ctx->wm, win->id);
+            return win;
+        }
+    }
+    return NULL;
+}
+
+/* Comando: search */
+void cmd_search(CommandContext *ctx, const char *args) {
+    Window *active = wm_get_active_window(ctx->wm);
+    if (!active) return;
+
+    /* Sin argumentos: siguiente coincidencia (más antigua) */
+    if (!args || args[0] == '\0') {
+        Window *found = NULL;
+        if (active->search.active) {
+            int from = (active->search.line >= 0) ? active->search.line - 1 : active->buffer->count - 1;
+            if (window_search_next(active, from)) {
+                found = active;
+            }
+        }
+        if (!found && search_all_windows) {
+            found = search_other_windows(ctx, active->id);
+        }
+        if (found) {
+            search_report(ctx, found, false);
+        } else if (active->search.active && window_search_next(active, active->buffer->count - 1)) {
+            search_report(ctx, active, true);
+        } else {
+            wm_add_message(ctx->wm, 0, ANSI_RED "Error: No hay búsqueda activa. Uso /search [-a] [-r] <texto|regex>" ANSI_RESET);
+        }
+        return;
+    }
+
+    /* Terminar la búsqueda y volver al final */
+    if (strcmp(args, "-c") == 0) {
+        for (int i = 0; i < MAX_WINDOWS; i++) {
+            Window *win = wm_get_window(ctx->wm, i);
+            if (win && win->search.active) {
+                window_clear_search(win);
+                buffer_scroll_bottom(win->buffer);
+            }
+        }
+        search_all_windows = false;
+        wm_add_message(ctx->wm, 0, ANSI_GRAY "Búsqueda terminada" ANSI_RESET);
+        return;
+    }
+
+    /* Opciones */
+    bool all = false;
+    bool use_regex = false;
+    while (args[0] == '-' && (args[1] == 'a' || args[1] == 'r') && (args[2] == ' ' || args[2] == '\0')) {
+        if (args[1] == 'a') all = true;
+        else use_regex = true;
+        args += 2;
+        while (*args == ' ') args++;
+    }
+
+    if (args[0] == '\0') {
+        wm_add_message(ctx->wm, 0, ANSI_RED "Error: Uso /search [-a] [-r] <texto|regex>" ANSI_RESET);
+        return;
+    }
+
+    /* Preparar la búsqueda en la ventana activa o en todas */
+    for (int i = 0; i < MAX_WINDOWS; i++) {
+        Window *win = wm_get_window(ctx->wm, i);
+        if (!win) continue;
+
+        window_clear_search(win);
+        if ((all || win == active) && !window_set_search(win, args, use_regex)) {
+            wm_add_message(ctx->wm, 0, ANSI_RED "Error: Expresión regular inválida" ANSI_RESET);
+            return;
+        }
+    }
+    search_all_windows = all;
+
+    Window *found = NULL;
+    if (window_search_next(active, active->buffer->count - 1)) {
+        found = active;
+    } else if (all) {
+        found = search_other_windows(ctx, active->id);
+    }
+
+    if (found) {
+        search_report(ctx, found, false);
+    } else {
+        char msg[MAX_MSG_LEN];
+        snprintf(msg, sizeof(msg), ANSI_YELLOW "Búsqueda: sin coincidencias para '%s'" ANSI_RESET, args);
+        wm_add_message(ctx->wm, 0, msg);
+    }
+}
+
+/* Comando: goto */
+void cmd_goto(CommandContext *ctx, const char *args) {
+    Window *win = wm_get_active_window(ctx->wm);
+    if (!win || !win->buffer) return;
+
+    /* Interpretar la hora: HH:MM (la más reciente ya pasada) o AAAA-MM-DD HH:MM */
+    time_t now = time(NULL);
+    struct tm target = *localtime(&now);
+    int year, month, day, hour, minute;
+    bool has_date = false;
+
+    if (args && sscanf(args, "%d-%d-%d %d:%d", &year, &month, &day, &hour, &minute) == 5) {
+        target.tm_year = year - 1900;
+        target.tm_mon = month - 1;
+        target.tm_mday = day;
+        has_date = true;
+    } else if (!args || sscanf(args, "%d:%d", &hour, &minute) != 2) {
+        wm_add_message(ctx->wm, 0, ANSI_RED "Error: Uso /goto HH:MM o /goto AAAA-MM-DD HH:MM" ANSI_RESET);
+        return;
+    }
+
+    if (hour < 0 || hour > 23 || minute < 0 || minute > 59) {
+        wm_add_message(ctx->wm, 0, ANSI_RED "Error: Hora inválida" ANSI_RESET);
+        return;
+    }
+
+    target.tm_hour = hour;
+    target.tm_min = minute;
+    target.tm_sec = 0;
+    target.tm_isdst = -1;
+    time_t when = mktime(&target);
+    if (!has_date && when > now) {
+        target.tm_mday--;
+        target.tm_isdst = -1;
+        when = mktime(&target);
+    }
+
+    int line = buffer_find_time(win->buffer, when);
+    if (line < 0) {
+        wm_add_message(ctx->wm, 0, ANSI_YELLOW "No hay mensajes desde esa hora en esta ventana" ANSI_RESET);
+        return;
+    }
+
+    /* Dejar la línea encontrada en la parte alta de la pantalla */
+    int rows = ctx->term ? ctx->term->rows - 3 : 20;
+    int end = line + rows / 2;
+    if (end > win->buffer->count - 1) end = win->buffer->count - 1;
+    win->buffer->view_offset = win->buffer->count - 1 - end;
+
+    time_t found = buffer_line_time(win->buffer, line);
+    char when_str[32];
+    strftime(when_str, sizeof(when_str), "%Y-%m-%d %H:%M", localtime(&found));
+
+    char msg[MAX_MSG_LEN];
+    snprintf(msg, sizeof(msg), ANSI_CYAN "Mostrando [%d] %s desde %s (línea %d de %d)" ANSI_RESET,
+             win->id, win->title, when_str, line + 1, win->buffer->count);
+    wm_add_message(ctx->wm, 0, msg);
+}
+
+/* Leer la siguiente palabra de args en dest; devuelve el resto */
+static const char* grep_next_word(const char *args, char *dest, size_t size) {
+    size_t len = 0;
+    while (*args && *args != ' ') {
+        if (len + 1 < size) dest[len++] = *args;
+        args++;
+    }
+    dest[len] = '\0';
+    while (*args == ' ') args++;
+    return args;
+}
+
+/* Hora de /grep --since/--until: AAAA-MM-DD[_HH:MM], HH:MM (hoy) o hace
+ * N minutos, horas o días (30m, 2h, 7d). Un día sin hora es su principio, o
+ * su final si end_of_day */
+static bool grep_parse_time(const char *value, bool end_of_day, time_t *when) {
+    time_t now = time(NULL);
+    struct tm target = *localtime(&now);
+    int year, month, day, hour, minute;
+    long amount;
+    char unit, extra;
+
+    if (sscanf(value, "%ld%c%c", &amount, &unit, &extra) == 2 && amount >= 0 &&
+        (unit == 'm' || unit == 'h' || unit == 'd')) {
+        long seconds = (unit == 'm') ? 60 : (unit == 'h') ? 3600 : 86400;
+        *when = now - (time_t)(amount * seconds);
+        return true;
+    }
+
+    if (sscanf(value, "%d-%d-%d_%d:%d", &year, &month, &day, &hour, &minute) == 5) {
+        target.tm_year = year - 1900;
+        target.tm_mon = month - 1;
+        target.tm_mday = day;
+        target.tm_sec = end_of_day ? 59 : 0;
+    } else if (sscanf(value, "%d-%d-%d", &year, &month, &day) == 3) {
+        target.tm_year = year - 1900;
+        target.tm_mon = month - 1;
+        target.tm_mday = day;
+        hour = end_of_day ? 23 : 0;
+        minute = end_of_day ? 59 : 0;
+        target.tm_sec = end_of_day ? 59 : 0;
+    } else if (sscanf(value, "%d:%d", &hour, &minute) == 2) {
+        target.tm_sec = end_of_day ? 59 : 0;
+    } else {
+        return false;
+    }
+
+    if (hour < 0 || hour > 23 || minute < 0 || minute > 59) return false;
+    target.tm_hour = hour;
+    target.tm_min = minute;
+    target.tm_isdst = -1;
+    *when = mktime(&target);
+    return *when != (time_t)-1;
+}
+
+/* Comando: grep */
+void cmd_grep(CommandContext *ctx, const char *args) {
+    const char *usage = ANSI_RED "Error: Uso /grep [-r] [-w ventana] [--since T] [--until T] <texto|regex>" ANSI_RESET;
+
+    if (!args || args[0] == '\0') {
+        wm_add_message(ctx->wm, 0, usage);
+        wm_add_message(ctx->wm, 0, ANSI_GRAY "T: AAAA-MM-DD, AAAA-MM-DD_HH:MM, HH:MM (hoy) o 30m, 2h, 7d (hace...)" ANSI_RESET);
+        return;
+    }
+
+    /* Parar la búsqueda en curso (los resultados ya mostrados se quedan) */
+    if (strcmp(args, "stop") == 0 || strcmp(args, "-c") == 0) {
+        if (grep_running()) {
+            grep_cancel();
+        } else {
+            wm_add_message(ctx->wm, 0, ANSI_GRAY "No hay ninguna búsqueda en curso" ANSI_RESET);
+        }
+        return;
+    }
+
+    /* Opciones */
+    GrepOptions options;
+    memset(&options, 0, sizeof(options));
+    while (args[0] == '-') {
+        char option[32];
+        char value[MAX_CHANNEL_LEN];
+        const char *rest = grep_next_word(args, option, sizeof(option));
+
+        if (strcmp(option, "-r") == 0) {
+            options.use_regex = true;
+            args = rest;
+            continue;
+        }
+
+        bool is_window = strcmp(option, "-w") == 0 || strcmp(option, "--window") == 0;
+        bool is_since = strcmp(option, "--since") == 0;
+        bool is_until = strcmp(option, "--until") == 0;
+        if (!is_window && !is_since && !is_until) break;  /* Texto que empieza por - */
+
+        args = grep_next_word(rest, value, sizeof(value));
+        if (value[0] == '\0') {
+            wm_add_message(ctx->wm, 0, usage);
+            return;
+        }
+
+        if (is_window) {
+            snprintf(options.window, sizeof(options.window), "%s", value);
+        } else if (!grep_parse_time(value, is_until, is_since ? &options.since : &options.until)) {
+            char msg[MAX_MSG_LEN];
+            snprintf(msg, sizeof(msg), ANSI_RED "Error: Fecha inválida '%s' (AAAA-MM-DD, AAAA-MM-DD_HH:MM, HH:MM, 30m, 2h, 7d)" ANSI_RESET, value);
+            wm_add_message(ctx->wm, 0, msg);
+            return;
+        }
+    }
+
+    if (args[0] == '\0') {
+        wm_add_message(ctx->wm, 0, usage);
+        return;
+    }
+    if (strlen(args) >= sizeof(options.pattern)) {
+        wm_add_message(ctx->wm, 0, ANSI_RED "Error: Patrón demasiado largo" ANSI_RESET);
+        return;
+    }
+    strcpy(options.pattern, args);
+
+    if (options.use_regex) {
+        regex_t regex;
+        if (regcomp(&regex, options.pattern, REG_EXTENDED | REG_ICASE | REG_NOSUB) != 0) {
+            wm_add_message(ctx->wm, 0, ANSI_RED "Error: Expresión regular inválida" ANSI_RESET);
+            return;
+        }
+        regfree(&regex);
+    }
+
+    /* Ventana de resultados (se reutiliza la de la búsqueda anterior) */
+    Window *grep_win = NULL;
+    for (int i = 0; i < MAX_WINDOWS; i++) {
+        Window *w = wm_get_window(ctx->wm, i);
+        if (w && w->type == WIN_GREP) {
+            grep_win = w;
+            break;
+        }
+    }
+    if (!grep_win) {
+        int id = wm_create_window(ctx->wm, WIN_GREP, "Búsqueda en logs");
+        if (id == -1) {
+            wm_add_message(ctx->wm, 0, ANSI_RED "Error: No se pudo crear ventana de búsqueda" ANSI_RESET);
+            return;
+        }
+        grep_win = wm_get_window(ctx->wm, id);
+        if (grep_win->buffer) {
+            grep_win->buffer->enabled = ctx->config->buffer_enabled;
+        }
+    }
+    buffer_clear(grep_win->buffer);
+
+    char msg[MAX_MSG_LEN];
+    char since_str[32] = "el principio";
+    char until_str[32] = "ahora";
+    if (options.since > 0) strftime(since_str, sizeof(since_str), "%Y-%m-%d %H:%M", localtime(&options.since));
+    if (options.until > 0) strftime(until_str, sizeof(until_str), "%Y-%m-%d %H:%M", localtime(&options.until));
+    snprintf(msg, sizeof(msg), ANSI_CYAN "Buscando %s'%s' en los logs de %s, desde %s hasta %s..." ANSI_RESET,
+             options.use_regex ? "la regex " : "", options.pattern,
+             options.window[0] ? options.window : "todas las ventanas", since_str, until_str);
+    wm_add_message(ctx->wm, grep_win->id, msg);
+
+    if (!grep_start(&options, grep_win->id)) {
+        wm_add_message(ctx->wm, grep_win->id, ANSI_RED "Error: No se pudo iniciar la búsqueda" ANSI_RESET);
+    }
+    wm_switch_to(ctx->wm, grep_win->id);
+}
+
 /* Función de logging de debug */
 void debug_log(WindowManager *wm, int debug_window_id, const char *format, ...) {
     if (debug_window_id == -1) return;
@@ -904,14 +1524,9 @@ void debug_log(WindowManager *wm, int debug_window_id, const char *format, ...)
     vsnprintf(buffer, sizeof(buffer), format, args);
     va_end(args);
 
-    /* Añadir timestamp */
-    time_t now = time(NULL);
-    struct tm *tm_info = localtime(&now);
-    char timestamp[32];
-    strftime(timestamp, sizeof(timestamp), "[%H:%M:%S]", tm_info);
-
+    /* Añadir timestamp (cacheado por segundo) */
     char msg[MAX_MSG_LEN];
-    snprintf(msg, sizeof(msg), ANSI_GRAY "%s" ANSI_RESET " %s", timestamp, buffer);
+    snprintf(msg, sizeof(msg), ANSI_GRAY "%s" ANSI_RESET " %s", clock_format("[%H:%M:%S]"), buffer);
 
     wm_add_message(wm, debug_window_id, msg);
 }
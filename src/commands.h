@@ -5,6 +5,7 @@
 #include "windows.h"
 #include "irc.h"
 #include "config.h"
+#include "terminal.h"
 
 /* Estructura para el contexto de comandos */
 typedef struct {
@@ -17,6 +18,7 @@ typedef struct {
     bool *notify_alert;
     bool *mention_alert;
     int *debug_window_id;
+    TerminalState *term;
 } CommandContext;
 
 /* Función de comando */
@@ -41,6 +43,7 @@ void cmd_window_list(CommandContext *ctx, const char *args);
 void cmd_window_switch(CommandContext *ctx, const char *args);
 void cmd_window_close(CommandContext *ctx, const char *args);
 void cmd_clear(CommandContext *ctx, const char *args);
+void cmd_split(CommandContext *ctx, const char *args);
 void cmd_buffer(CommandContext *ctx, const char *args);
 void cmd_silent(CommandContext *ctx, const char *args);
 void cmd_ok(CommandContext *ctx, const char *args);
@@ -52,6 +55,10 @@ void cmd_raw(CommandContext *ctx, const char *args);
 void cmd_whois(CommandContext *ctx, const char *args);
 void cmd_wii(CommandContext *ctx, const char *args);
 void cmd_debug(CommandContext *ctx, const char *args);
+void cmd_stats(CommandContext *ctx, const char *args);
+void cmd_search(CommandContext *ctx, const char *args);
+void cmd_goto(CommandContext *ctx, const char *args);
+void cmd_grep(CommandContext *ctx, const char *args);
 
 /* Función de logging de debug */
 void debug_log(WindowManager *wm, int debug_window_id, const char *format, ...);
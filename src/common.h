@@ -12,9 +12,13 @@
 #define UNICODE_HLINE "\u2500"      /* ─ línea horizontal */
 #define UNICODE_VLINE "\u2502"      /* │ línea vertical */
 #define UNICODE_JUNCTION "\u2534"   /* ┴ unión T invertida */
+#define UNICODE_HLINE_CP 0x2500
+#define UNICODE_VLINE_CP 0x2502
+#define UNICODE_JUNCTION_CP 0x2534
 
 /* Constantes del sistema */
 #define MAX_WINDOWS 20
+#define MAX_PANES 4
 #define MAX_NICK_LEN 32
 #define MAX_SERVER_LEN 256
 #define MAX_CHANNEL_LEN 64
@@ -22,6 +26,8 @@
 #define MAX_INPUT_LEN 512
 #define COMMAND_HISTORY_SIZE 15
 #define DEFAULT_IRC_PORT 6667
+#define DEFAULT_MAX_FPS 30
+#define DEFAULT_LIST_CACHE_TTL 300
 #define MAX_USERS_PER_CHANNEL 500
 
 /* Tipos de ventanas */
@@ -30,9 +36,17 @@ typedef enum {
     WIN_CHANNEL,
     WIN_PRIVATE,
     WIN_LIST,
-    WIN_DEBUG
+    WIN_DEBUG,
+    WIN_GREP
 } WindowType;
 
+/* Disposición de los paneles */
+typedef enum {
+    SPLIT_NONE,                 /* Un solo panel */
+    SPLIT_HORIZONTAL,           /* Paneles apilados de arriba abajo */
+    SPLIT_VERTICAL              /* Paneles de izquierda a derecha */
+} SplitMode;
+
 /* Códigos de escape ANSI para colores */
 #define ANSI_RESET "\033[0m"
 #define ANSI_BOLD "\033[1m"
@@ -44,6 +58,8 @@ typedef enum {
 #define ANSI_CYAN "\033[36m"
 #define ANSI_WHITE "\033[37m"
 #define ANSI_GRAY "\033[90m"
+#define ANSI_REVERSE "\033[7m"
+#define ANSI_NO_REVERSE "\033[27m"
 
 /* Códigos de escape ANSI para posicionamiento */
 #define ANSI_CLEAR_SCREEN "\033[2J"
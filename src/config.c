@@ -1,4 +1,5 @@
 #include "config.h"
+#include "buffer.h"
 #include <ctype.h>
 
 /* Crear estructura de configuración */
@@ -30,8 +31,20 @@ void config_set_defaults(Config *cfg) {
     cfg->silent_mode = false;
     cfg->log_enabled = false;
     cfg->timestamp_enabled = false;
-    strncpy(cfg->timestamp_format, "HH:MM:SS", sizeof(cfg->timestamp_format) - 1);
+    strncpy(cfg->timestamp_format, "%H:%M:%S", sizeof(cfg->timestamp_format) - 1);
     cfg->timestamp_format[sizeof(cfg->timestamp_format) - 1] = '\0';
+    cfg->buffer_mem_lines = DEFAULT_BUFFER_MEM_LINES;
+    cfg->log_preload_lines = 0;
+    cfg->log_queue_kb = DEFAULT_LOG_QUEUE_KB;
+    cfg->log_flush_ms = DEFAULT_LOG_FLUSH_MS;
+    cfg->log_fsync = DEFAULT_LOG_FSYNC;
+    cfg->log_compress = DEFAULT_LOG_COMPRESS;
+    cfg->log_max_open = DEFAULT_LOG_MAX_OPEN;
+    cfg->log_format = DEFAULT_LOG_FORMAT;
+    cfg->max_fps = DEFAULT_MAX_FPS;
+    cfg->list_cache_ttl = DEFAULT_LIST_CACHE_TTL;
+    cfg->split_mode = SPLIT_NONE;
+    cfg->split_panes = 2;
     cfg->autojoin_count = 0;
     cfg->notify_count = 0;
 
@@ -138,6 +151,13 @@ int config_load(Config *cfg, const char *filename) {
                 cfg->buffer_enabled = false;
             }
         }
+        else if (strcasecmp(key, "BUFFER_MEM_LINES") == 0) {
+            /* Número de líneas en memoria por ventana (0 = no volcar a disco) */
+            int lines = atoi(value);
+            if (lines >= 0) {
+                cfg->buffer_mem_lines = lines;
+            }
+        }
         else if (strcasecmp(key, "SILENT") == 0) {
             if (strcasecmp(value, "on") == 0 || strcasecmp(value, "yes") == 0 ||
                 strcasecmp(value, "true") == 0 || strcmp(value, "1") == 0) {
@@ -158,6 +178,93 @@ int config_load(Config *cfg, const char *filename) {
                 cfg->log_enabled = false;
             }
         }
+        else if (strcasecmp(key, "LOG_PRELOAD") == 0) {
+            /* Líneas de log a precargar en ventanas nuevas (0 = desactivado) */
+            int lines = atoi(value);
+            if (lines >= 0) {
+                cfg->log_preload_lines = lines;
+            }
+        }
+        else if (strcasecmp(key, "LOG_QUEUE_KB") == 0) {
+            /* Memoria de la cola del logger (mínimo 64 KB) */
+            int kb = atoi(value);
+            if (kb > 0) {
+                cfg->log_queue_kb = kb;
+            }
+        }
+        else if (strcasecmp(key, "LOG_FLUSH_MS") == 0) {
+            /* Intervalo de escritura de los logs (0 = en cuanto lleguen) */
+            int ms = atoi(value);
+            if (ms >= 0) {
+                cfg->log_flush_ms = ms;
+            }
+        }
+        else if (strcasecmp(key, "LOG_FSYNC") == 0) {
+            /* Segundos entre fsync de cada log (0 = nunca) */
+            int seconds = atoi(value);
+            if (seconds >= 0) {
+                cfg->log_fsync = seconds;
+            }
+        }
+        else if (strcasecmp(key, "LOG_MAX_OPEN") == 0) {
+            /* Archivos de log abiertos a la vez */
+            int files = atoi(value);
+            if (files > 0) {
+                cfg->log_max_open = files;
+            }
+        }
+        else if (strcasecmp(key, "LOG_COMPRESS") == 0) {
+            /* Comprimir con gzip los logs de días anteriores */
+            if (strcasecmp(value, "on") == 0 || strcasecmp(value, "yes") == 0 ||
+                strcasecmp(value, "true") == 0 || strcmp(value, "1") == 0) {
+                cfg->log_compress = true;
+            }
+            else if (strcasecmp(value, "off") == 0 || strcasecmp(value, "no") == 0 ||
+                     strcasecmp(value, "false") == 0 || strcmp(value, "0") == 0) {
+                cfg->log_compress = false;
+            }
+        }
+        else if (strcasecmp(key, "LOG_FORMAT") == 0) {
+            /* Formato de los logs: text o jsonl */
+            if (strcasecmp(value, "jsonl") == 0 || strcasecmp(value, "json") == 0) {
+                cfg->log_format = LOG_FORMAT_JSONL;
+            }
+            else if (strcasecmp(value, "text") == 0 || strcasecmp(value, "txt") == 0) {
+                cfg->log_format = LOG_FORMAT_TEXT;
+            }
+        }
+        else if (strcasecmp(key, "MAX_FPS") == 0) {
+            /* Límite de frames por segundo del redibujado (0 = sin límite) */
+            int fps = atoi(value);
+            if (fps >= 0) {
+                cfg->max_fps = fps;
+            }
+        }
+        else if (strcasecmp(key, "LIST_CACHE_TTL") == 0) {
+            /* Segundos que /list responde desde la última lista (0 = siempre la pide) */
+            int seconds = atoi(value);
+            if (seconds >= 0) {
+                cfg->list_cache_ttl = seconds;
+            }
+        }
+        else if (strcasecmp(key, "SPLIT") == 0) {
+            /* División inicial: h (apilados), v (lado a lado) u off */
+            if (strcasecmp(value, "h") == 0) {
+                cfg->split_mode = SPLIT_HORIZONTAL;
+            }
+            else if (strcasecmp(value, "v") == 0) {
+                cfg->split_mode = SPLIT_VERTICAL;
+            }
+            else if (strcasecmp(value, "off") == 0) {
+                cfg->split_mode = SPLIT_NONE;
+            }
+        }
+        else if (strcasecmp(key, "SPLIT_PANES") == 0) {
+            int panes = atoi(value);
+            if (panes >= 2 && panes <= MAX_PANES) {
+                cfg->split_panes = panes;
+            }
+        }
         else if (strcasecmp(key, "TIMESTAMP") == 0) {
             if (strcasecmp(value, "on") == 0 || strcasecmp(value, "yes") == 0 ||
                 strcasecmp(value, "true") == 0 || strcmp(value, "1") == 0) {
@@ -169,11 +276,8 @@ int config_load(Config *cfg, const char *filename) {
             }
         }
         else if (strcasecmp(key, "TTFORMAT") == 0) {
-            /* Validar formato: debe ser "HH:MM:SS" o "HH:MM" */
-            if (strcmp(value, "HH:MM:SS") == 0 || strcmp(value, "HH:MM") == 0) {
-                strncpy(cfg->timestamp_format, value, sizeof(cfg->timestamp_format) - 1);
-                cfg->timestamp_format[sizeof(cfg->timestamp_format) - 1] = '\0';
-            }
+            /* "HH:MM:SS", "HH:MM" o un formato strftime; si no es válido se ignora */
+            clock_parse_format(value, cfg->timestamp_format, sizeof(cfg->timestamp_format));
         }
         else if (strcasecmp(key, "AUTOJOIN") == 0) {
             /* Parsear lista de canales separados por comas */
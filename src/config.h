@@ -2,6 +2,8 @@
 #define CONFIG_H
 
 #include "common.h"
+#include "logger.h"
+#include "clock.h"
 
 /* Lista de canales para autojoin */
 #define MAX_AUTOJOIN_CHANNELS 10
@@ -20,7 +22,19 @@ typedef struct {
     bool silent_mode;
     bool log_enabled;
     bool timestamp_enabled;
-    char timestamp_format[16];  /* "HH:MM:SS" o "HH:MM" */
+    char timestamp_format[CLOCK_FORMAT_LEN];  /* Formato strftime ("%H:%M:%S" por defecto) */
+    int buffer_mem_lines;       /* Líneas en memoria por ventana antes de volcar a disco (0 = sin volcado) */
+    int log_preload_lines;      /* Líneas de log a precargar al abrir una ventana (0 = no precargar) */
+    int log_queue_kb;           /* Memoria de la cola del logger */
+    int log_flush_ms;           /* Intervalo de escritura de los logs (0 = inmediato) */
+    int log_fsync;              /* Segundos entre fsync de cada log (0 = nunca) */
+    bool log_compress;          /* Comprimir con gzip los logs de días cerrados */
+    int log_max_open;           /* Archivos de log abiertos a la vez (pool LRU) */
+    LogFormat log_format;       /* Formato de los logs: texto o JSON lines */
+    int max_fps;                /* Frames por segundo máximos al redibujar (0 = sin límite) */
+    int list_cache_ttl;         /* Segundos de validez de la caché de /list (0 = sin caché) */
+    SplitMode split_mode;       /* División inicial de la pantalla */
+    int split_panes;            /* Paneles iniciales si hay división (2..MAX_PANES) */
     char autojoin_channels[MAX_AUTOJOIN_CHANNELS][MAX_CHANNEL_LEN];
     int autojoin_count;
     char notify_nicks[MAX_NOTIFY_NICKS][MAX_NICK_LEN];
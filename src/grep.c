@@ -0,0 +1,825 @@
+#include "grep.h"
+#include "logger.h"
+#include "buffer.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <regex.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+/* Archivo a buscar */
+typedef struct {
+    char path[LOG_PATH_MAX];
+    char label[256];            /* Nombre sin extensión (encabeza cada resultado) */
+    int date;                   /* AAAAMMDD */
+    bool json;
+    bool compressed;
+    bool session;               /* Log por sesión de versiones anteriores: puede abarcar varios días */
+    bool check_time;            /* Día de un extremo: comprobar la hora de cada línea */
+} GrepFile;
+
+/* Tarea: tramo [start, end) de un archivo (un .gz es siempre una tarea entera) */
+typedef struct {
+    int file;
+    off_t start;
+    off_t end;
+} GrepTask;
+
+/* Parte de las tareas de un hilo: tasks[next..end) */
+typedef struct {
+    atomic_size_t next;
+    size_t end;
+} GrepShare;
+
+/* Coincidencia pendiente de mostrar */
+typedef struct GrepResult {
+    struct GrepResult *next;
+    int file;
+    char line[];
+} GrepResult;
+
+/* Estado de un hilo de búsqueda */
+typedef struct {
+    int index;
+    pthread_t thread;
+    regex_t regex;              /* Copia propia (regexec serializa una compartida) */
+    char line[LOG_MAX_RECORD + 1];
+    LogEntry entry;
+    int day;                    /* Día en curso (AAAAMMDD) del log por sesión que se lee */
+} GrepWorker;
+
+#define GREP_PIPE_BLOCK (1024 * 1024)   /* Lectura de gzip -dc */
+
+/* Búsqueda en curso (solo una a la vez) */
+static GrepOptions options;
+static bool running = false;
+static int target_window = -1;
+static GrepFile *files = NULL;
+static int file_count = 0;
+static GrepTask *tasks = NULL;
+static size_t task_count = 0;
+static GrepShare shares[GREP_MAX_THREADS];
+static int share_count = 0;             /* Partes de tareas (fijo mientras hay hilos) */
+static GrepWorker workers[GREP_MAX_THREADS];
+static int thread_count = 0;
+static regex_t ui_regex;                /* Para resaltar en la interfaz */
+static struct timespec started;
+static int since_day = 0;
+static int until_day = 0;
+
+/* Texto buscado sin distinguir mayúsculas (Boyer-Moore-Horspool) */
+typedef struct {
+    unsigned char needle[sizeof(options.pattern) * 6];
+    size_t len;
+    size_t skip[256];
+} GrepMatcher;
+
+static unsigned char fold[256];
+static GrepMatcher text_matcher;
+static GrepMatcher json_matcher;        /* El mismo texto escapado como en los .jsonl */
+
+/* Compartido con los hilos */
+static atomic_bool cancelled;
+static atomic_bool notified;            /* Hay un aviso en el pipe sin atender */
+static atomic_int active_workers;
+static atomic_int match_count;
+static atomic_ullong scanned_bytes;
+static pthread_mutex_t result_lock = PTHREAD_MUTEX_INITIALIZER;
+static GrepResult *result_head = NULL;
+static GrepResult *result_tail = NULL;
+static int notify_pipe[2] = { -1, -1 };
+
+/* Día de una hora como AAAAMMDD */
+static int grep_day(time_t when) {
+    struct tm tm_info;
+    localtime_r(&when, &tm_info);
+    return (tm_info.tm_year + 1900) * 10000 + (tm_info.tm_mon + 1) * 100 + tm_info.tm_mday;
+}
+
+/* Preparar la tabla de saltos del texto buscado */
+static void matcher_init(GrepMatcher *m, const char *pattern) {
+    for (int c = 0; c < 256; c++) {
+        fold[c] = (unsigned char)tolower(c);
+    }
+
+    m->len = strlen(pattern);
+    for (size_t i = 0; i < m->len; i++) {
+        m->needle[i] = fold[(unsigned char)pattern[i]];
+    }
+    for (int c = 0; c < 256; c++) {
+        m->skip[c] = m->len;
+    }
+    for (size_t i = 0; i + 1 < m->len; i++) {
+        m->skip[m->needle[i]] = m->len - 1 - i;
+    }
+}
+
+/* Primera aparición del texto buscado en data (o NULL) */
+static const char *matcher_find(const GrepMatcher *m, const char *data, size_t len) {
+    const unsigned char *hay = (const unsigned char *)data;
+    size_t last = m->len - 1;
+    size_t i = 0;
+
+    while (i + m->len <= len) {
+        size_t j = last;
+        while (fold[hay[i + j]] == m->needle[j]) {
+            if (j == 0) return data + i;
+            j--;
+        }
+        i += m->skip[fold[hay[i + last]]];
+    }
+    return NULL;
+}
+
+/* Primera coincidencia de la regex en data (o NULL) */
+static const char *regex_find(GrepWorker *worker, const char *data, size_t len) {
+    regmatch_t match;
+    match.rm_so = 0;
+    match.rm_eo = (regoff_t)len;
+    if (regexec(&worker->regex, data, 1, &match, REG_STARTEND) != 0) return NULL;
+    return data + match.rm_so;
+}
+
+/* Avisar a la interfaz (un byte en el pipe por tanda de resultados) */
+static void grep_notify(void) {
+    if (atomic_exchange(&notified, true)) return;
+    ssize_t n = write(notify_pipe[1], "g", 1);
+    (void)n;
+}
+
+/* Encolar una coincidencia para la interfaz */
+static void grep_push(int file, const char *line) {
+    if (atomic_fetch_add(&match_count, 1) >= GREP_MAX_RESULTS) {
+        atomic_store(&cancelled, true);
+        return;
+    }
+
+    size_t len = strlen(line);
+    GrepResult *result = malloc(sizeof(GrepResult) + len + 1);
+    if (!result) return;
+    result->next = NULL;
+    result->file = file;
+    memcpy(result->line, line, len + 1);
+
+    pthread_mutex_lock(&result_lock);
+    if (result_tail) {
+        result_tail->next = result;
+    } else {
+        result_head = result;
+    }
+    result_tail = result;
+    pthread_mutex_unlock(&result_lock);
+
+    grep_notify();
+}
+
+/* Hora de una línea de log de texto ([HH:MM:SS] del día dado, AAAAMMDD) */
+static bool grep_text_time(int date, const char *line, time_t *when) {
+    int hour, minute, second;
+    if (sscanf(line, "[%d:%d:%d]", &hour, &minute, &second) != 3) return false;
+
+    struct tm tm_info;
+    memset(&tm_info, 0, sizeof(tm_info));
+    tm_info.tm_year = date / 10000 - 1900;
+    tm_info.tm_mon = date / 100 % 100 - 1;
+    tm_info.tm_mday = date % 100;
+    tm_info.tm_hour = hour;
+    tm_info.tm_min = minute;
+    tm_info.tm_sec = second;
+    tm_info.tm_isdst = -1;
+    *when = mktime(&tm_info);
+    return true;
+}
+
+/* Comprobar una línea candidata y encolarla */
+static void grep_match(GrepWorker *worker, int file_index, const char *start, size_t len) {
+    const GrepFile *file = &files[file_index];
+    if (len > LOG_MAX_RECORD) len = LOG_MAX_RECORD;
+    memcpy(worker->line, start, len);
+    worker->line[len] = '\0';
+
+    time_t when = 0;
+    bool has_time = false;
+
+    if (file->json) {
+        /* Buscar de nuevo en la línea ya interpretada (descarta coincidencias
+         * en los nombres de los campos) */
+        LogEntry *entry = &worker->entry;
+        if (!logfile_parse_json(worker->line, entry)) return;
+        logfile_format_entry(entry, worker->line, sizeof(worker->line));
+        len = strlen(worker->line);
+        bool found = options.use_regex ? regex_find(worker, worker->line, len) != NULL
+                                       : matcher_find(&text_matcher, worker->line, len) != NULL;
+        if (!found) return;
+        when = entry->when;
+        has_time = true;
+    } else if (file->check_time) {
+        has_time = grep_text_time(file->session ? worker->day : file->date, worker->line, &when);
+    }
+
+    if (file->check_time && has_time) {
+        if (options.since > 0 && when < options.since) return;
+        if (options.until > 0 && when > options.until) return;
+    } else if (file->session && file->check_time) {
+        /* Marcas y líneas sin hora: basta con el día */
+        if (since_day && worker->day < since_day) return;
+        if (until_day && worker->day > until_day) return;
+    }
+
+    grep_push(file_index, worker->line);
+}
+
+/* Seguir en [data, data + len) las marcas de día de un log por sesión
+ * ("=== Sesión iniciada: DD/MM/AAAA", "=== Cambio de día: DD/MM/AAAA ===")
+ * Son pocas, así que se buscan con memmem en el hueco entre coincidencias.
+ */
+static void grep_session_day(GrepWorker *worker, const char *data, size_t len) {
+    const char *end = data + len;
+    const char *p = data;
+    const char *mark;
+
+    while ((mark = memmem(p, (size_t)(end - p), "=== ", 4)) != NULL) {
+        p = mark + 4;
+        if (mark > data && mark[-1] != '\n') continue;
+
+        /* Copia acotada: el tramo no acaba en '\0' */
+        char text[64];
+        const char *nl = memchr(mark, '\n', (size_t)(end - mark));
+        size_t n = (size_t)((nl ? nl : end) - mark);
+        if (n >= sizeof(text)) n = sizeof(text) - 1;
+        memcpy(text, mark, n);
+        text[n] = '\0';
+
+        int day, month, year;
+        if (sscanf(text, "=== Cambio de día: %d/%d/%d", &day, &month, &year) == 3 ||
+            sscanf(text, "=== Sesión iniciada: %d/%d/%d", &day, &month, &year) == 3) {
+            worker->day = (year * 100 + month) * 100 + day;
+        }
+    }
+}
+
+/* Buscar en un tramo de líneas completas: se busca en todo el tramo de una
+ * vez y solo se recorta la línea de cada coincidencia. En los .jsonl el
+ * texto se busca escapado como lo guarda el logger y grep_match lo comprueba
+ * ya interpretado; una regex no se puede escapar, así que ahí se interpreta
+ * cada línea */
+static void grep_scan(GrepWorker *worker, int file_index, const char *data, size_t len) {
+    size_t pos = 0;
+    bool json = files[file_index].json;
+    const GrepMatcher *matcher = json ? &json_matcher : &text_matcher;
+
+    if (json && options.use_regex) {
+        while (pos < len && !atomic_load_explicit(&cancelled, memory_order_relaxed)) {
+            const char *end = memchr(data + pos, '\n', len - pos);
+            size_t line_len = end ? (size_t)(end - (data + pos)) : len - pos;
+            if (line_len > 0) grep_match(worker, file_index, data + pos, line_len);
+            pos += line_len + 1;
+        }
+        atomic_fetch_add_explicit(&scanned_bytes, len, memory_order_relaxed);
+        return;
+    }
+
+    while (pos < len && !atomic_load_explicit(&cancelled, memory_order_relaxed)) {
+        const char *found = options.use_regex ? regex_find(worker, data + pos, len - pos)
+                                              : matcher_find(matcher, data + pos, len - pos);
+        if (!found) break;
+
+        const char *line = found;
+        while (line > data + pos && line[-1] != '\n') {
+            line--;
+        }
+        const char *end = memchr(found, '\n', (size_t)(data + len - found));
+        if (!end) end = data + len;
+
+        /* En un log por sesión, el día lo da la última marca anterior
+         * (o la propia línea, si es una marca) */
+        if (files[file_index].session && files[file_index].check_time) {
+            grep_session_day(worker, data + pos, (size_t)(end - (data + pos)));
+        }
+
+        grep_match(worker, file_index, line, (size_t)(end - line));
+        pos = (size_t)(end - data) + 1;
+    }
+    atomic_fetch_add_explicit(&scanned_bytes, len, memory_order_relaxed);
+}
+
+/* Tarea sobre un archivo sin comprimir, proyectado con mmap
+ * El tramo empieza en la primera línea que empieza dentro de él y acaba al
+ * final de la línea que cruza su final, así cada línea la ve una sola tarea.
+ */
+static void grep_mapped(GrepWorker *worker, const GrepTask *task) {
+    const GrepFile *file = &files[task->file];
+    int fd = open(file->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return;
+    }
+
+    size_t size = (size_t)st.st_size;
+    const char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return;
+
+    size_t start = (size_t)task->start;
+    size_t end = (task->end < 0 || (size_t)task->end > size) ? size : (size_t)task->end;
+
+    if (start > 0 && start < size && map[start - 1] != '\n') {
+        const char *nl = memchr(map + start, '\n', size - start);
+        start = nl ? (size_t)(nl - map) + 1 : size;
+    }
+    if (end < size && map[end - 1] != '\n') {
+        const char *nl = memchr(map + end, '\n', size - end);
+        end = nl ? (size_t)(nl - map) + 1 : size;
+    }
+
+    if (start < end) {
+        worker->day = file->date;
+        madvise((void *)(map + (start & ~(size_t)4095)), end - (start & ~(size_t)4095), MADV_SEQUENTIAL);
+        grep_scan(worker, task->file, map + start, end - start);
+    }
+    munmap((void *)map, size);
+}
+
+/* Tarea sobre un día comprimido: se lee la salida de gzip -dc por bloques */
+static void grep_gzip(GrepWorker *worker, const GrepTask *task) {
+    const GrepFile *file = &files[task->file];
+    int pipefd[2];
+    if (pipe2(pipefd, O_CLOEXEC) != 0) return;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t none;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, pipefd[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawnattr_init(&attr);
+    sigemptyset(&none);
+    posix_spawnattr_setsigmask(&attr, &none);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+
+    char *argv[] = { "gzip", "-dc", "--", (char *)file->path, NULL };
+    pid_t pid;
+    int err = posix_spawnp(&pid, "gzip", &actions, &attr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    close(pipefd[1]);
+
+    char *block = (err == 0) ? malloc(GREP_PIPE_BLOCK) : NULL;
+    size_t kept = 0;
+
+    while (block && !atomic_load_explicit(&cancelled, memory_order_relaxed)) {
+        ssize_t n = read(pipefd[0], block + kept, GREP_PIPE_BLOCK - kept);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (kept > 0) grep_scan(worker, task->file, block, kept);
+            break;
+        }
+
+        /* Buscar en las líneas completas y guardar el resto para el siguiente bloque */
+        size_t total = kept + (size_t)n;
+        const char *nl = memrchr(block, '\n', total);
+        size_t complete = nl ? (size_t)(nl - block) + 1 : total;
+        grep_scan(worker, task->file, block, complete);
+        kept = total - complete;
+        memmove(block, block + complete, kept);
+    }
+
+    free(block);
+    close(pipefd[0]);
+    if (err == 0) {
+        if (atomic_load(&cancelled)) kill(pid, SIGTERM);
+        while (waitpid(pid, NULL, 0) < 0 && errno == EINTR) {
+        }
+    }
+}
+
+/* Siguiente tarea de un hilo: primero las suyas, luego roba de los demás */
+static const GrepTask *grep_next_task(int self) {
+    for (int k = 0; k < share_count; k++) {
+        GrepShare *share = &shares[(self + k) % share_count];
+        if (atomic_load_explicit(&share->next, memory_order_relaxed) >= share->end) continue;
+
+        size_t next = atomic_fetch_add(&share->next, 1);
+        if (next < share->end) return &tasks[next];
+    }
+    return NULL;
+}
+
+/* Bucle de un hilo de búsqueda */
+static void *grep_worker(void *arg) {
+    GrepWorker *worker = arg;
+    const GrepTask *task;
+
+    while (!atomic_load(&cancelled) && (task = grep_next_task(worker->index)) != NULL) {
+        if (files[task->file].compressed) {
+            grep_gzip(worker, task);
+        } else {
+            grep_mapped(worker, task);
+        }
+    }
+
+    /* El último en acabar avisa para que la interfaz cierre la búsqueda */
+    if (atomic_fetch_sub(&active_workers, 1) == 1) {
+        grep_notify();
+    }
+    return NULL;
+}
+
+/* Reconocer un log (diario o por sesión) y su prefijo */
+static bool grep_parse_name(const char *name, size_t *prefix_len, int *date, bool *json, bool *compressed,
+                            bool *daily) {
+    LogFileName info;
+    *daily = logfile_parse_name(name, &info);
+    if (*daily) {
+        *prefix_len = info.prefix_len;
+        *date = info.date;
+        *json = info.format == LOG_FORMAT_JSONL;
+        *compressed = info.compressed;
+        return true;
+    }
+
+    /* Formato por sesión de versiones anteriores: prefijo_DD-MM-YY_HH:MM.txt */
+    size_t len = strlen(name);
+    int day, month, year, hour, minute;
+    if (len < 20 || name[len - 19] != '_' || strcmp(name + len - 4, ".txt") != 0 ||
+        sscanf(name + len - 18, "%2d-%2d-%2d_%2d:%2d", &day, &month, &year, &hour, &minute) != 5) {
+        return false;
+    }
+    *prefix_len = len - 19;
+    *date = (2000 + year) * 10000 + month * 100 + day;
+    *json = false;
+    *compressed = false;
+    return true;
+}
+
+/* ¿Es el prefijo de un log el de la ventana pedida? (#canal, nick o el
+ * prefijo tal cual: canal_x, privado_x) */
+static bool grep_window_match(const char *name, size_t prefix_len) {
+    if (options.window[0] == '\0') return true;
+
+    char want[MAX_CHANNEL_LEN * 2];
+    if (options.window[0] == '#') {
+        snprintf(want, sizeof(want), "canal_%s", options.window + 1);
+        return strlen(want) == prefix_len && strncasecmp(name, want, prefix_len) == 0;
+    }
+
+    snprintf(want, sizeof(want), "privado_%s", options.window);
+    if (strlen(want) == prefix_len && strncasecmp(name, want, prefix_len) == 0) return true;
+    return strlen(options.window) == prefix_len && strncasecmp(name, options.window, prefix_len) == 0;
+}
+
+/* Ordenar los archivos del día más reciente al más antiguo */
+static int compare_grep_files(const void *a, const void *b) {
+    const GrepFile *fa = a;
+    const GrepFile *fb = b;
+    if (fa->date != fb->date) return (fa->date < fb->date) - (fa->date > fb->date);
+    return strcmp(fa->label, fb->label);
+}
+
+/* Reunir los logs que cumplen la ventana y las fechas */
+static void grep_collect_files(const char *logdir) {
+    DIR *dir = opendir(logdir);
+    if (!dir) return;
+
+    int capacity = 0;
+    struct dirent *dirent;
+    while ((dirent = readdir(dir)) != NULL) {
+        const char *name = dirent->d_name;
+        size_t prefix_len;
+        int date;
+        bool json, compressed, daily;
+
+        if (!grep_parse_name(name, &prefix_len, &date, &json, &compressed, &daily)) continue;
+        if (!grep_window_match(name, prefix_len)) continue;
+        if (until_day && date > until_day) continue;
+        /* Un log por sesión puede seguir en días posteriores a su nombre:
+         * se descarta solo si se escribió por última vez antes de --since */
+        if (since_day && date < since_day) {
+            struct stat st;
+            char path[LOG_PATH_MAX];
+            snprintf(path, sizeof(path), "%s/%s", logdir, name);
+            if (daily || (stat(path, &st) == 0 && st.st_mtime < options.since)) continue;
+        }
+
+        if (file_count == capacity) {
+            int new_capacity = capacity ? capacity * 2 : 64;
+            GrepFile *new_files = realloc(files, sizeof(GrepFile) * new_capacity);
+            if (!new_files) break;
+            files = new_files;
+            capacity = new_capacity;
+        }
+
+        GrepFile *file = &files[file_count++];
+        snprintf(file->path, sizeof(file->path), "%s/%s", logdir, name);
+        snprintf(file->label, sizeof(file->label), "%s", name);
+        char *dot = strchr(file->label + prefix_len, '.');
+        if (dot) *dot = '\0';
+        file->date = date;
+        file->json = json;
+        file->compressed = compressed;
+        file->session = !daily;
+        if (daily) {
+            file->check_time = (since_day && date == since_day) || (until_day && date == until_day);
+        } else {
+            file->check_time = since_day || until_day;
+        }
+    }
+    closedir(dir);
+
+    if (file_count > 1) {
+        qsort(files, file_count, sizeof(GrepFile), compare_grep_files);
+    }
+}
+
+/* Añadir una tarea */
+static bool grep_add_task(size_t *capacity, int file, off_t start, off_t end) {
+    if (task_count == *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 256;
+        GrepTask *new_tasks = realloc(tasks, sizeof(GrepTask) * new_capacity);
+        if (!new_tasks) return false;
+        tasks = new_tasks;
+        *capacity = new_capacity;
+    }
+    tasks[task_count].file = file;
+    tasks[task_count].start = start;
+    tasks[task_count].end = end;
+    task_count++;
+    return true;
+}
+
+/* Partir los archivos en tareas; en los días de los extremos el índice
+ * temporal acota el tramo a leer */
+static void grep_build_tasks(void) {
+    size_t capacity = 0;
+
+    for (int i = 0; i < file_count; i++) {
+        GrepFile *file = &files[i];
+        /* Un log por sesión con fechas se lee entero y en orden: el día de
+         * cada línea depende de las marcas anteriores */
+        if (file->compressed || (file->session && file->check_time)) {
+            if (!grep_add_task(&capacity, i, 0, -1)) return;
+            continue;
+        }
+
+        struct stat st;
+        if (stat(file->path, &st) != 0 || st.st_size == 0) continue;
+
+        off_t start = 0;
+        off_t end = -1;
+        if (file->check_time) {
+            logfile_index_range(file->path,
+                                file->date == since_day ? options.since : 0,
+                                file->date == until_day ? options.until : 0,
+                                &start, &end);
+        }
+        off_t limit = (end < 0) ? st.st_size : end;
+
+        /* El último tramo llega hasta el final actual del archivo (puede crecer) */
+        for (off_t pos = start; pos < limit; pos += GREP_CHUNK) {
+            off_t chunk_end = pos + GREP_CHUNK;
+            if (chunk_end >= limit) chunk_end = end;
+            if (!grep_add_task(&capacity, i, pos, chunk_end)) return;
+        }
+    }
+}
+
+/* Liberar el estado de una búsqueda ya parada */
+static void grep_cleanup(void) {
+    for (int i = 0; i < thread_count; i++) {
+        if (options.use_regex) {
+            regfree(&workers[i].regex);
+        }
+    }
+    if (options.use_regex) {
+        regfree(&ui_regex);
+    }
+    thread_count = 0;
+
+    pthread_mutex_lock(&result_lock);
+    while (result_head) {
+        GrepResult *next = result_head->next;
+        free(result_head);
+        result_head = next;
+    }
+    result_tail = NULL;
+    pthread_mutex_unlock(&result_lock);
+
+    free(files);
+    files = NULL;
+    file_count = 0;
+    free(tasks);
+    tasks = NULL;
+    task_count = 0;
+    running = false;
+}
+
+/* Parar la búsqueda en curso y esperar a sus hilos */
+static void grep_stop(void) {
+    if (!running) return;
+
+    atomic_store(&cancelled, true);
+    for (int i = 0; i < thread_count; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    grep_cleanup();
+}
+
+/* Empezar una búsqueda (para la anterior si sigue en curso)
+ * Los resultados se añaden a la ventana window_id desde grep_poll().
+ */
+bool grep_start(const GrepOptions *search, int window_id) {
+    if (!search || search->pattern[0] == '\0') return false;
+
+    grep_stop();
+
+    if (notify_pipe[0] < 0 && pipe2(notify_pipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+        notify_pipe[0] = notify_pipe[1] = -1;
+        return false;
+    }
+
+    options = *search;
+    if (options.use_regex) {
+        if (regcomp(&ui_regex, options.pattern, REG_EXTENDED | REG_ICASE) != 0) return false;
+    } else {
+        char escaped[sizeof(json_matcher.needle) + 1];
+        escaped[logfile_json_escape(escaped, options.pattern)] = '\0';
+        matcher_init(&text_matcher, options.pattern);
+        matcher_init(&json_matcher, escaped);
+    }
+
+    char logdir[512];
+    if (!logger_dir(logdir, sizeof(logdir))) {
+        if (options.use_regex) regfree(&ui_regex);
+        return false;
+    }
+
+    running = true;
+    target_window = window_id;
+    since_day = options.since > 0 ? grep_day(options.since) : 0;
+    until_day = options.until > 0 ? grep_day(options.until) : 0;
+    atomic_store(&cancelled, false);
+    atomic_store(&notified, false);
+    atomic_store(&match_count, 0);
+    atomic_store(&scanned_bytes, 0);
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    grep_collect_files(logdir);
+    grep_build_tasks();
+
+    /* Un hilo por procesador (sin pasar del número de tareas) */
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    thread_count = (int)(cpus > 0 ? cpus : 1);
+    if (thread_count > GREP_MAX_THREADS) thread_count = GREP_MAX_THREADS;
+    if ((size_t)thread_count > task_count) thread_count = (int)task_count;
+
+    /* Repartir las tareas en tramos seguidos, uno por hilo */
+    share_count = thread_count;
+    for (int i = 0; i < share_count; i++) {
+        atomic_store(&shares[i].next, task_count * (size_t)i / (size_t)share_count);
+        shares[i].end = task_count * (size_t)(i + 1) / (size_t)share_count;
+    }
+
+    /* Los hilos no atienden señales (SIGWINCH...) */
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+
+    int started_threads = 0;
+    atomic_store(&active_workers, thread_count);
+    for (int i = 0; i < thread_count; i++) {
+        GrepWorker *worker = &workers[i];
+        worker->index = i;
+        if (options.use_regex &&
+            regcomp(&worker->regex, options.pattern, REG_EXTENDED | REG_ICASE | REG_NEWLINE) != 0) {
+            break;
+        }
+        if (pthread_create(&worker->thread, NULL, grep_worker, worker) != 0) {
+            if (options.use_regex) regfree(&worker->regex);
+            break;
+        }
+        started_threads++;
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    /* Si faltan hilos, sus tareas las roban los que arrancaron */
+    atomic_fetch_sub(&active_workers, thread_count - started_threads);
+    thread_count = started_threads;
+
+    /* Sin tareas (o sin hilos): terminar en la próxima vuelta */
+    if (thread_count == 0) {
+        grep_notify();
+    }
+    return true;
+}
+
+/* Pedir que la búsqueda en curso termine (grep_poll() la cierra) */
+void grep_cancel(void) {
+    if (running) {
+        atomic_store(&cancelled, true);
+    }
+}
+
+bool grep_running(void) {
+    return running;
+}
+
+/* Descriptor que se vuelve legible cuando hay resultados (-1 sin búsqueda) */
+int grep_fd(void) {
+    return running ? notify_pipe[0] : -1;
+}
+
+/* Pasar a la ventana de resultados las coincidencias encontradas y, si los
+ * hilos han terminado, cerrar la búsqueda con un resumen */
+void grep_poll(WindowManager *wm) {
+    if (!running) return;
+
+    char drain[64];
+    while (read(notify_pipe[0], drain, sizeof(drain)) > 0) {
+    }
+    atomic_store(&notified, false);
+
+    /* Los hilos encolan antes de darse por terminados */
+    bool done = atomic_load(&active_workers) == 0;
+
+    pthread_mutex_lock(&result_lock);
+    GrepResult *list = result_head;
+    result_head = result_tail = NULL;
+    pthread_mutex_unlock(&result_lock);
+
+    Window *win = wm_get_window(wm, target_window);
+    if (!win || win->type != WIN_GREP) {
+        win = NULL;
+        atomic_store(&cancelled, true);
+    }
+
+    while (list) {
+        GrepResult *next = list->next;
+        if (win) {
+            /* Resaltar la coincidencia como /search */
+            char msg[LOG_MAX_RECORD + 512];
+            int start, end;
+            const regex_t *regex = options.use_regex ? &ui_regex : NULL;
+            if (buffer_match_span(list->line, options.pattern, regex, &start, &end)) {
+                snprintf(msg, sizeof(msg), ANSI_GRAY "[%s]" ANSI_RESET " %.*s" ANSI_REVERSE "%.*s" ANSI_NO_REVERSE "%s",
+                         files[list->file].label, start, list->line, end - start, list->line + start,
+                         list->line + end);
+            } else {
+                snprintf(msg, sizeof(msg), ANSI_GRAY "[%s]" ANSI_RESET " %s", files[list->file].label, list->line);
+            }
+            wm_add_message(wm, target_window, msg);
+        }
+        free(list);
+        list = next;
+    }
+
+    if (!done) return;
+
+    for (int i = 0; i < thread_count; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    if (win) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long ms = (now.tv_sec - started.tv_sec) * 1000 + (now.tv_nsec - started.tv_nsec) / 1000000;
+        int matches = atomic_load(&match_count);
+        const char *note = "";
+        if (matches > GREP_MAX_RESULTS) {
+            note = ANSI_YELLOW " (hay más, se muestran las primeras)" ANSI_CYAN;
+        } else if (atomic_load(&cancelled)) {
+            note = ANSI_YELLOW " (cancelada)" ANSI_CYAN;
+        }
+
+        char msg[MAX_MSG_LEN];
+        snprintf(msg, sizeof(msg),
+                 ANSI_CYAN "--- %d coincidencias%s en %d archivos: %llu KB en %ld ms con %d hilos ---" ANSI_RESET,
+                 matches > GREP_MAX_RESULTS ? GREP_MAX_RESULTS : matches, note, file_count,
+                 atomic_load(&scanned_bytes) / 1024, ms, thread_count);
+        wm_add_message(wm, target_window, msg);
+    }
+    grep_cleanup();
+}
+
+/* Parar la búsqueda y liberar el pipe (al salir) */
+void grep_shutdown(void) {
+    grep_stop();
+    if (notify_pipe[0] >= 0) {
+        close(notify_pipe[0]);
+        close(notify_pipe[1]);
+        notify_pipe[0] = notify_pipe[1] = -1;
+    }
+}
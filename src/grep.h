@@ -0,0 +1,37 @@
+#ifndef GREP_H
+#define GREP_H
+
+#include "common.h"
+#include "windows.h"
+#include <time.h>
+
+/* Búsqueda en los logs de ~/.irclogs (/grep)
+ * Los archivos se reparten en tareas (tramos de unos GREP_CHUNK bytes de
+ * archivos proyectados con mmap, o un .gz entero leído de gzip -dc) entre
+ * varios hilos. Cada hilo empieza por su parte de las tareas y, al
+ * acabarla, roba de las partes de los demás. Las coincidencias se pasan a
+ * la interfaz por una cola y un pipe que vigila el select() del bucle
+ * principal, así aparecen según se encuentran y la búsqueda se puede parar.
+ */
+
+#define GREP_MAX_THREADS 8
+#define GREP_MAX_RESULTS 1000           /* Coincidencias mostradas como máximo */
+#define GREP_CHUNK (4 * 1024 * 1024)    /* Bytes por tarea */
+
+/* Opciones de una búsqueda */
+typedef struct {
+    char pattern[256];
+    bool use_regex;                     /* Regex extendida (si no, texto) */
+    char window[MAX_CHANNEL_LEN];       /* Solo los logs de esta ventana ("" = todos) */
+    time_t since;                       /* Desde esta hora (0 = sin límite) */
+    time_t until;                       /* Hasta esta hora (0 = sin límite) */
+} GrepOptions;
+
+bool grep_start(const GrepOptions *options, int window_id);
+void grep_cancel(void);
+bool grep_running(void);
+int grep_fd(void);
+void grep_poll(WindowManager *wm);
+void grep_shutdown(void);
+
+#endif /* GREP_H */
@@ -252,6 +252,11 @@ int input_read_key(void) {
             return KEY_ALT_PERIOD;
         }
 
+        /* Alt + A (ESC seguido de a) */
+        if (seq[0] == 'a' || seq[0] == 'A') {
+            return KEY_ALT_A;
+        }
+
         if (read(STDIN_FILENO, &seq[1], 1) != 1) return KEY_ESC;
 
         if (seq[0] == '[') {
@@ -32,6 +32,7 @@ typedef enum {
     KEY_CTRL_K = 11,
     KEY_CTRL_U = 21,
     KEY_CTRL_L = 12,
+    KEY_CTRL_W = 23,
     KEY_CTRL_C = 3
 } SpecialKeys;
 
@@ -79,7 +80,8 @@ typedef enum {
     KEY_ALT_7,
     KEY_ALT_8,
     KEY_ALT_9,
-    KEY_ALT_PERIOD
+    KEY_ALT_PERIOD,
+    KEY_ALT_A
 } KeyCode;
 
 /* Leer tecla del terminal */
@@ -18,6 +18,11 @@ IRCConnection* irc_create(void) {
     irc->last_pong = 0;
     irc->recv_buffer[0] = '\0';
     irc->recv_buffer_len = 0;
+    irc->elist_users = false;
+    irc->elist_mask = false;
+    irc->safelist = false;
+    irc->channel_total = 0;
+    irc->session = 0;
 
     return irc;
 }
@@ -82,6 +87,13 @@ int irc_connect(IRCConnection *irc, const char *server, int port) {
     irc->last_ping = time(NULL);
     irc->last_pong = time(NULL);
 
+    /* ISUPPORT es por servidor: se vuelve a leer del 005 */
+    irc->elist_users = false;
+    irc->elist_mask = false;
+    irc->safelist = false;
+    irc->channel_total = 0;
+    irc->session++;
+
     return 0;
 }
 
@@ -268,5 +280,39 @@ void irc_process_message(IRCConnection *irc, const char *message, void *user_dat
 
         irc_pong(irc, server);
         irc->last_ping = time(NULL);
+        return;
+    }
+
+    /* Saltar el prefijo y leer el numérico */
+    if (msg_copy[0] != ':') return;
+    char *ptr = strchr(msg_copy, ' ');
+    if (!ptr) return;
+    ptr++;
+
+    if (strncmp(ptr, "005 ", 4) == 0) {
+        /* RPL_ISUPPORT: :server 005 nick TOKEN[=valor] ... :are supported by this server */
+        char *saveptr = NULL;
+        char *token = strtok_r(ptr + 4, " ", &saveptr);   /* nick */
+        if (token) token = strtok_r(NULL, " ", &saveptr);
+        for (; token && token[0] != ':'; token = strtok_r(NULL, " ", &saveptr)) {
+            if (strncmp(token, "ELIST=", 6) == 0) {
+                irc->elist_users = strpbrk(token + 6, "Uu") != NULL;
+                irc->elist_mask = strpbrk(token + 6, "Mm") != NULL;
+            } else if (strcmp(token, "-ELIST") == 0) {
+                irc->elist_users = false;
+                irc->elist_mask = false;
+            } else if (strcmp(token, "SAFELIST") == 0) {
+                irc->safelist = true;
+            } else if (strcmp(token, "-SAFELIST") == 0) {
+                irc->safelist = false;
+            }
+        }
+    } else if (strncmp(ptr, "254 ", 4) == 0) {
+        /* RPL_LUSERCHANNELS: :server 254 nick <n> :channels formed */
+        char nick[MAX_NICK_LEN];
+        int total = 0;
+        if (sscanf(ptr + 4, "%31s %d", nick, &total) == 2 && total > 0) {
+            irc->channel_total = total;
+        }
     }
 }
@@ -19,6 +19,12 @@ typedef struct {
     time_t last_pong;
     char recv_buffer[8192];  /* Buffer para mensajes parciales */
     int recv_buffer_len;     /* Cantidad de datos en el buffer */
+    /* ISUPPORT (005) relevante para LIST */
+    bool elist_users;        /* ELIST=U: LIST >n,<n */
+    bool elist_mask;         /* ELIST=M: LIST con máscara */
+    bool safelist;           /* SAFELIST: LIST completo sin riesgo de desconexión */
+    int channel_total;       /* Canales en la red según RPL_LUSERCHANNELS (254), 0 si no se sabe */
+    unsigned int session;    /* Cambia en cada conexión (invalida la caché de /list) */
 } IRCConnection;
 
 /* Funciones de conexión IRC */
@@ -0,0 +1,406 @@
+#include "logfile.h"
+#include "width.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Extensión de los archivos de cada formato */
+const char* logfile_extension(LogFormat format) {
+    return format == LOG_FORMAT_JSONL ? ".jsonl" : ".txt";
+}
+
+/* Interpretar el nombre de un log diario: prefijo_AAAA-MM-DD.txt o .jsonl,
+ * opcionalmente comprimido (.gz). Los logs por sesión de versiones
+ * anteriores (prefijo_DD-MM-YY_HH:MM.txt) no se aceptan.
+ */
+bool logfile_parse_name(const char *name, LogFileName *info) {
+    size_t len = strlen(name);
+    bool compressed = len > 3 && strcmp(name + len - 3, ".gz") == 0;
+    if (compressed) len -= 3;
+
+    LogFormat format;
+    size_t ext_len;
+    if (len > 4 && strncmp(name + len - 4, ".txt", 4) == 0) {
+        format = LOG_FORMAT_TEXT;
+        ext_len = 4;
+    } else if (len > 6 && strncmp(name + len - 6, ".jsonl", 6) == 0) {
+        format = LOG_FORMAT_JSONL;
+        ext_len = 6;
+    } else {
+        return false;
+    }
+
+    /* _AAAA-MM-DD justo antes de la extensión */
+    if (len < ext_len + 12) return false;
+    const char *date = name + len - ext_len - 10;
+    if (date[-1] != '_' || date[4] != '-' || date[7] != '-') return false;
+    for (int i = 0; i < 10; i++) {
+        if (i != 4 && i != 7 && !isdigit((unsigned char)date[i])) return false;
+    }
+
+    if (info) {
+        info->prefix_len = (size_t)(date - 1 - name);
+        info->date = atoi(date) * 10000 + atoi(date + 5) * 100 + atoi(date + 8);
+        info->format = format;
+        info->compressed = compressed;
+    }
+    return true;
+}
+
+/* Ruta del índice de un log: la del archivo sin comprimir más .idx */
+bool logfile_index_path(const char *log_path, char *dest, size_t size) {
+    size_t len = strlen(log_path);
+    if (len > 3 && strcmp(log_path + len - 3, ".gz") == 0) len -= 3;
+
+    int n = snprintf(dest, size, "%.*s.idx", (int)len, log_path);
+    return n > 0 && (size_t)n < size;
+}
+
+/* Copiar len bytes quitando los códigos ANSI; dest debe tener len + 1 bytes.
+ * Devuelve la longitud del resultado (terminado en '\0').
+ */
+size_t logfile_clean(char *dest, const char *src, size_t len) {
+    size_t j = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (src[i] == '\033' && i + 1 < len && src[i + 1] == '[') {
+            /* Saltar secuencia ANSI */
+            i += 2;
+            while (i < len && !isalpha((unsigned char)src[i])) {
+                i++;
+            }
+        } else {
+            dest[j++] = src[i];
+        }
+    }
+    dest[j] = '\0';
+    return j;
+}
+
+/* Deducir tipo y autor de un mensaje limpio por su forma
+ * Los mensajes los compone siempre el cliente: "<nick> texto" para los
+ * mensajes, "* texto" para entradas, salidas y cambios, y el resto son
+ * avisos del servidor o del cliente.
+ */
+void logfile_classify(const char *clean, LogEntry *entry) {
+    entry->sender[0] = '\0';
+
+    if (clean[0] == '<') {
+        const char *end = strstr(clean, "> ");
+        size_t nick_len = end ? (size_t)(end - clean - 1) : 0;
+        if (end && nick_len > 0 && nick_len < sizeof(entry->sender) && !memchr(clean + 1, ' ', nick_len)) {
+            memcpy(entry->sender, clean + 1, nick_len);
+            entry->sender[nick_len] = '\0';
+            snprintf(entry->kind, sizeof(entry->kind), "msg");
+            snprintf(entry->text, sizeof(entry->text), "%s", end + 2);
+            return;
+        }
+    } else if (clean[0] == '*' && clean[1] == ' ') {
+        size_t nick_len = strcspn(clean + 2, " ");
+        if (nick_len < sizeof(entry->sender)) {
+            memcpy(entry->sender, clean + 2, nick_len);
+            entry->sender[nick_len] = '\0';
+        }
+        snprintf(entry->kind, sizeof(entry->kind), "event");
+        snprintf(entry->text, sizeof(entry->text), "%s", clean + 2);
+        return;
+    }
+
+    snprintf(entry->kind, sizeof(entry->kind), "info");
+    snprintf(entry->text, sizeof(entry->text), "%s", clean);
+}
+
+/* Bytes máximos que ocupa una entrada en JSON (cada byte puede pasar a \u00XX) */
+size_t logfile_json_size(const LogEntry *entry) {
+    return (strlen(entry->window) + strlen(entry->sender) + strlen(entry->text)) * 6 + 96;
+}
+
+/* Escribir una cadena JSON (sin comillas ni '\0'); los bytes que no forman
+ * UTF-8 válido se guardan como \u00XX (se leen como Latin-1) */
+size_t logfile_json_escape(char *dest, const char *src) {
+    size_t j = 0;
+    size_t i = 0;
+
+    while (src[i]) {
+        unsigned char c = (unsigned char)src[i];
+
+        if (c == '"' || c == '\\') {
+            dest[j++] = '\\';
+            dest[j++] = (char)c;
+            i++;
+        } else if (c < 0x20) {
+            if (c == '\n') {
+                memcpy(dest + j, "\\n", 2);
+                j += 2;
+            } else if (c == '\t') {
+                memcpy(dest + j, "\\t", 2);
+                j += 2;
+            } else {
+                j += (size_t)sprintf(dest + j, "\\u%04x", c);
+            }
+            i++;
+        } else if (c < 0x80) {
+            dest[j++] = (char)c;
+            i++;
+        } else {
+            uint32_t cp;
+            int n = utf8_decode(src + i, &cp);
+            bool literal = n == 3 && c == 0xEF && (unsigned char)src[i + 1] == 0xBF &&
+                           (unsigned char)src[i + 2] == 0xBD;
+            if (cp != 0xFFFD || literal) {
+                memcpy(dest + j, src + i, (size_t)n);
+                j += (size_t)n;
+                i += (size_t)n;
+            } else {
+                j += (size_t)sprintf(dest + j, "\\u%04x", c);
+                i++;
+            }
+        }
+    }
+    return j;
+}
+
+/* Codificar una entrada como una línea JSON (con '\n'); dest debe tener
+ * logfile_json_size() bytes. Devuelve la longitud escrita.
+ */
+size_t logfile_encode_json(char *dest, const LogEntry *entry) {
+    size_t j = (size_t)sprintf(dest, "{\"t\":%lld,\"w\":\"", (long long)entry->when);
+    j += logfile_json_escape(dest + j, entry->window);
+    j += (size_t)sprintf(dest + j, "\",\"k\":\"%s\"", entry->kind);
+
+    if (entry->sender[0]) {
+        memcpy(dest + j, ",\"n\":\"", 6);
+        j += 6;
+        j += logfile_json_escape(dest + j, entry->sender);
+        dest[j++] = '"';
+    }
+    if (entry->text[0]) {
+        memcpy(dest + j, ",\"m\":\"", 6);
+        j += 6;
+        j += logfile_json_escape(dest + j, entry->text);
+        dest[j++] = '"';
+    }
+
+    memcpy(dest + j, "}\n", 3);
+    return j + 2;
+}
+
+/* Añadir un codepoint en UTF-8 */
+static size_t utf8_encode(char *dest, uint32_t cp) {
+    if (cp < 0x80) {
+        dest[0] = (char)cp;
+        return 1;
+    } else if (cp < 0x800) {
+        dest[0] = (char)(0xC0 | (cp >> 6));
+        dest[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    } else if (cp < 0x10000) {
+        dest[0] = (char)(0xE0 | (cp >> 12));
+        dest[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        dest[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    dest[0] = (char)(0xF0 | (cp >> 18));
+    dest[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    dest[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    dest[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+/* Leer 4 dígitos hexadecimales */
+static bool json_hex4(const char *p, uint32_t *value) {
+    *value = 0;
+    for (int i = 0; i < 4; i++) {
+        if (!isxdigit((unsigned char)p[i])) return false;
+        *value = (*value << 4) | (uint32_t)(isdigit((unsigned char)p[i]) ? p[i] - '0' : (tolower((unsigned char)p[i]) - 'a' + 10));
+    }
+    return true;
+}
+
+/* Leer una cadena JSON que empieza en *p (en la comilla); se recorta a size */
+static bool json_string(const char **p, char *dest, size_t size) {
+    const char *s = *p;
+    if (*s != '"') return false;
+    s++;
+
+    size_t j = 0;
+    while (*s && *s != '"') {
+        char buf[4];
+        size_t n = 1;
+        buf[0] = *s;
+
+        if (*s == '\\') {
+            s++;
+            switch (*s) {
+                case 'n': buf[0] = '\n'; break;
+                case 't': buf[0] = '\t'; break;
+                case 'r': buf[0] = '\r'; break;
+                case 'b': buf[0] = '\b'; break;
+                case 'f': buf[0] = '\f'; break;
+                case '"': case '\\': case '/': buf[0] = *s; break;
+                case 'u': {
+                    uint32_t cp;
+                    if (!json_hex4(s + 1, &cp)) return false;
+                    s += 4;
+                    /* Pareja de sustitutos */
+                    uint32_t low;
+                    if (cp >= 0xD800 && cp < 0xDC00 && s[1] == '\\' && s[2] == 'u' &&
+                        json_hex4(s + 3, &low) && low >= 0xDC00 && low < 0xE000) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        s += 6;
+                    }
+                    n = utf8_encode(buf, cp);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        s++;
+
+        if (j + n < size) {
+            memcpy(dest + j, buf, n);
+            j += n;
+        }
+    }
+    if (*s != '"') return false;
+
+    if (size > 0) dest[j] = '\0';
+    *p = s + 1;
+    return true;
+}
+
+/* Interpretar una línea de un log .jsonl */
+bool logfile_parse_json(const char *line, LogEntry *entry) {
+    memset(entry, 0, sizeof(LogEntry));
+
+    const char *p = line;
+    while (isspace((unsigned char)*p)) p++;
+    if (*p++ != '{') return false;
+
+    bool has_time = false;
+    while (*p && *p != '}') {
+        char key[8];
+        if (!json_string(&p, key, sizeof(key)) || *p++ != ':') return false;
+
+        if (*p == '"') {
+            char *dest = NULL;
+            size_t size = 0;
+            char skip[2];
+            if (strcmp(key, "w") == 0) {
+                dest = entry->window;
+                size = sizeof(entry->window);
+            } else if (strcmp(key, "k") == 0) {
+                dest = entry->kind;
+                size = sizeof(entry->kind);
+            } else if (strcmp(key, "n") == 0) {
+                dest = entry->sender;
+                size = sizeof(entry->sender);
+            } else if (strcmp(key, "m") == 0) {
+                dest = entry->text;
+                size = sizeof(entry->text);
+            } else {
+                dest = skip;    /* Campo desconocido: se ignora */
+                size = 1;
+            }
+            if (!json_string(&p, dest, size)) return false;
+        } else {
+            char *end;
+            long long value = strtoll(p, &end, 10);
+            if (end == p) return false;
+            if (strcmp(key, "t") == 0) {
+                entry->when = (time_t)value;
+                has_time = true;
+            }
+            p = end;
+        }
+
+        if (*p == ',') p++;
+    }
+    return *p == '}' && has_time && entry->kind[0];
+}
+
+/* Escribir una entrada con el formato de los logs de texto */
+int logfile_format_entry(const LogEntry *entry, char *dest, size_t size) {
+    struct tm tm_info;
+    localtime_r(&entry->when, &tm_info);
+
+    if (strcmp(entry->kind, "open") == 0 || strcmp(entry->kind, "close") == 0) {
+        return snprintf(dest, size, "=== Sesión %s: %02d/%02d/%04d %02d:%02d:%02d ===",
+                        entry->kind[0] == 'o' ? "iniciada" : "cerrada",
+                        tm_info.tm_mday, tm_info.tm_mon + 1, tm_info.tm_year + 1900,
+                        tm_info.tm_hour, tm_info.tm_min, tm_info.tm_sec);
+    }
+    if (strcmp(entry->kind, "day") == 0) {
+        return snprintf(dest, size, "=== Cambio de día: %02d/%02d/%04d ===",
+                        tm_info.tm_mday, tm_info.tm_mon + 1, tm_info.tm_year + 1900);
+    }
+
+    if (strcmp(entry->kind, "msg") == 0) {
+        return snprintf(dest, size, "[%02d:%02d:%02d] <%s> %s",
+                        tm_info.tm_hour, tm_info.tm_min, tm_info.tm_sec, entry->sender, entry->text);
+    }
+    return snprintf(dest, size, "[%02d:%02d:%02d] %s%s",
+                    tm_info.tm_hour, tm_info.tm_min, tm_info.tm_sec,
+                    strcmp(entry->kind, "event") == 0 ? "* " : "", entry->text);
+}
+
+/* Buscar en el índice (count entradas) la primera entrada de un minuto
+ * posterior a minute; devuelve su número (count si no hay ninguna) y en
+ * before la posición de la anterior (0 si no hay) */
+static size_t index_search(int fd, size_t count, int64_t minute, off_t *before) {
+    size_t low = 0;
+    size_t high = count;
+    *before = 0;
+
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        LogIndexEntry entry;
+        if (pread(fd, &entry, sizeof(entry), (off_t)(mid * sizeof(entry))) != (ssize_t)sizeof(entry)) break;
+        if (entry.when / 60 <= minute) {
+            *before = (off_t)entry.offset;
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/* Tramo de un log con las líneas entre since y until (0 = sin límite)
+ * start es la primera línea del minuto de since y end la del minuto
+ * siguiente a until (-1 = hasta el final). Se busca en el índice con pread;
+ * sin índice el tramo es el archivo entero. Las líneas de los minutos de los
+ * extremos hay que comprobarlas aparte.
+ */
+bool logfile_index_range(const char *log_path, time_t since, time_t until, off_t *start, off_t *end) {
+    *start = 0;
+    *end = -1;
+
+    char path[1024];
+    if (!logfile_index_path(log_path, path, sizeof(path))) return false;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0;
+    if (ok) {
+        size_t count = (size_t)st.st_size / sizeof(LogIndexEntry);
+        off_t before;
+
+        if (since > 0) {
+            index_search(fd, count, (int64_t)since / 60, start);
+        }
+        if (until > 0) {
+            size_t next = index_search(fd, count, (int64_t)until / 60, &before);
+            LogIndexEntry entry;
+            if (next < count && pread(fd, &entry, sizeof(entry), (off_t)(next * sizeof(entry))) == (ssize_t)sizeof(entry)) {
+                *end = (off_t)entry.offset;
+            }
+        }
+    }
+
+    close(fd);
+    return ok;
+}
@@ -0,0 +1,70 @@
+#ifndef LOGFILE_H
+#define LOGFILE_H
+
+#include "common.h"
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+/* Formato de los archivos de ~/.irclogs
+ * Cada log tiene un archivo por día en texto (base_AAAA-MM-DD.txt) o en
+ * JSON lines (base_AAAA-MM-DD.jsonl, un objeto por línea), más un índice
+ * temporal (mismo nombre terminado en .idx) con la posición de la primera
+ * línea de cada minuto. Los escribe el hilo del logger; la precarga y las
+ * búsquedas los leen sin recorrer los archivos enteros.
+ *
+ * JSON lines: {"t":1729330000,"w":"#canal","k":"msg","n":"alice","m":"hola"}
+ *   t: hora (epoch), w: ventana, k: tipo, n: autor (si lo hay), m: texto
+ *   tipos: open, close, day (marcas de sesión y de día), msg (<nick> texto),
+ *   event (* texto: entradas, salidas...) e info (el resto)
+ */
+
+#define LOG_MAX_RECORD 4096             /* Bytes máximos de una línea de log */
+#define LOG_KIND_LEN 8
+
+typedef enum {
+    LOG_FORMAT_TEXT,
+    LOG_FORMAT_JSONL
+} LogFormat;
+
+/* Una línea de log ya interpretada */
+typedef struct {
+    time_t when;
+    char kind[LOG_KIND_LEN];
+    char window[MAX_CHANNEL_LEN];
+    char sender[MAX_NICK_LEN];
+    char text[LOG_MAX_RECORD + 1];
+} LogEntry;
+
+/* Entrada del índice temporal (primera línea de un minuto) */
+typedef struct {
+    int64_t when;
+    uint64_t offset;
+} LogIndexEntry;
+
+/* Nombre de un archivo diario: prefijo_AAAA-MM-DD.ext[.gz] */
+typedef struct {
+    size_t prefix_len;                  /* Bytes antes de _AAAA-MM-DD */
+    int date;                           /* AAAAMMDD */
+    LogFormat format;
+    bool compressed;
+} LogFileName;
+
+/* Nombres de archivo */
+const char* logfile_extension(LogFormat format);
+bool logfile_parse_name(const char *name, LogFileName *info);
+bool logfile_index_path(const char *log_path, char *dest, size_t size);
+
+/* Escritura (hilo del logger) */
+size_t logfile_clean(char *dest, const char *src, size_t len);
+void logfile_classify(const char *clean, LogEntry *entry);
+size_t logfile_json_size(const LogEntry *entry);
+size_t logfile_encode_json(char *dest, const LogEntry *entry);
+size_t logfile_json_escape(char *dest, const char *src);   /* dest: 6 bytes por byte de src */
+
+/* Lectura */
+bool logfile_parse_json(const char *line, LogEntry *entry);
+int logfile_format_entry(const LogEntry *entry, char *dest, size_t size);
+bool logfile_index_range(const char *log_path, time_t since, time_t until, off_t *start, off_t *end);
+
+#endif /* LOGFILE_H */
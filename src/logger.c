@@ -0,0 +1,949 @@
+#include "logger.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+/* Tipos de registro de la cola */
+enum {
+    LOG_REC_OPEN,               /* Texto: ruta base (sin fecha ni extensión), '\0' y ventana */
+    LOG_REC_LINE,               /* Texto: mensaje (con códigos ANSI) */
+    LOG_REC_CLOSE               /* Sin texto */
+};
+
+/* Cabecera de un registro (le sigue el texto, sin '\0') */
+typedef struct {
+    time_t when;
+    uint32_t len;
+    uint16_t type;
+    uint16_t id;
+} LogRecord;
+
+/* Archivo de log abierto (solo lo usa el hilo escritor) */
+typedef struct {
+    char *base;                 /* Ruta base; NULL si el slot está libre */
+    char *name;                 /* Ventana (campo "w" del formato JSON) */
+    int fd;                     /* Archivo del día (-1 si está cerrado) */
+    int day;                    /* Día del archivo como AAAAMMDD */
+    bool day_open;              /* Día empezado (con su marca); el fd lo abre el pool */
+    unsigned long last_used;    /* Última escritura (para cerrar el menos usado) */
+    off_t size;                 /* Bytes ya escritos en el archivo */
+    char *batch;                /* Texto pendiente de escribir */
+    size_t batch_len;
+    size_t batch_capacity;
+    LogIndexEntry *index;       /* Entradas del índice pendientes de escribir */
+    int index_count;
+    int index_capacity;
+    int64_t index_minute;       /* Último minuto con entrada en el índice */
+    bool unsynced;              /* Hay datos escritos sin fsync */
+    time_t last_sync;
+} LogFile;
+
+/* Una línea o una apertura solo se encolan si después siguen cabiendo los
+ * cierres de todos los archivos, así un cierre nunca se pierde */
+#define LOG_CLOSE_RESERVE (LOG_MAX_FILES * sizeof(LogRecord))
+
+/* Lote máximo que se conserva entre vaciados (el resto se libera) */
+#define LOG_BATCH_KEEP (256 * 1024)
+
+/* Cola circular: head solo lo avanza la interfaz y tail solo el escritor */
+static unsigned char *ring = NULL;
+static size_t ring_size = 0;            /* Potencia de 2 */
+static atomic_size_t ring_head;
+static atomic_size_t ring_tail;
+
+/* Hilo escritor */
+static pthread_t writer_thread;
+static pthread_mutex_t writer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writer_wake = PTHREAD_COND_INITIALIZER;
+static bool writer_running = false;
+static atomic_bool writer_stop;
+static atomic_bool wake_pending;        /* Hay un aviso al escritor en curso */
+static int flush_interval_ms = DEFAULT_LOG_FLUSH_MS;
+static int fsync_interval = DEFAULT_LOG_FSYNC;
+static LogFormat log_format = LOG_FORMAT_TEXT;
+static LogFile files[LOG_MAX_FILES];
+static LogEntry writer_entry;           /* Línea en curso (formato JSON) */
+static int writer_today = 0;            /* Día (AAAAMMDD) de la última comprobación */
+static int pool_size = DEFAULT_LOG_MAX_OPEN;
+static int pool_open = 0;               /* Archivos con el fd abierto */
+static unsigned long pool_tick = 0;
+
+/* Hilo compresor: recorre el directorio de logs al arrancar y tras cada
+ * medianoche, y comprime los días que el escritor ya ha cerrado */
+static pthread_t compress_thread;
+static pthread_mutex_t compress_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t compress_wake = PTHREAD_COND_INITIALIZER;
+static bool compress_started = false;
+static bool compress_running = false;   /* Acepta peticiones (gzip disponible) */
+static bool compress_stop = false;
+static bool compress_pending = false;   /* Hay un recorrido pedido */
+static int compress_before = 0;         /* Comprimir días anteriores a este (AAAAMMDD) */
+static char compress_dir[512];
+
+/* Estado del lado de la interfaz */
+static bool slot_used[LOG_MAX_FILES];
+static unsigned long long stat_queued = 0;
+static unsigned long long stat_dropped = 0;
+
+/* Contadores del escritor */
+static atomic_ullong stat_written;
+static atomic_ulong stat_writes;
+static atomic_ulong stat_flushes;
+static atomic_ulong stat_fsyncs;
+static atomic_ulong stat_rotations;
+static atomic_ulong stat_compressed;
+static atomic_int stat_open_files;
+static atomic_ulong stat_opens;
+static atomic_ulong stat_evictions;
+
+/* Copiar a la cola desde la posición pos (dando la vuelta al final) */
+static void ring_put(size_t pos, const void *data, size_t len) {
+    size_t offset = pos & (ring_size - 1);
+    size_t first = ring_size - offset;
+    if (first > len) first = len;
+    memcpy(ring + offset, data, first);
+    memcpy(ring, (const unsigned char *)data + first, len - first);
+}
+
+/* Copiar de la cola desde la posición pos */
+static void ring_get(size_t pos, void *data, size_t len) {
+    size_t offset = pos & (ring_size - 1);
+    size_t first = ring_size - offset;
+    if (first > len) first = len;
+    memcpy(data, ring + offset, first);
+    memcpy((unsigned char *)data + first, ring, len - first);
+}
+
+/* Despertar al escritor (como mucho un aviso pendiente a la vez) */
+static void writer_signal(void) {
+    if (atomic_exchange(&wake_pending, true)) return;
+    pthread_mutex_lock(&writer_lock);
+    pthread_cond_signal(&writer_wake);
+    pthread_mutex_unlock(&writer_lock);
+}
+
+/* Encolar un registro dejando libres al menos reserve bytes */
+static bool ring_push(const LogRecord *rec, const char *text, size_t reserve) {
+    size_t head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring_tail, memory_order_acquire);
+    size_t need = sizeof(LogRecord) + rec->len;
+
+    if (ring_size - (head - tail) < need + reserve) return false;
+
+    ring_put(head, rec, sizeof(LogRecord));
+    if (rec->len > 0) {
+        ring_put(head + sizeof(LogRecord), text, rec->len);
+    }
+    atomic_store_explicit(&ring_head, head + need, memory_order_release);
+
+    /* Sin esperar al intervalo si la cola pasa de la mitad */
+    if (flush_interval_ms == 0 || head + need - tail > ring_size / 2) {
+        writer_signal();
+    }
+    return true;
+}
+
+/* Asegurar sitio para extra bytes más en el lote de un archivo */
+static bool batch_reserve(LogFile *file, size_t extra) {
+    if (file->batch_len + extra <= file->batch_capacity) return true;
+
+    size_t capacity = file->batch_capacity ? file->batch_capacity : 4096;
+    while (capacity < file->batch_len + extra) {
+        capacity *= 2;
+    }
+    char *batch = realloc(file->batch, capacity);
+    if (!batch) return false;
+    file->batch = batch;
+    file->batch_capacity = capacity;
+    return true;
+}
+
+/* Añadir texto con formato al lote (marcas de sesión y horas) */
+static void batch_printf(LogFile *file, const char *format, ...) {
+    if (!batch_reserve(file, 128)) return;
+
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(file->batch + file->batch_len, 128, format, args);
+    va_end(args);
+
+    if (n > 0) {
+        file->batch_len += (size_t)(n < 128 ? n : 127);
+    }
+}
+
+/* Añadir un mensaje al lote sin sus códigos ANSI, terminado en '\n' */
+static void batch_append_clean(LogFile *file, const char *src, size_t len) {
+    if (!batch_reserve(file, len + 1)) return;
+
+    char *dest = file->batch + file->batch_len;
+    size_t n = logfile_clean(dest, src, len);
+    dest[n] = '\n';
+    file->batch_len += n + 1;
+}
+
+/* Ruta de un archivo del día actual de un log con la extensión dada */
+static void writer_day_path(const LogFile *file, const char *ext, char *path, size_t size) {
+    snprintf(path, size, "%s_%04d-%02d-%02d%s",
+             file->base, file->day / 10000, file->day / 100 % 100, file->day % 100, ext);
+}
+
+/* Ruta del índice del día de un log (base_AAAA-MM-DD.txt.idx) */
+static void writer_index_path(const LogFile *file, char *path, size_t size) {
+    char ext[16];
+    snprintf(ext, sizeof(ext), "%s.idx", logfile_extension(log_format));
+    writer_day_path(file, ext, path, size);
+}
+
+/* Apuntar en el índice la primera línea de cada minuto (en la posición que
+ * ocupará al escribir el lote) */
+static void writer_index(LogFile *file, time_t when) {
+    int64_t minute = (int64_t)when / 60;
+    if (minute <= file->index_minute) return;
+
+    if (file->index_count == file->index_capacity) {
+        int capacity = file->index_capacity ? file->index_capacity * 2 : 16;
+        LogIndexEntry *index = realloc(file->index, sizeof(LogIndexEntry) * capacity);
+        if (!index) return;
+        file->index = index;
+        file->index_capacity = capacity;
+    }
+
+    LogIndexEntry *entry = &file->index[file->index_count++];
+    entry->when = (int64_t)when;
+    entry->offset = (uint64_t)file->size + file->batch_len;
+    file->index_minute = minute;
+}
+
+/* Añadir al índice del día las entradas pendientes (como mucho una por
+ * minuto: el archivo se abre solo para escribirlas) */
+static void writer_write_index(LogFile *file) {
+    char path[LOG_PATH_MAX];
+    writer_index_path(file, path, sizeof(path));
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        size_t len = sizeof(LogIndexEntry) * (size_t)file->index_count;
+        if (write(fd, file->index, len) == (ssize_t)len) {
+            atomic_fetch_add_explicit(&stat_writes, 1, memory_order_relaxed);
+        }
+        close(fd);
+    }
+    file->index_count = 0;
+}
+
+/* Ruta del archivo del día de un log */
+static void writer_log_path(const LogFile *file, char *path, size_t size) {
+    writer_day_path(file, logfile_extension(log_format), path, size);
+}
+
+/* Cerrar el fd de un archivo (los datos ya están escritos) */
+static void pool_release(LogFile *file) {
+    if (file->fd < 0) return;
+    close(file->fd);
+    file->fd = -1;
+    pool_open--;
+    atomic_fetch_sub_explicit(&stat_open_files, 1, memory_order_relaxed);
+}
+
+static void writer_write_file(LogFile *file, time_t now);
+
+/* Tener abierto (en modo append) el archivo del día de un log
+ * Con el pool lleno se cierra antes el archivo escrito hace más tiempo;
+ * su lote pendiente se escribe primero.
+ */
+static bool pool_acquire(LogFile *file, time_t now) {
+    file->last_used = ++pool_tick;
+    if (file->fd >= 0) return true;
+
+    while (pool_open >= pool_size) {
+        LogFile *oldest = NULL;
+        for (int i = 0; i < LOG_MAX_FILES; i++) {
+            if (files[i].fd >= 0 && &files[i] != file &&
+                (!oldest || files[i].last_used < oldest->last_used)) {
+                oldest = &files[i];
+            }
+        }
+        if (!oldest) break;
+
+        if (oldest->batch_len > 0 || oldest->index_count > 0) {
+            writer_write_file(oldest, now);
+        }
+        pool_release(oldest);
+        atomic_fetch_add_explicit(&stat_evictions, 1, memory_order_relaxed);
+    }
+
+    char path[LOG_PATH_MAX];
+    writer_log_path(file, path, sizeof(path));
+    file->fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (file->fd < 0) return false;
+
+    pool_open++;
+    atomic_fetch_add_explicit(&stat_open_files, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stat_opens, 1, memory_order_relaxed);
+    return true;
+}
+
+/* Escribir el lote de un archivo y sincronizarlo si toca */
+static void writer_write_file(LogFile *file, time_t now) {
+    /* Sin archivo el lote se descarta (como un error de escritura) */
+    if (!pool_acquire(file, now)) {
+        file->batch_len = 0;
+        file->index_count = 0;
+        return;
+    }
+
+    size_t done = 0;
+    while (done < file->batch_len) {
+        ssize_t n = write(file->fd, file->batch + done, file->batch_len - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        done += (size_t)n;
+        atomic_fetch_add_explicit(&stat_writes, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&stat_written, (unsigned long long)n, memory_order_relaxed);
+    }
+    if (done > 0) {
+        file->unsynced = true;
+    }
+
+    /* Un error de escritura descarta el lote (como hacía stdio) */
+    file->size += (off_t)done;
+    if (done < file->batch_len) {
+        file->size = lseek(file->fd, 0, SEEK_END);
+    }
+    file->batch_len = 0;
+    if (file->index_count > 0) {
+        writer_write_index(file);
+    }
+    if (file->batch_capacity > LOG_BATCH_KEEP) {
+        free(file->batch);
+        file->batch = NULL;
+        file->batch_capacity = 0;
+    }
+
+    if (file->unsynced && fsync_interval > 0 && now - file->last_sync >= fsync_interval) {
+        fdatasync(file->fd);
+        atomic_fetch_add_explicit(&stat_fsyncs, 1, memory_order_relaxed);
+        file->unsynced = false;
+        file->last_sync = now;
+    }
+}
+
+/* Terminar el día de un archivo escribiendo lo pendiente (reabre el
+ * archivo si el pool lo había cerrado y queda algo por escribir o por
+ * sincronizar) */
+static void writer_close_file(LogFile *file, time_t now) {
+    bool sync = file->unsynced && fsync_interval > 0;
+    if (fsync_interval > 0) {
+        file->last_sync = 0;    /* Sincronizar siempre al cerrar */
+    }
+    if (file->fd >= 0 || file->batch_len > 0 || file->index_count > 0 || sync) {
+        writer_write_file(file, now);
+    }
+    pool_release(file);
+    file->day_open = false;
+}
+
+/* Hora local de un registro (los mensajes seguidos suelen compartir segundo) */
+static const struct tm *writer_localtime(time_t when) {
+    static time_t cached_when = (time_t)-1;
+    static struct tm cached_tm;
+
+    if (when != cached_when) {
+        localtime_r(&when, &cached_tm);
+        cached_when = when;
+    }
+    return &cached_tm;
+}
+
+/* Día de una fecha como AAAAMMDD */
+static int day_key(const struct tm *tm_info) {
+    return (tm_info->tm_year + 1900) * 10000 + (tm_info->tm_mon + 1) * 100 + tm_info->tm_mday;
+}
+
+/* Empezar el día actual de un log (el archivo lo abre el pool al escribir) */
+static void writer_open_day(LogFile *file) {
+    char path[LOG_PATH_MAX];
+    writer_log_path(file, path, sizeof(path));
+
+    struct stat st;
+    file->size = stat(path, &st) == 0 ? st.st_size : 0;
+    file->day_open = true;
+    file->batch_len = 0;
+    file->unsynced = false;
+    file->last_sync = time(NULL);
+
+    /* Seguir el índice del día donde lo dejó la sesión anterior */
+    file->index_count = 0;
+    file->index_minute = -1;
+    writer_index_path(file, path, sizeof(path));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        LogIndexEntry last;
+        if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(last) &&
+            pread(fd, &last, sizeof(last), st.st_size - st.st_size % sizeof(last) - sizeof(last)) == sizeof(last)) {
+            file->index_minute = last.when / 60;
+        }
+        close(fd);
+    }
+}
+
+/* Añadir una marca de sesión o de día: open, close o day */
+static void writer_marker(LogFile *file, const char *kind, time_t when) {
+    LogEntry *entry = &writer_entry;
+    entry->when = when;
+    snprintf(entry->kind, sizeof(entry->kind), "%s", kind);
+    snprintf(entry->window, sizeof(entry->window), "%s", file->name);
+    entry->sender[0] = '\0';
+    entry->text[0] = '\0';
+
+    writer_index(file, when);
+    if (log_format == LOG_FORMAT_JSONL) {
+        if (!batch_reserve(file, logfile_json_size(entry))) return;
+        file->batch_len += logfile_encode_json(file->batch + file->batch_len, entry);
+        return;
+    }
+
+    /* En texto, una línea en blanco tras el cierre y el cambio de día */
+    if (!batch_reserve(file, 128)) return;
+    int n = logfile_format_entry(entry, file->batch + file->batch_len, 126);
+    if (n <= 0) return;
+    file->batch_len += (size_t)(n < 126 ? n : 125);
+    file->batch[file->batch_len++] = '\n';
+    if (strcmp(kind, "open") != 0) {
+        file->batch[file->batch_len++] = '\n';
+    }
+}
+
+/* Añadir una línea de la conversación */
+static void writer_line(LogFile *file, const char *text, size_t len, time_t when) {
+    writer_index(file, when);
+
+    if (log_format == LOG_FORMAT_JSONL) {
+        static char clean[LOG_MAX_RECORD + 1];
+        LogEntry *entry = &writer_entry;
+        logfile_clean(clean, text, len);
+        logfile_classify(clean, entry);
+        entry->when = when;
+        snprintf(entry->window, sizeof(entry->window), "%s", file->name);
+
+        if (!batch_reserve(file, logfile_json_size(entry))) return;
+        file->batch_len += logfile_encode_json(file->batch + file->batch_len, entry);
+        return;
+    }
+
+    /* Timestamp siempre en formato HH:MM:SS */
+    const struct tm *tm_info = writer_localtime(when);
+    batch_printf(file, "[%02d:%02d:%02d] ", tm_info->tm_hour, tm_info->tm_min, tm_info->tm_sec);
+    batch_append_clean(file, text, len);
+}
+
+/* Medianoche del día (AAAAMMDD) de un archivo */
+static time_t day_start(int day) {
+    struct tm tm_info;
+    memset(&tm_info, 0, sizeof(tm_info));
+    tm_info.tm_year = day / 10000 - 1900;
+    tm_info.tm_mon = day / 100 % 100 - 1;
+    tm_info.tm_mday = day % 100;
+    tm_info.tm_isdst = -1;
+    return mktime(&tm_info);
+}
+
+/* Cerrar el archivo de un día terminado; el siguiente se abre con la
+ * primera línea del día nuevo */
+static void writer_end_day(LogFile *file, int day, time_t now) {
+    if (file->day_open) {
+        writer_close_file(file, now);
+        atomic_fetch_add_explicit(&stat_rotations, 1, memory_order_relaxed);
+    }
+    file->day = day;
+}
+
+/* Pedir al compresor un recorrido del directorio de logs */
+static void compress_request(int before) {
+    pthread_mutex_lock(&compress_lock);
+    if (compress_running) {
+        compress_before = before;
+        compress_pending = true;
+        pthread_cond_signal(&compress_wake);
+    }
+    pthread_mutex_unlock(&compress_lock);
+}
+
+/* Pasar a medianoche al día nuevo también los logs sin líneas recientes */
+static void writer_check_day(time_t now) {
+    int today = day_key(writer_localtime(now));
+    if (today == writer_today) return;
+
+    for (int i = 0; i < LOG_MAX_FILES; i++) {
+        if (files[i].base && files[i].day < today) {
+            writer_end_day(&files[i], today, now);
+        }
+    }
+
+    /* Los días anteriores ya están cerrados: se pueden comprimir */
+    compress_request(today);
+    writer_today = today;
+}
+
+/* Aplicar un registro de la cola */
+static void writer_process(const LogRecord *rec, const char *text) {
+    if (rec->id >= LOG_MAX_FILES) return;
+
+    LogFile *file = &files[rec->id];
+    const struct tm *tm_info = writer_localtime(rec->when);
+
+    switch (rec->type) {
+        case LOG_REC_OPEN: {
+            size_t base_len = strlen(text);
+            free(file->base);
+            free(file->name);
+            file->base = strdup(text);
+            file->name = strdup(base_len < rec->len ? text + base_len + 1 : "");
+            if (!file->base || !file->name) {
+                free(file->base);
+                file->base = NULL;
+                break;
+            }
+
+            file->day = day_key(tm_info);
+            writer_open_day(file);
+            writer_marker(file, "open", rec->when);
+            break;
+        }
+
+        case LOG_REC_LINE: {
+            if (!file->base) break;
+
+            /* Una línea de un día nuevo cierra el archivo del anterior; las
+             * que lleguen tarde con fecha pasada van al archivo actual */
+            int day = day_key(tm_info);
+            if (day > file->day) {
+                writer_end_day(file, day, time(NULL));
+            }
+            if (!file->day_open) {
+                writer_open_day(file);
+                writer_marker(file, "day", day_start(file->day));
+            }
+
+            writer_line(file, text, rec->len, rec->when);
+            break;
+        }
+
+        case LOG_REC_CLOSE:
+            if (file->day_open) {
+                writer_marker(file, "close", rec->when);
+                writer_close_file(file, time(NULL));
+            }
+            free(file->base);
+            free(file->name);
+            file->base = NULL;
+            file->name = NULL;
+            break;
+    }
+}
+
+/* Vaciar la cola y escribir un lote por archivo */
+static void writer_flush(char *text) {
+    size_t tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring_head, memory_order_acquire);
+    if (tail == head) return;
+
+    while (tail != head) {
+        LogRecord rec;
+        ring_get(tail, &rec, sizeof(rec));
+        ring_get(tail + sizeof(rec), text, rec.len);
+        text[rec.len] = '\0';
+        tail += sizeof(rec) + rec.len;
+        atomic_store_explicit(&ring_tail, tail, memory_order_release);
+
+        writer_process(&rec, text);
+    }
+
+    time_t now = time(NULL);
+    for (int i = 0; i < LOG_MAX_FILES; i++) {
+        if (files[i].day_open && files[i].batch_len > 0) {
+            writer_write_file(&files[i], now);
+        }
+    }
+    atomic_fetch_add_explicit(&stat_flushes, 1, memory_order_relaxed);
+}
+
+/* Bucle del hilo escritor: esperar el intervalo (o un aviso) y vaciar */
+static void *writer_main(void *arg) {
+    (void)arg;
+    static char text[LOG_MAX_RECORD + 1];
+
+    pthread_mutex_lock(&writer_lock);
+    for (;;) {
+        bool stop = atomic_load(&writer_stop);
+        if (!stop && !atomic_load(&wake_pending)) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += flush_interval_ms / 1000;
+            deadline.tv_nsec += (long)(flush_interval_ms % 1000) * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&writer_wake, &writer_lock, &deadline);
+        }
+        pthread_mutex_unlock(&writer_lock);
+
+        atomic_store(&wake_pending, false);
+        writer_flush(text);
+        writer_check_day(time(NULL));
+
+        pthread_mutex_lock(&writer_lock);
+        if (stop) break;
+    }
+    pthread_mutex_unlock(&writer_lock);
+
+    /* Cerrar lo que siga abierto */
+    time_t now = time(NULL);
+    for (int i = 0; i < LOG_MAX_FILES; i++) {
+        if (files[i].day_open) {
+            writer_close_file(&files[i], now);
+        }
+        free(files[i].base);
+        free(files[i].name);
+        free(files[i].index);
+        files[i].base = NULL;
+        files[i].name = NULL;
+        files[i].index = NULL;
+        files[i].index_capacity = 0;
+        free(files[i].batch);
+        files[i].batch = NULL;
+        files[i].batch_capacity = 0;
+    }
+    return NULL;
+}
+
+/* Comprimir un archivo con gzip (deja archivo.gz y borra el original)
+ * La entrada y las salidas van a /dev/null: gzip no debe preguntar ni
+ * escribir en el terminal de la interfaz.
+ * Devuelve 0 si se comprimió, 1 si gzip falló y -1 si no se pudo ejecutar.
+ */
+static int compress_file(const char *path) {
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t none;
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    /* El hilo tiene todas las señales bloqueadas; gzip no las hereda */
+    posix_spawnattr_init(&attr);
+    sigemptyset(&none);
+    posix_spawnattr_setsigmask(&attr, &none);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+
+    char *argv[] = { "gzip", "-q", "--", (char *)path, NULL };
+    pid_t pid;
+    int err = posix_spawnp(&pid, "gzip", &actions, &attr, argv, environ);
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    if (err != 0) return -1;
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return 1;
+    }
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 127) return -1;
+    return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : 1;
+}
+
+/* Comprimir los logs diarios (nombre_AAAA-MM-DD.txt o .jsonl) anteriores a hoy
+ * Un archivo que gzip no puede comprimir (p. ej. ya existe su .gz) se deja
+ * como está. Devuelve false si gzip no se pudo ejecutar o hay que parar.
+ */
+static bool compress_sweep(int before) {
+    DIR *dir = opendir(compress_dir);
+    if (!dir) return true;
+
+    bool ok = true;
+    struct dirent *entry;
+    while (ok && (entry = readdir(dir)) != NULL) {
+        /* Solo el formato diario; los logs antiguos por sesión y los
+         * índices se dejan como están */
+        LogFileName info;
+        if (!logfile_parse_name(entry->d_name, &info) || info.compressed || info.date >= before) continue;
+
+        char path[LOG_PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", compress_dir, entry->d_name);
+        int result = compress_file(path);
+        if (result == 0) {
+            atomic_fetch_add_explicit(&stat_compressed, 1, memory_order_relaxed);
+        }
+
+        pthread_mutex_lock(&compress_lock);
+        ok = result >= 0 && !compress_stop;
+        pthread_mutex_unlock(&compress_lock);
+    }
+    closedir(dir);
+    return ok;
+}
+
+/* Bucle del hilo compresor: un recorrido por petición del escritor */
+static void *compress_main(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&compress_lock);
+    for (;;) {
+        while (!compress_stop && !compress_pending) {
+            pthread_cond_wait(&compress_wake, &compress_lock);
+        }
+        if (compress_stop) break;
+        compress_pending = false;
+        int before = compress_before;
+        pthread_mutex_unlock(&compress_lock);
+
+        bool ok = compress_sweep(before);
+
+        pthread_mutex_lock(&compress_lock);
+        if (!ok) break;
+    }
+    compress_running = false;
+    pthread_mutex_unlock(&compress_lock);
+    return NULL;
+}
+
+/* Directorio de los logs: ~/.irclogs */
+bool logger_dir(char *dest, size_t size) {
+    const char *home = getenv("HOME");
+    if (!home) return false;
+
+    int len = snprintf(dest, size, "%s/.irclogs", home);
+    return len > 0 && (size_t)len < size;
+}
+
+/* Arrancar el hilo compresor (sin señales, como el escritor) */
+static void compress_start(void) {
+    if (!logger_dir(compress_dir, sizeof(compress_dir))) return;
+
+    compress_stop = false;
+    compress_pending = false;
+    compress_running = true;
+
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    int err = pthread_create(&compress_thread, NULL, compress_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    compress_started = err == 0;
+    compress_running = compress_started;
+}
+
+/* Parar el hilo compresor (como mucho espera a que termine el gzip en curso) */
+static void compress_finish(void) {
+    if (!compress_started) return;
+
+    pthread_mutex_lock(&compress_lock);
+    compress_stop = true;
+    pthread_cond_signal(&compress_wake);
+    pthread_mutex_unlock(&compress_lock);
+    pthread_join(compress_thread, NULL);
+    compress_started = false;
+    compress_running = false;
+}
+
+/* Arrancar el hilo escritor
+ * queue_kb limita la memoria de la cola (se redondea a potencia de 2),
+ * flush_ms es el intervalo de escritura (0 = en cuanto haya líneas),
+ * fsync_seconds el tiempo mínimo entre fsync de un archivo (0 = nunca) y
+ * compress activa la compresión con gzip de los días cerrados, format
+ * elige texto o JSON lines para los archivos nuevos y max_open limita los
+ * archivos abiertos a la vez (el resto se reabre al escribir).
+ */
+bool logger_init(int queue_kb, int flush_ms, int fsync_seconds, bool compress, LogFormat format, int max_open) {
+    if (writer_running) return true;
+
+    size_t want = (size_t)(queue_kb > 0 ? queue_kb : DEFAULT_LOG_QUEUE_KB) * 1024;
+    if (want < 64 * 1024) want = 64 * 1024;
+    ring_size = 1;
+    while (ring_size < want) {
+        ring_size <<= 1;
+    }
+    ring = malloc(ring_size);
+    if (!ring) return false;
+
+    atomic_store(&ring_head, 0);
+    atomic_store(&ring_tail, 0);
+    atomic_store(&writer_stop, false);
+    atomic_store(&wake_pending, false);
+    atomic_store(&stat_written, 0);
+    atomic_store(&stat_writes, 0);
+    atomic_store(&stat_flushes, 0);
+    atomic_store(&stat_fsyncs, 0);
+    atomic_store(&stat_rotations, 0);
+    atomic_store(&stat_compressed, 0);
+    atomic_store(&stat_open_files, 0);
+    atomic_store(&stat_opens, 0);
+    atomic_store(&stat_evictions, 0);
+    flush_interval_ms = flush_ms >= 0 ? flush_ms : DEFAULT_LOG_FLUSH_MS;
+    fsync_interval = fsync_seconds >= 0 ? fsync_seconds : DEFAULT_LOG_FSYNC;
+    log_format = format;
+    pool_size = max_open > 0 ? max_open : DEFAULT_LOG_MAX_OPEN;
+    pool_open = 0;
+    pool_tick = 0;
+
+    for (int i = 0; i < LOG_MAX_FILES; i++) {
+        files[i].base = NULL;
+        files[i].name = NULL;
+        files[i].index = NULL;
+        files[i].index_count = 0;
+        files[i].index_capacity = 0;
+        files[i].fd = -1;
+        files[i].day_open = false;
+        files[i].last_used = 0;
+        files[i].batch = NULL;
+        files[i].batch_len = 0;
+        files[i].batch_capacity = 0;
+        slot_used[i] = false;
+    }
+
+    /* El compresor ya debe atender la primera petición del escritor */
+    writer_today = 0;
+    if (compress) {
+        compress_start();
+    }
+
+    /* Las señales (SIGWINCH...) las atiende siempre el hilo principal */
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    int err = pthread_create(&writer_thread, NULL, writer_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (err != 0) {
+        compress_finish();
+        free(ring);
+        ring = NULL;
+        return false;
+    }
+    writer_running = true;
+    return true;
+}
+
+/* Parar el hilo escritor tras escribir todo lo encolado */
+void logger_shutdown(void) {
+    if (!writer_running) return;
+
+    atomic_store(&writer_stop, true);
+    pthread_mutex_lock(&writer_lock);
+    pthread_cond_signal(&writer_wake);
+    pthread_mutex_unlock(&writer_lock);
+    pthread_join(writer_thread, NULL);
+
+    compress_finish();
+    writer_running = false;
+    free(ring);
+    ring = NULL;
+}
+
+/* Abrir un log; devuelve su identificador o -1
+ * base es la ruta sin fecha: el escritor añade _AAAA-MM-DD.txt (o .jsonl)
+ * y abre el archivo del día en modo append. name es la ventana que se
+ * guarda en cada línea del formato JSON.
+ */
+int logger_open(const char *base, const char *name, time_t when) {
+    if (!writer_running || !base || !name) return -1;
+
+    size_t base_len = strlen(base);
+    size_t name_len = strlen(name);
+    if (base_len + 16 > LOG_PATH_MAX || name_len >= MAX_CHANNEL_LEN) return -1;
+
+    /* Ruta base y ventana separadas por '\0' */
+    char text[LOG_PATH_MAX + MAX_CHANNEL_LEN];
+    memcpy(text, base, base_len + 1);
+    memcpy(text + base_len + 1, name, name_len);
+    size_t len = base_len + 1 + name_len;
+
+    for (int id = 0; id < LOG_MAX_FILES; id++) {
+        if (slot_used[id]) continue;
+
+        LogRecord rec = { when, (uint32_t)len, LOG_REC_OPEN, (uint16_t)id };
+        if (!ring_push(&rec, text, LOG_CLOSE_RESERVE)) return -1;
+        slot_used[id] = true;
+        return id;
+    }
+    return -1;
+}
+
+/* Encolar una línea para el log id (se descarta si la cola está llena) */
+void logger_write(int id, const char *msg, time_t when) {
+    if (!writer_running || id < 0 || id >= LOG_MAX_FILES || !slot_used[id] || !msg) return;
+
+    /* Recortar sin partir un carácter UTF-8 */
+    size_t len = strlen(msg);
+    if (len > LOG_MAX_RECORD) {
+        len = LOG_MAX_RECORD;
+        while (len > 0 && ((unsigned char)msg[len] & 0xC0) == 0x80) {
+            len--;
+        }
+    }
+
+    LogRecord rec = { when, (uint32_t)len, LOG_REC_LINE, (uint16_t)id };
+    if (ring_push(&rec, msg, LOG_CLOSE_RESERVE)) {
+        stat_queued++;
+    } else {
+        stat_dropped++;
+    }
+}
+
+/* Cerrar el log id (el escritor añade la marca de cierre) */
+void logger_close(int id, time_t when) {
+    if (!writer_running || id < 0 || id >= LOG_MAX_FILES || !slot_used[id]) return;
+
+    LogRecord rec = { when, 0, LOG_REC_CLOSE, (uint16_t)id };
+    ring_push(&rec, NULL, 0);
+    slot_used[id] = false;
+}
+
+/* Pedir al escritor que vacíe la cola ya */
+void logger_flush(void) {
+    if (!writer_running) return;
+    writer_signal();
+}
+
+/* Estadísticas del logger */
+void logger_get_stats(LoggerStats *stats) {
+    if (!stats) return;
+
+    memset(stats, 0, sizeof(LoggerStats));
+    stats->queued = stat_queued;
+    stats->dropped = stat_dropped;
+    if (!writer_running) return;
+
+    stats->written_bytes = atomic_load_explicit(&stat_written, memory_order_relaxed);
+    stats->writes = atomic_load_explicit(&stat_writes, memory_order_relaxed);
+    stats->flushes = atomic_load_explicit(&stat_flushes, memory_order_relaxed);
+    stats->fsyncs = atomic_load_explicit(&stat_fsyncs, memory_order_relaxed);
+    stats->rotations = atomic_load_explicit(&stat_rotations, memory_order_relaxed);
+    stats->compressed = atomic_load_explicit(&stat_compressed, memory_order_relaxed);
+    stats->open_files = atomic_load_explicit(&stat_open_files, memory_order_relaxed);
+    stats->max_open = pool_size;
+    stats->opens = atomic_load_explicit(&stat_opens, memory_order_relaxed);
+    stats->evictions = atomic_load_explicit(&stat_evictions, memory_order_relaxed);
+    stats->queue_used = atomic_load_explicit(&ring_head, memory_order_relaxed) -
+                        atomic_load_explicit(&ring_tail, memory_order_relaxed);
+    stats->queue_capacity = ring_size;
+}
@@ -0,0 +1,64 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include "common.h"
+#include "logfile.h"
+#include <time.h>
+
+/* Escritura asíncrona de los logs de conversación
+ * La interfaz solo copia cada línea en una cola circular sin bloqueos (un
+ * productor, un consumidor); un hilo escritor la vacía cada LOG_FLUSH_MS,
+ * agrupa las líneas por archivo y las escribe con un write() por archivo.
+ * El formato de las líneas (hora, marcas de sesión y cambio de día) y la
+ * limpieza de códigos ANSI se hacen en el hilo escritor.
+ *
+ * Cada log tiene un archivo por día: base_AAAA-MM-DD.txt (o .jsonl, ver
+ * logfile.h) y su índice temporal. El escritor pasa al archivo del día
+ * siguiente a medianoche y, con LOG_COMPRESS, un segundo hilo comprime con
+ * gzip los días ya cerrados (base_AAAA-MM-DD.txt.gz).
+ *
+ * Los descriptores de los archivos son un pool de LOG_MAX_OPEN como mucho:
+ * el escritor abre en modo append el archivo que va a escribir y, si el
+ * pool está lleno, cierra el escrito hace más tiempo.
+ */
+
+#define LOG_MAX_FILES MAX_WINDOWS       /* Logs abiertos a la vez (uno por ventana) */
+#define DEFAULT_LOG_QUEUE_KB 1024       /* Memoria de la cola */
+#define DEFAULT_LOG_FLUSH_MS 1000       /* Intervalo de escritura */
+#define DEFAULT_LOG_FSYNC 60            /* Segundos entre fsync de cada archivo (0 = nunca) */
+#define DEFAULT_LOG_COMPRESS false      /* Comprimir los días cerrados */
+#define DEFAULT_LOG_FORMAT LOG_FORMAT_TEXT
+#define DEFAULT_LOG_MAX_OPEN 16         /* Archivos de log abiertos a la vez */
+#define LOG_PATH_MAX 1024
+
+/* Estadísticas del logger */
+typedef struct {
+    unsigned long long queued;          /* Líneas encoladas */
+    unsigned long long dropped;         /* Líneas descartadas con la cola llena */
+    unsigned long long written_bytes;   /* Bytes escritos a disco */
+    unsigned long writes;               /* Llamadas a write */
+    unsigned long flushes;              /* Vaciados de la cola */
+    unsigned long fsyncs;
+    unsigned long rotations;            /* Cambios de archivo a medianoche */
+    unsigned long compressed;           /* Días comprimidos con gzip */
+    size_t queue_used;                  /* Bytes ocupados en la cola ahora */
+    size_t queue_capacity;
+    int open_files;                     /* Descriptores abiertos ahora */
+    int max_open;                       /* Tamaño del pool */
+    unsigned long opens;                /* Aperturas de archivos de log */
+    unsigned long evictions;            /* Cierres para hacer sitio en el pool */
+} LoggerStats;
+
+/* Arranque y parada (global para todas las ventanas) */
+bool logger_init(int queue_kb, int flush_ms, int fsync_seconds, bool compress, LogFormat format, int max_open);
+void logger_shutdown(void);
+bool logger_dir(char *dest, size_t size);
+
+/* Operaciones desde el hilo de la interfaz */
+int logger_open(const char *base, const char *name, time_t when);
+void logger_write(int id, const char *msg, time_t when);
+void logger_close(int id, time_t when);
+void logger_flush(void);
+void logger_get_stats(LoggerStats *stats);
+
+#endif /* LOGGER_H */
@@ -0,0 +1,146 @@
+#include "lz.h"
+#include <stdint.h>
+
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 12
+#define LZ_MAX_OFFSET 65535
+#define LZ_LAST_LITERALS 5      /* Los últimos bytes siempre van como literales */
+
+/* Leer 4 bytes sin requisitos de alineación */
+static uint32_t read32(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/* Hash multiplicativo de una secuencia de 4 bytes */
+static unsigned int hash4(uint32_t v) {
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Escribir la parte extendida de una longitud (bytes de 255 + resto) */
+static unsigned char* put_length(unsigned char *op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (unsigned char)len;
+    return op;
+}
+
+/* Escribir un token con sus literales; la longitud de match se añade aparte */
+static unsigned char* put_literals(unsigned char *op, const unsigned char *lit, size_t lit_len, size_t match_code) {
+    unsigned char *token = op++;
+    *token = (unsigned char)(((lit_len >= 15 ? 15 : lit_len) << 4) | (match_code >= 15 ? 15 : match_code));
+    if (lit_len >= 15) {
+        op = put_length(op, lit_len - 15);
+    }
+    memcpy(op, lit, lit_len);
+    return op + lit_len;
+}
+
+size_t lz_compress_bound(size_t len) {
+    return len + len / 255 + 16;
+}
+
+size_t lz_compress(const unsigned char *src, size_t len, unsigned char *dst, size_t dst_size) {
+    if (!src || !dst || dst_size < lz_compress_bound(len)) return 0;
+
+    uint32_t table[1 << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    unsigned char *op = dst;
+    size_t ip = 0;
+    size_t anchor = 0;
+
+    if (len > LZ_MIN_MATCH + LZ_LAST_LITERALS) {
+        size_t limit = len - LZ_LAST_LITERALS;
+
+        while (ip + LZ_MIN_MATCH <= limit) {
+            uint32_t seq = read32(src + ip);
+            unsigned int h = hash4(seq);
+            size_t candidate = table[h];
+            table[h] = (uint32_t)ip;
+
+            if (candidate < ip && ip - candidate <= LZ_MAX_OFFSET && read32(src + candidate) == seq) {
+                size_t match_len = LZ_MIN_MATCH;
+                while (ip + match_len < limit && src[candidate + match_len] == src[ip + match_len]) {
+                    match_len++;
+                }
+
+                size_t match_code = match_len - LZ_MIN_MATCH;
+                op = put_literals(op, src + anchor, ip - anchor, match_code);
+
+                size_t offset = ip - candidate;
+                *op++ = (unsigned char)(offset & 0xFF);
+                *op++ = (unsigned char)(offset >> 8);
+                if (match_code >= 15) {
+                    op = put_length(op, match_code - 15);
+                }
+
+                ip += match_len;
+                anchor = ip;
+            } else {
+                ip++;
+            }
+        }
+    }
+
+    /* Última secuencia: solo literales */
+    op = put_literals(op, src + anchor, len - anchor, 0);
+    return (size_t)(op - dst);
+}
+
+bool lz_decompress(const unsigned char *src, size_t len, unsigned char *dst, size_t raw_len) {
+    if (!src || !dst) return false;
+
+    size_t ip = 0;
+    size_t op = 0;
+
+    while (ip < len) {
+        unsigned char token = src[ip++];
+
+        /* Literales */
+        size_t lit_len = token >> 4;
+        if (lit_len == 15) {
+            unsigned char b;
+            do {
+                if (ip >= len) return false;
+                b = src[ip++];
+                lit_len += b;
+            } while (b == 255);
+        }
+        if (lit_len > len - ip || lit_len > raw_len - op) return false;
+        memcpy(dst + op, src + ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+
+        /* La última secuencia no lleva match */
+        if (ip == len) break;
+
+        if (len - ip < 2) return false;
+        size_t offset = (size_t)src[ip] | ((size_t)src[ip + 1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op) return false;
+
+        size_t match_len = token & 0x0F;
+        if (match_len == 15) {
+            unsigned char b;
+            do {
+                if (ip >= len) return false;
+                b = src[ip++];
+                match_len += b;
+            } while (b == 255);
+        }
+        match_len += LZ_MIN_MATCH;
+        if (match_len > raw_len - op) return false;
+
+        /* Copia byte a byte: el match puede solaparse con la salida */
+        for (size_t i = 0; i < match_len; i++) {
+            dst[op + i] = dst[op - offset + i];
+        }
+        op += match_len;
+    }
+
+    return op == raw_len;
+}
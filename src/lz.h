@@ -0,0 +1,20 @@
+#ifndef LZ_H
+#define LZ_H
+
+#include "common.h"
+
+/* Compresor LZ77 sencillo (formato de secuencias tipo LZ4)
+ * Pensado para bloques pequeños de texto: sin dependencias externas,
+ * compresión rápida y descompresión con verificación de límites.
+ */
+
+/* Tamaño máximo de salida para una entrada de len bytes */
+size_t lz_compress_bound(size_t len);
+
+/* Comprimir src en dst. Retorna el tamaño comprimido o 0 si dst es pequeño */
+size_t lz_compress(const unsigned char *src, size_t len, unsigned char *dst, size_t dst_size);
+
+/* Descomprimir exactamente raw_len bytes. Retorna false si los datos son inválidos */
+bool lz_decompress(const unsigned char *src, size_t len, unsigned char *dst, size_t raw_len);
+
+#endif /* LZ_H */
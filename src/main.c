@@ -6,6 +6,9 @@
 #include "commands.h"
 #include "input.h"
 #include "config.h"
+#include "logger.h"
+#include "clock.h"
+#include "grep.h"
 #include <signal.h>
 #include <sys/select.h>
 #include <unistd.h>
@@ -83,6 +86,7 @@ void process_irc_messages(IRCConnection *irc, WindowManager *wm, Config *config,
                             if (win->buffer) {
                                 win->buffer->enabled = config->buffer_enabled;
                             }
+                            window_preload_log(win, config->log_preload_lines);
                             if (config->log_enabled) {
                                 window_open_log(win);
                             }
@@ -146,6 +150,7 @@ void process_irc_messages(IRCConnection *irc, WindowManager *wm, Config *config,
 
                             /* Buscar ventana apropiada */
                             Window *dest_win = NULL;
+                            bool highlight = false;
 
                             /* Si el target es un canal */
                             if (target[0] == '#') {
@@ -158,8 +163,11 @@ void process_irc_messages(IRCConnection *irc, WindowManager *wm, Config *config,
                                 }
 
                                 /* Detectar mención del nick del usuario */
-                                if (mention_alert && irc->nick[0] != '\0' && strcasestr(msg_text, irc->nick)) {
-                                    *mention_alert = true;
+                                if (irc->nick[0] != '\0' && strcasestr(msg_text, irc->nick)) {
+                                    highlight = true;
+                                    if (mention_alert) {
+                                        *mention_alert = true;
+                                    }
                                 }
                             } else {
                                 /* Mensaje privado - buscar o crear ventana */
@@ -181,6 +189,7 @@ void process_irc_messages(IRCConnection *irc, WindowManager *wm, Config *config,
                                         if (dest_win->buffer) {
                                             dest_win->buffer->enabled = config->buffer_enabled;
                                         }
+                                        window_preload_log(dest_win, config->log_preload_lines);
                                         if (config->log_enabled) {
                                             window_open_log(dest_win);
                                         }
@@ -196,8 +205,8 @@ void process_irc_messages(IRCConnection *irc, WindowManager *wm, Config *config,
                                                                config->timestamp_enabled,
                                                                config->timestamp_format);
 
-                                /* Marcar actividad si no es la ventana activa */
-                                wm_mark_window_activity(wm, dest_win->id);
+                                /* Contar actividad si la ventana no está a la vista */
+                                wm_mark_window_activity(wm, dest_win->id, highlight);
                             }
                         }
                     }
@@ -258,6 +267,7 @@ void process_irc_messages(IRCConnection *irc, WindowManager *wm, Config *config,
                                     if (found_win->buffer) {
                                         found_win->buffer->enabled = config->buffer_enabled;
                                     }
+                                    window_preload_log(found_win, config->log_preload_lines);
                                     if (config->log_enabled) {
                                         window_open_log(found_win);
                                     }
@@ -510,45 +520,14 @@ void process_irc_messages(IRCConnection *irc, WindowManager *wm, Config *config,
                 Window *list_win = NULL;
                 for (int i = 0; i < MAX_WINDOWS; i++) {
                     Window *w = wm_get_window(wm, i);
-                    if (w && w->type == WIN_LIST && w->list_receiving) {
+                    if (w && w->type == WIN_LIST && (w->list_receiving || w->list_caching)) {
                         list_win = w;
                         break;
                     }
                 }
 
                 if (list_win) {
-                    char channel[MAX_CHANNEL_LEN] = "";
-                    int users = 0;
-                    char topic[512] = "";
-
-                    /* Parsear: :server 322 nick #canal users :topic */
-                    char *ptr = line;
-                    /* Saltar :server 322 nick */
-                    for (int i = 0; i < 3 && ptr; i++) {
-                        ptr = strchr(ptr, ' ');
-                        if (ptr) ptr++;
-                    }
-
-                    if (ptr) {
-                        /* Leer nombre del canal */
-                        if (sscanf(ptr, "%s %d", channel, &users) == 2) {
-                            /* Buscar topic después de ":" */
-                            char *topic_ptr = strstr(ptr, " :");
-                            if (topic_ptr) {
-                                topic_ptr += 2;  /* Saltar " :" */
-                                strncpy(topic, topic_ptr, sizeof(topic) - 1);
-                                topic[sizeof(topic) - 1] = '\0';
-                                /* Limpiar \r\n del topic */
-                                char *newline = strchr(topic, '\r');
-                                if (newline) *newline = '\0';
-                                newline = strchr(topic, '\n');
-                                if (newline) *newline = '\0';
-                            }
-
-                            /* Añadir canal a la lista */
-                            window_add_channel_to_list(list_win, channel, users, topic);
-                        }
-                    }
+                    window_add_list_reply(list_win, line);
                 }
             }
             /* End of LIST (323) */
@@ -557,7 +536,7 @@ void process_irc_messages(IRCConnection *irc, WindowManager *wm, Config *config,
                 Window *list_win = NULL;
                 for (int i = 0; i < MAX_WINDOWS; i++) {
                     Window *w = wm_get_window(wm, i);
-                    if (w && w->type == WIN_LIST && w->list_receiving) {
+                    if (w && w->type == WIN_LIST && (w->list_receiving || w->list_caching)) {
                         list_win = w;
                         break;
                     }
@@ -603,6 +582,7 @@ void process_irc_messages(IRCConnection *irc, WindowManager *wm, Config *config,
                         if (w && w->type == WIN_CHANNEL && strcmp(w->title, channel) == 0) {
                             strncpy(w->topic, topic, sizeof(w->topic) - 1);
                             w->topic[sizeof(w->topic) - 1] = '\0';
+                            w->redraw |= REDRAW_TITLE;
                             break;
                         }
                     }
@@ -628,11 +608,6 @@ int main(void) {
     term_init(&term);
     term_enter_raw_mode(&term);
 
-    WindowManager *wm = wm_create();
-    IRCConnection *irc = irc_create();
-    InputState input;
-    input_init(&input);
-
     /* Cargar configuración */
     Config *config = config_create();
     char config_path[512];
@@ -642,6 +617,21 @@ int main(void) {
         config_load(config, config_path);
     }
 
+    /* Volcado a disco del scrollback (antes de crear cualquier buffer) */
+    buffer_spill_init(config->buffer_mem_lines);
+
+    /* Hilo escritor de los logs */
+    logger_init(config->log_queue_kb, config->log_flush_ms, config->log_fsync, config->log_compress,
+                config->log_format, config->log_max_open);
+
+    /* Límite de frames por segundo del redibujado */
+    term.max_fps = config->max_fps;
+
+    WindowManager *wm = wm_create();
+    IRCConnection *irc = irc_create();
+    InputState input;
+    input_init(&input);
+
     bool running = true;
     bool buffer_enabled = config->buffer_enabled;
     bool silent_mode = config->silent_mode;
@@ -649,6 +639,13 @@ int main(void) {
     bool mention_alert = false;
     int debug_window_id = -1;  /* -1 = debug desactivado */
 
+    /* División inicial de la pantalla (los paneles vacíos se llenan con los canales de AUTOJOIN) */
+    if (config->split_mode != SPLIT_NONE) {
+        for (int i = 1; i < config->split_panes; i++) {
+            wm_split(wm, config->split_mode, -1);
+        }
+    }
+
     /* Aplicar configuración del buffer a todas las ventanas existentes */
     for (int i = 0; i < MAX_WINDOWS; i++) {
         Window *win = wm->windows[i];
@@ -681,7 +678,8 @@ int main(void) {
         .silent_mode = &silent_mode,
         .notify_alert = &notify_alert,
         .mention_alert = &mention_alert,
-        .debug_window_id = &debug_window_id
+        .debug_window_id = &debug_window_id,
+        .term = &term
     };
 
     /* Mensaje de bienvenida */
@@ -702,13 +700,11 @@ int main(void) {
     wm_add_message(wm, 0, "");
 
     /* Dibujar interfaz inicial */
-    term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
+    term_request_redraw(&term, REDRAW_ALL);
+    term_redraw(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert, true);
 
     /* Bucle principal */
     while (running && g_running) {
-        /* Actualizar tamaño del terminal */
-        term_get_size(&term);
-
         /* Preparar select para I/O no bloqueante */
         fd_set readfds;
         struct timeval tv;
@@ -718,6 +714,23 @@ int main(void) {
 
         int max_fd = STDIN_FILENO;
 
+        /* Aviso de redimensionado (SIGWINCH) */
+        if (term.resize_fd >= 0) {
+            FD_SET(term.resize_fd, &readfds);
+            if (term.resize_fd > max_fd) {
+                max_fd = term.resize_fd;
+            }
+        }
+
+        /* Resultados de /grep */
+        int grep_notify_fd = grep_fd();
+        if (grep_notify_fd >= 0) {
+            FD_SET(grep_notify_fd, &readfds);
+            if (grep_notify_fd > max_fd) {
+                max_fd = grep_notify_fd;
+            }
+        }
+
         if (irc->connected) {
             FD_SET(irc->sockfd, &readfds);
             if (irc->sockfd > max_fd) {
@@ -725,20 +738,38 @@ int main(void) {
             }
         }
 
+        /* Esperar como mucho 100ms, o menos si hay un frame pendiente */
+        int wait_ms = term_redraw_timeout(&term);
+        if (wait_ms < 0 || wait_ms > 100) {
+            wait_ms = 100;
+        }
         tv.tv_sec = 0;
-        tv.tv_usec = 100000; /* 100ms */
+        tv.tv_usec = wait_ms * 1000;
 
         int ret = select(max_fd + 1, &readfds, NULL, NULL, &tv);
 
+        /* Hora de esta vuelta (la hora local y los timestamps solo se
+         * recalculan al cambiar el segundo) */
+        clock_update();
+
+        /* Redimensionado del terminal: una relayout por ráfaga */
+        if (ret > 0 && term.resize_fd >= 0 && FD_ISSET(term.resize_fd, &readfds)) {
+            term_handle_resize(&term);
+        }
+
+        /* Pasar a su ventana lo que hayan encontrado los hilos de /grep */
+        if (ret > 0 && grep_notify_fd >= 0 && FD_ISSET(grep_notify_fd, &readfds)) {
+            grep_poll(wm);
+        }
+
         /* Procesar mensajes IRC */
         if (ret > 0 && irc->connected && FD_ISSET(irc->sockfd, &readfds)) {
             process_irc_messages(irc, wm, config, notify_status, &notify_alert, &mention_alert, silent_mode, debug_window_id);
-            term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
         }
 
         /* Sistema de notify: revisar cada 60 segundos */
         if (irc->connected && config->notify_count > 0) {
-            time_t now = time(NULL);
+            time_t now = clock_now();
             if (now - last_notify_check >= 60) {
                 last_notify_check = now;
 
@@ -797,12 +828,13 @@ int main(void) {
                     input_clear_line(&input);
                 }
 
-                term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
+                /* Un comando puede cambiar cualquier parte de la pantalla */
+                term_request_redraw(&term, REDRAW_ALL);
             }
             else if (key == KEY_BACKSPACE) {
                 input_backspace(&input);
                 autocomplete_active = false;
-                term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
+                term_request_redraw(&term, REDRAW_PROMPT);
             }
             else if (key == KEY_TAB) {
                 /* Autocompletado de nicks */
@@ -899,7 +931,7 @@ int main(void) {
                         debug_log(wm, debug_window_id, "TAB: no hay más matches, reset index");
                     }
 
-                    term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
+                    term_request_redraw(&term, REDRAW_PROMPT);
                 } else {
                     debug_log(wm, debug_window_id, "TAB: no aplicable (win=%p, type=%d)",
                               (void*)win, win ? win->type : -1);
@@ -907,60 +939,58 @@ int main(void) {
             }
             else if (key == KEY_ARROW_UP) {
                 input_history_prev(&input);
-                term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
+                term_request_redraw(&term, REDRAW_PROMPT);
             }
             else if (key == KEY_ARROW_DOWN) {
                 input_history_next(&input);
-                term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
+                term_request_redraw(&term, REDRAW_PROMPT);
             }
             else if (key == KEY_ARROW_LEFT) {
                 input_move_left(&input);
-                term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
+                term_request_redraw(&term, REDRAW_PROMPT);
             }
             else if (key == KEY_ARROW_RIGHT) {
                 input_move_right(&input);
-                term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
+                term_request_redraw(&term, REDRAW_PROMPT);
             }
             else if (key == KEY_CTRL_ARROW_UP) {
                 Window *win = wm_get_active_window(wm);
                 if (win && win->buffer && buffer_enabled) {
                     buffer_scroll_up(win->buffer);
-                    term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
+                    term_request_redraw(&term, REDRAW_MESSAGES);
                 }
             }
             else if (key == KEY_CTRL_ARROW_DOWN) {
                 Window *win = wm_get_active_window(wm);
                 if (win && win->buffer && buffer_enabled) {
                     buffer_scroll_down(win->buffer);
-                    term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
+                    term_request_redraw(&term, REDRAW_MESSAGES);
                 }
             }
             else if (key == KEY_CTRL_B) {
                 Window *win = wm_get_active_window(wm);
                 if (win && win->buffer && buffer_enabled) {
                     buffer_scroll_top(win->buffer);
-                    term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
+                    term_request_redraw(&term, REDRAW_MESSAGES);
                 }
             }
             else if (key == KEY_CTRL_E) {
                 Window *win = wm_get_active_window(wm);
                 if (win && win->buffer && buffer_enabled) {
                     buffer_scroll_bottom(win->buffer);
-                    term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
+                    term_request_redraw(&term, REDRAW_MESSAGES);
                 }
             }
             else if (key == KEY_CTRL_SHIFT_ARROW_UP) {
                 Window *win = wm_get_active_window(wm);
                 if (win && win->type == WIN_CHANNEL) {
                     window_scroll_users_up(win);
-                    term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
                 }
             }
             else if (key == KEY_CTRL_SHIFT_ARROW_DOWN) {
                 Window *win = wm_get_active_window(wm);
                 if (win && win->type == WIN_CHANNEL) {
                     window_scroll_users_down(win);
-                    term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
                 }
             }
             /* Alt + número para cambiar de ventana */
@@ -969,7 +999,6 @@ int main(void) {
                 Window *win = wm_get_window(wm, win_num);
                 if (win) {
                     wm_switch_to(wm, win_num);
-                    term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
                 }
             }
             /* Alt + → para ventana siguiente (cíclico) */
@@ -983,7 +1012,6 @@ int main(void) {
                 }
                 if (wm_get_window(wm, next_win)) {
                     wm_switch_to(wm, next_win);
-                    term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
                 }
             }
             /* Alt + ← para ventana anterior (cíclico) */
@@ -997,20 +1025,32 @@ int main(void) {
                 }
                 if (wm_get_window(wm, prev_win)) {
                     wm_switch_to(wm, prev_win);
-                    term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
+                }
+            }
+            /* Alt+A para ir a la ventana con la actividad más importante */
+            else if (key == KEY_ALT_A) {
+                int next_win = wm_next_activity(wm);
+                if (next_win >= 0) {
+                    wm_switch_to(wm, next_win);
                 }
             }
             /* Alt+. para /clear */
             else if (key == KEY_ALT_PERIOD) {
                 Window *win = wm_get_active_window(wm);
                 if (win && win->buffer) {
+                    window_clear_search(win);
                     buffer_clear(win->buffer);
                     wm_add_message(wm, win->id, ANSI_GRAY "Pantalla limpiada" ANSI_RESET);
-                    term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
                 }
             }
+            /* Ctrl-W para pasar al panel siguiente */
+            else if (key == KEY_CTRL_W) {
+                wm_focus_next_pane(wm);
+            }
             else if (key == KEY_CTRL_L) {
-                term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
+                /* Repintado completo aunque el terminal parezca al día */
+                screen_invalidate(&term.screen);
+                term_request_redraw(&term, REDRAW_ALL);
             }
             else if (key == KEY_CTRL_C) {
                 running = false;
@@ -1019,7 +1059,7 @@ int main(void) {
                 /* Carácter imprimible ASCII */
                 input_add_char(&input, (char)key);
                 autocomplete_active = false;
-                term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
+                term_request_redraw(&term, REDRAW_PROMPT);
             }
             else if ((unsigned char)key >= 128) {
                 /* Carácter UTF-8 multibyte */
@@ -1044,9 +1084,18 @@ int main(void) {
 
                 input_add_utf8(&input, utf8_buf, len);
                 autocomplete_active = false;
-                term_draw_interface(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert);
+                term_request_redraw(&term, REDRAW_PROMPT);
             }
+
+            /* La respuesta al teclado se dibuja sin esperar al límite de frames */
+            term_redraw(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert, true);
         }
+
+        /* Dibujar lo pendiente (mensajes IRC agrupados según MAX_FPS) */
+        term_redraw(&term, wm, input.line, input.cursor_pos, notify_alert, mention_alert, false);
+
+        /* Comprimir scrollback antiguo en pequeñas dosis (más si estamos inactivos) */
+        wm_compact_buffers(wm, ret == 0 ? 8 : 1);
     }
 
     /* Limpieza */
@@ -1054,8 +1103,11 @@ int main(void) {
         irc_disconnect(irc);
     }
 
+    grep_shutdown();
     irc_destroy(irc);
     wm_destroy(wm);
+    logger_shutdown();
+    buffer_spill_shutdown();
     config_destroy(config);
     term_cleanup(&term);
 
@@ -0,0 +1,778 @@
+#include "screen.h"
+#include "width.h"
+#include <errno.h>
+#include <unistd.h>
+
+/* Estado de la salida durante un flush */
+typedef struct {
+    Screen *scr;
+    const Cell *shown;          /* Contenido que muestra el terminal (front o su versión desplazada) */
+    size_t bytes;               /* Bytes emitidos en este frame */
+    int row;                    /* Posición del cursor del terminal (-1 = desconocida) */
+    int col;
+    CellStyle style;            /* Estilo activo en el terminal */
+} FlushState;
+
+static const CellStyle default_style = { COLOR_DEFAULT, COLOR_DEFAULT, 0 };
+
+/* Celda vacía con el estilo por defecto */
+static Cell blank_cell(void) {
+    Cell cell = { ' ', { COLOR_DEFAULT, COLOR_DEFAULT, 0 }, 1 };
+    return cell;
+}
+
+static bool style_equal(const CellStyle *a, const CellStyle *b) {
+    return a->fg == b->fg && a->bg == b->bg && a->attrs == b->attrs;
+}
+
+static bool cell_equal(const Cell *a, const Cell *b) {
+    return a->ch == b->ch && a->width == b->width && style_equal(&a->style, &b->style);
+}
+
+/* Codificar un codepoint en UTF-8; devuelve los bytes escritos */
+static int utf8_encode(uint32_t cp, char *out) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    } else if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    } else if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+/* Inicializar un modelo de pantalla vacío */
+void screen_init(Screen *scr) {
+    if (!scr) return;
+
+    scr->rows = 0;
+    scr->cols = 0;
+    scr->front = NULL;
+    scr->back = NULL;
+    scr->scratch = NULL;
+    scr->full_redraw = true;
+    scr->cursor_row = 1;
+    scr->cursor_col = 1;
+    scr->out = NULL;
+    scr->out_len = 0;
+    scr->out_capacity = 0;
+    scr->scroll_top = 0;
+    scr->scroll_bottom = 0;
+    scr->scroll_col = 1;
+    scr->scroll_cols = 0;
+    scr->truecolor = false;
+    memset(&scr->stats, 0, sizeof(scr->stats));
+}
+
+/* Liberar los buffers de la pantalla */
+void screen_free(Screen *scr) {
+    if (!scr) return;
+
+    free(scr->front);
+    free(scr->back);
+    free(scr->scratch);
+    free(scr->out);
+    scr->front = NULL;
+    scr->back = NULL;
+    scr->scratch = NULL;
+    scr->out = NULL;
+    scr->out_len = 0;
+    scr->out_capacity = 0;
+    scr->rows = 0;
+    scr->cols = 0;
+}
+
+/* Ajustar los buffers al tamaño del terminal (fuerza un repintado completo) */
+void screen_resize(Screen *scr, int rows, int cols) {
+    if (!scr || rows <= 0 || cols <= 0) return;
+    if (rows == scr->rows && cols == scr->cols && scr->front) return;
+
+    Cell *front = malloc(sizeof(Cell) * rows * cols);
+    Cell *back = malloc(sizeof(Cell) * rows * cols);
+    Cell *scratch = malloc(sizeof(Cell) * rows * cols);
+    if (!front || !back || !scratch) {
+        free(front);
+        free(back);
+        free(scratch);
+        return;
+    }
+
+    free(scr->front);
+    free(scr->back);
+    free(scr->scratch);
+    scr->front = front;
+    scr->back = back;
+    scr->scratch = scratch;
+    scr->rows = rows;
+    scr->cols = cols;
+
+    screen_clear(scr);
+    screen_invalidate(scr);
+}
+
+/* Olvidar lo que muestra el terminal: el próximo flush repinta todo */
+void screen_invalidate(Screen *scr) {
+    if (!scr) return;
+    scr->full_redraw = true;
+}
+
+/* Vaciar el frame en construcción */
+void screen_clear(Screen *scr) {
+    if (!scr || !scr->back) return;
+
+    Cell blank = blank_cell();
+    for (int i = 0; i < scr->rows * scr->cols; i++) {
+        scr->back[i] = blank;
+    }
+}
+
+/* Vaciar una fila del frame en construcción */
+void screen_clear_row(Screen *scr, int row) {
+    screen_fill(scr, row, 1, scr ? scr->cols : 0, ' ', NULL);
+}
+
+/* Vaciar un rectángulo del frame en construcción */
+void screen_clear_area(Screen *scr, int row, int col, int rows, int cols) {
+    for (int r = row; r < row + rows; r++) {
+        screen_fill(scr, r, col, cols, ' ', NULL);
+    }
+}
+
+/* Escribir una celda, reparando los caracteres anchos que pise */
+static void put_cell(Screen *scr, int row, int col, uint32_t ch, int width, const CellStyle *style) {
+    Cell *line = scr->back + (row - 1) * scr->cols;
+    int c = col - 1;
+
+    /* Si pisamos la continuación de un carácter ancho, borrar su mitad izquierda */
+    if (line[c].width == 0 && c > 0) {
+        line[c - 1] = blank_cell();
+    }
+    /* Si pisamos un carácter ancho con uno estrecho, borrar su continuación */
+    if (line[c].width == 2 && width == 1 && c + 1 < scr->cols) {
+        line[c + 1] = blank_cell();
+    }
+
+    line[c].ch = ch;
+    line[c].style = *style;
+    line[c].width = (uint8_t)width;
+
+    if (width == 2) {
+        if (c + 2 < scr->cols && line[c + 1].width == 2) {
+            line[c + 2] = blank_cell();
+        }
+        line[c + 1].ch = 0;
+        line[c + 1].style = *style;
+        line[c + 1].width = 0;
+    }
+}
+
+/* Rellenar count celdas de una fila con un carácter */
+void screen_fill(Screen *scr, int row, int col, int count, uint32_t ch, const CellStyle *style) {
+    if (!scr || !scr->back || row < 1 || row > scr->rows) return;
+    if (!style) style = &default_style;
+
+    for (int i = 0; i < count && col + i <= scr->cols; i++) {
+        if (col + i >= 1) {
+            put_cell(scr, row, col + i, ch, 1, style);
+        }
+    }
+}
+
+/* Aplicar una secuencia SGR (ESC [ ... m) al estilo */
+static void apply_sgr(CellStyle *style, const int *params, int count) {
+    if (count == 0) {
+        *style = default_style;
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        int p = params[i];
+
+        if (p == 0) {
+            *style = default_style;
+        } else if (p == 1) {
+            style->attrs |= CELL_BOLD;
+        } else if (p == 2) {
+            style->attrs |= CELL_DIM;
+        } else if (p == 3) {
+            style->attrs |= CELL_ITALIC;
+        } else if (p == 4) {
+            style->attrs |= CELL_UNDERLINE;
+        } else if (p == 5) {
+            style->attrs |= CELL_BLINK;
+        } else if (p == 7) {
+            style->attrs |= CELL_REVERSE;
+        } else if (p == 9) {
+            style->attrs |= CELL_STRIKE;
+        } else if (p == 22) {
+            style->attrs &= ~(CELL_BOLD | CELL_DIM);
+        } else if (p == 23) {
+            style->attrs &= ~CELL_ITALIC;
+        } else if (p == 24) {
+            style->attrs &= ~CELL_UNDERLINE;
+        } else if (p == 25) {
+            style->attrs &= ~CELL_BLINK;
+        } else if (p == 27) {
+            style->attrs &= ~CELL_REVERSE;
+        } else if (p == 29) {
+            style->attrs &= ~CELL_STRIKE;
+        } else if (p >= 30 && p <= 37) {
+            style->fg = COLOR_PALETTE(p - 30);
+        } else if (p == 39) {
+            style->fg = COLOR_DEFAULT;
+        } else if (p >= 40 && p <= 47) {
+            style->bg = COLOR_PALETTE(p - 40);
+        } else if (p == 49) {
+            style->bg = COLOR_DEFAULT;
+        } else if (p >= 90 && p <= 97) {
+            style->fg = COLOR_PALETTE(p - 90 + 8);
+        } else if (p >= 100 && p <= 107) {
+            style->bg = COLOR_PALETTE(p - 100 + 8);
+        } else if (p == 38 || p == 48) {
+            /* Color extendido: 38;5;n (paleta) o 38;2;r;g;b (directo) */
+            uint32_t color = COLOR_DEFAULT;
+            if (i + 2 < count && params[i + 1] == 5) {
+                color = COLOR_PALETTE(params[i + 2] & 0xFF);
+                i += 2;
+            } else if (i + 4 < count && params[i + 1] == 2) {
+                color = COLOR_RGB | ((uint32_t)(params[i + 2] & 0xFF) << 16) |
+                        ((uint32_t)(params[i + 3] & 0xFF) << 8) | (uint32_t)(params[i + 4] & 0xFF);
+                i += 4;
+            } else {
+                break;
+            }
+            if (p == 38) style->fg = color;
+            else style->bg = color;
+        }
+    }
+}
+
+/* Leer el siguiente carácter visible de un texto con códigos ANSI
+ * Aplica a style las secuencias SGR que encuentre e ignora el resto de CSI y
+ * los caracteres de control (el tabulador cuenta como espacio).
+ * Devuelve el puntero tras el carácter, o NULL al llegar al final.
+ */
+static const char* next_glyph(const char *p, CellStyle *style, uint32_t *cp, int *width) {
+    while (*p) {
+        /* Secuencia CSI: aplicar SGR e ignorar el resto */
+        if (p[0] == '\033' && p[1] == '[') {
+            int params[16];
+            int count = 0;
+            int value = 0;
+            bool has_value = false;
+
+            p += 2;
+            while (*p && !(*p >= 0x40 && *p <= 0x7E)) {
+                if (*p >= '0' && *p <= '9') {
+                    value = value * 10 + (*p - '0');
+                    has_value = true;
+                } else if (*p == ';' || *p == ':') {
+                    if (count < 16) params[count++] = value;
+                    value = 0;
+                    has_value = false;
+                }
+                p++;
+            }
+            if (*p == 'm') {
+                if ((has_value || count > 0) && count < 16) params[count++] = value;
+                apply_sgr(style, params, count);
+            }
+            if (*p) p++;
+            continue;
+        }
+
+        p += utf8_decode(p, cp);
+
+        /* Caracteres de control: tabulador como espacio, el resto se ignora */
+        if (*cp == '\t') {
+            *cp = ' ';
+        } else if (*cp < 0x20 || *cp == 0x7F) {
+            continue;
+        }
+
+        *width = char_width(*cp);
+        if (*width == 0) continue;
+        return p;
+    }
+    return NULL;
+}
+
+/* Pintar texto con códigos ANSI a partir de (row, col)
+ * Se escribe como mucho max_cols columnas (0 = hasta el final de la fila).
+ * style es el estilo inicial y recibe el estilo final (NULL = por defecto).
+ * Devuelve las columnas ocupadas.
+ */
+int screen_put_text(Screen *scr, int row, int col, int max_cols, const char *text, CellStyle *style) {
+    if (!scr || !scr->back || !text || row < 1 || row > scr->rows || col < 1) return 0;
+
+    CellStyle local = default_style;
+    if (!style) style = &local;
+
+    int limit = (max_cols > 0 && col + max_cols - 1 < scr->cols) ? col + max_cols - 1 : scr->cols;
+    int c = col;
+    const char *p = text;
+    uint32_t cp;
+    int width;
+
+    while ((p = next_glyph(p, style, &cp, &width)) != NULL) {
+        if (c + width - 1 > limit) break;
+
+        put_cell(scr, row, c, cp, width, style);
+        c += width;
+    }
+
+    return c - col;
+}
+
+/* Filas que ocupa un texto partido a width columnas (al menos una) */
+int screen_text_rows(const char *text, int width) {
+    if (!text || width <= 0) return 1;
+
+    CellStyle style = default_style;
+    int rows = 1;
+    int c = 0;
+    uint32_t cp;
+    int glyph_width;
+
+    while ((text = next_glyph(text, &style, &cp, &glyph_width)) != NULL) {
+        if (c + glyph_width > width && c > 0) {
+            rows++;
+            c = 0;
+        }
+        c += glyph_width;
+    }
+    return rows;
+}
+
+/* Pintar un texto partido a width columnas desde (row, col)
+ * Se omiten las primeras skip filas del texto (sus códigos de estilo sí se
+ * aplican) y se pintan como mucho max_rows. Devuelve las filas pintadas.
+ */
+int screen_put_wrapped(Screen *scr, int row, int col, int width, int skip, int max_rows, const char *text) {
+    if (!scr || !scr->back || !text || width <= 0 || max_rows <= 0) return 0;
+
+    CellStyle style = default_style;
+    int line = 0;
+    int c = 0;
+    uint32_t cp;
+    int glyph_width;
+
+    while ((text = next_glyph(text, &style, &cp, &glyph_width)) != NULL) {
+        if (c + glyph_width > width && c > 0) {
+            line++;
+            c = 0;
+            if (line - skip >= max_rows) break;
+        }
+        int r = row + line - skip;
+        if (line >= skip && r >= 1 && r <= scr->rows && col + c + glyph_width - 1 <= scr->cols) {
+            put_cell(scr, r, col + c, cp, glyph_width, &style);
+        }
+        c += glyph_width;
+    }
+
+    int drawn = line - skip + 1;
+    if (drawn < 0) drawn = 0;
+    return drawn < max_rows ? drawn : max_rows;
+}
+
+/* Fijar la posición del cursor tras el flush */
+void screen_set_cursor(Screen *scr, int row, int col) {
+    if (!scr) return;
+    scr->cursor_row = row;
+    scr->cursor_col = col;
+}
+
+/* Añadir bytes a la salida del frame */
+static void out_append(Screen *scr, const char *data, size_t len) {
+    if (scr->out_len + len > scr->out_capacity) {
+        size_t new_capacity = scr->out_capacity ? scr->out_capacity * 2 : 16384;
+        while (new_capacity < scr->out_len + len) new_capacity *= 2;
+        char *out = realloc(scr->out, new_capacity);
+        if (!out) return;
+        scr->out = out;
+        scr->out_capacity = new_capacity;
+    }
+    memcpy(scr->out + scr->out_len, data, len);
+    scr->out_len += len;
+}
+
+/* Enviar la salida acumulada al terminal con write (normalmente una sola llamada) */
+static void out_send(Screen *scr) {
+    const char *data = scr->out;
+    size_t len = scr->out_len;
+    unsigned calls = 0;
+
+    while (len > 0) {
+        ssize_t n = write(STDOUT_FILENO, data, len);
+        calls++;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            /* Salida perdida: el terminal ya no coincide con front */
+            scr->full_redraw = true;
+            break;
+        }
+        data += n;
+        len -= n;
+    }
+
+    scr->stats.frames++;
+    scr->stats.last_bytes = scr->out_len;
+    scr->stats.last_syscalls = calls;
+    scr->stats.total_bytes += scr->out_len;
+    scr->stats.total_syscalls += calls;
+    scr->out_len = 0;
+}
+
+/* Emitir bytes al terminal */
+static void emit(FlushState *fs, const char *data, size_t len) {
+    out_append(fs->scr, data, len);
+    fs->bytes += len;
+}
+
+static void emit_str(FlushState *fs, const char *data) {
+    emit(fs, data, strlen(data));
+}
+
+/* Nivel más cercano del cubo de 6x6x6 de la paleta de 256 colores */
+static int cube_level(unsigned v) {
+    return v < 48 ? 0 : v < 115 ? 1 : (int)(v - 35) / 40;
+}
+
+/* Aproximar un color directo al índice más cercano de la paleta de 256 */
+static unsigned rgb_to_palette(uint32_t color) {
+    static const unsigned levels[6] = { 0, 95, 135, 175, 215, 255 };
+    unsigned r = (color >> 16) & 0xFF, g = (color >> 8) & 0xFF, b = color & 0xFF;
+    int ri = cube_level(r), gi = cube_level(g), bi = cube_level(b);
+
+    /* Candidatos: el cubo de colores y la rampa de grises (232..255) */
+    unsigned avg = (r + g + b) / 3;
+    unsigned grey = avg > 238 ? 23 : avg < 8 ? 0 : (avg - 8) / 10;
+    unsigned gv = 8 + grey * 10;
+
+    int dr = (int)r - (int)levels[ri], dg = (int)g - (int)levels[gi], db = (int)b - (int)levels[bi];
+    int cube_dist = dr * dr + dg * dg + db * db;
+    dr = (int)r - (int)gv; dg = (int)g - (int)gv; db = (int)b - (int)gv;
+    int grey_dist = dr * dr + dg * dg + db * db;
+
+    if (grey_dist < cube_dist) return 232 + grey;
+    return 16 + ri * 36 + gi * 6 + bi;
+}
+
+/* Añadir a seq los parámetros SGR de un color */
+static int sgr_color(char *seq, size_t size, uint32_t color, bool background, bool truecolor) {
+    if (color == COLOR_DEFAULT) {
+        return snprintf(seq, size, ";%d", background ? 49 : 39);
+    }
+    if ((color & COLOR_RGB) && !truecolor) {
+        color = COLOR_PALETTE(rgb_to_palette(color));
+    }
+    if (color & COLOR_RGB) {
+        return snprintf(seq, size, ";%d;2;%u;%u;%u", background ? 48 : 38,
+                        (color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF);
+    }
+
+    unsigned n = color - 1;
+    if (n < 8) return snprintf(seq, size, ";%u", (background ? 40 : 30) + n);
+    if (n < 16) return snprintf(seq, size, ";%u", (background ? 100 : 90) + n - 8);
+    return snprintf(seq, size, ";%d;5;%u", background ? 48 : 38, n);
+}
+
+/* Cambiar el estilo activo emitiendo solo las diferencias */
+static void set_style(FlushState *fs, const CellStyle *style) {
+    if (style_equal(&fs->style, style)) return;
+
+    char seq[96];
+    int len;
+
+    if (style_equal(style, &default_style)) {
+        emit_str(fs, ANSI_RESET);
+        fs->style = *style;
+        return;
+    }
+
+    uint8_t removed = fs->style.attrs & ~style->attrs;
+    uint8_t added = style->attrs & ~fs->style.attrs;
+
+    len = snprintf(seq, sizeof(seq), "\033[");
+    if (removed & (CELL_BOLD | CELL_DIM)) {
+        len += snprintf(seq + len, sizeof(seq) - len, ";22");
+        added |= style->attrs & (CELL_BOLD | CELL_DIM);
+    }
+    if (removed & CELL_ITALIC) len += snprintf(seq + len, sizeof(seq) - len, ";23");
+    if (removed & CELL_UNDERLINE) len += snprintf(seq + len, sizeof(seq) - len, ";24");
+    if (removed & CELL_BLINK) len += snprintf(seq + len, sizeof(seq) - len, ";25");
+    if (removed & CELL_REVERSE) len += snprintf(seq + len, sizeof(seq) - len, ";27");
+    if (removed & CELL_STRIKE) len += snprintf(seq + len, sizeof(seq) - len, ";29");
+    if (added & CELL_BOLD) len += snprintf(seq + len, sizeof(seq) - len, ";1");
+    if (added & CELL_DIM) len += snprintf(seq + len, sizeof(seq) - len, ";2");
+    if (added & CELL_ITALIC) len += snprintf(seq + len, sizeof(seq) - len, ";3");
+    if (added & CELL_UNDERLINE) len += snprintf(seq + len, sizeof(seq) - len, ";4");
+    if (added & CELL_BLINK) len += snprintf(seq + len, sizeof(seq) - len, ";5");
+    if (added & CELL_REVERSE) len += snprintf(seq + len, sizeof(seq) - len, ";7");
+    if (added & CELL_STRIKE) len += snprintf(seq + len, sizeof(seq) - len, ";9");
+    if (style->fg != fs->style.fg) len += sgr_color(seq + len, sizeof(seq) - len, style->fg, false, fs->scr->truecolor);
+    if (style->bg != fs->style.bg) len += sgr_color(seq + len, sizeof(seq) - len, style->bg, true, fs->scr->truecolor);
+
+    /* Quitar el ';' inicial y cerrar la secuencia */
+    memmove(seq + 2, seq + 3, len - 2);
+    len--;
+    len += snprintf(seq + len, sizeof(seq) - len, "m");
+
+    emit(fs, seq, len);
+    fs->style = *style;
+}
+
+/* Mover el cursor del terminal eligiendo la secuencia más corta */
+static void move_to(FlushState *fs, Screen *scr, int row, int col) {
+    if (fs->row == row && fs->col == col) return;
+
+    char seq[32];
+    int len;
+
+    if (fs->row == row && col > fs->col) {
+        /* Hueco corto en la misma fila: reescribir las celdas si tienen el estilo activo */
+        int gap = col - fs->col;
+        if (gap <= 3) {
+            const Cell *cells = fs->shown + (row - 1) * scr->cols + (fs->col - 1);
+            bool reuse = true;
+            for (int i = 0; i < gap && reuse; i++) {
+                reuse = cells[i].width == 1 && cells[i].ch < 0x80 &&
+                        style_equal(&cells[i].style, &fs->style);
+            }
+            if (reuse) {
+                for (int i = 0; i < gap; i++) {
+                    char ch = (char)cells[i].ch;
+                    emit(fs, &ch, 1);
+                }
+                fs->col = col;
+                return;
+            }
+        }
+        len = snprintf(seq, sizeof(seq), "\033[%dC", gap);
+    } else if (fs->row == row && col == 1) {
+        len = snprintf(seq, sizeof(seq), "\r");
+    } else if (fs->row == row) {
+        len = snprintf(seq, sizeof(seq), "\033[%dG", col);
+    } else if (fs->row > 0 && row == fs->row + 1 && col == 1) {
+        len = snprintf(seq, sizeof(seq), "\r\n");
+    } else if (col == 1) {
+        len = snprintf(seq, sizeof(seq), "\033[%dH", row);
+    } else {
+        len = snprintf(seq, sizeof(seq), "\033[%d;%dH", row, col);
+    }
+
+    emit(fs, seq, len);
+    fs->row = row;
+    fs->col = col;
+}
+
+/* Emitir las celdas de back que difieren de lo que muestra el terminal */
+static void emit_diff(FlushState *fs, Screen *scr) {
+    for (int row = 1; row <= scr->rows; row++) {
+        const Cell *back = scr->back + (row - 1) * scr->cols;
+        const Cell *shown = fs->shown + (row - 1) * scr->cols;
+
+        int col = 1;
+        while (col <= scr->cols) {
+            const Cell *cell = &back[col - 1];
+            if (cell_equal(cell, &shown[col - 1])) {
+                col++;
+                continue;
+            }
+
+            /* Continuación de un carácter ancho: emitir desde su mitad izquierda */
+            if (cell->width == 0) {
+                if (col > 1 && back[col - 2].width == 2) {
+                    col--;
+                    cell = &back[col - 1];
+                } else {
+                    col++;
+                    continue;
+                }
+            }
+
+            move_to(fs, scr, row, col);
+            set_style(fs, &cell->style);
+
+            char utf8[4];
+            emit(fs, utf8, utf8_encode(cell->ch, utf8));
+
+            col += cell->width;
+            fs->col = col;
+            if (fs->col > scr->cols) {
+                /* Cursor en el margen derecho: su posición real depende del terminal */
+                fs->row = -1;
+            }
+        }
+    }
+}
+
+/* Comparar las primeras cols celdas de dos filas */
+static bool rows_equal(const Cell *a, const Cell *b, int cols) {
+    for (int i = 0; i < cols; i++) {
+        if (!cell_equal(&a[i], &b[i])) return false;
+    }
+    return true;
+}
+
+/* Buscar cuántas filas subió el contenido de la zona de scroll
+ * Devuelve n si cada fila r de back coincide con la fila r + n de front
+ * (0 si la zona no cambió o no es un desplazamiento).
+ */
+static int find_scroll(const Screen *scr) {
+    int top = scr->scroll_top;
+    int bottom = scr->scroll_bottom;
+    int col = scr->scroll_col;
+    int cols = scr->scroll_cols;
+
+    if (top < 1 || bottom > scr->rows || top >= bottom) return 0;
+    if (col < 1 || cols <= 0 || col - 1 + cols > scr->cols) return 0;
+
+    for (int n = 0; n <= bottom - top; n++) {
+        bool match = true;
+        for (int row = top; row + n <= bottom && match; row++) {
+            match = rows_equal(scr->back + (row - 1) * scr->cols + col - 1,
+                               scr->front + (row + n - 1) * scr->cols + col - 1, cols);
+        }
+        if (match) return n < bottom - top ? n : 0;
+    }
+    return 0;
+}
+
+/* Preparar en scratch lo que mostrará el terminal tras subir n filas la zona */
+static void shift_rows(Screen *scr, int n) {
+    memcpy(scr->scratch, scr->front, sizeof(Cell) * scr->rows * scr->cols);
+
+    Cell blank = blank_cell();
+    for (int row = scr->scroll_top; row <= scr->scroll_bottom; row++) {
+        Cell *dst = scr->scratch + (row - 1) * scr->cols;
+        if (row + n <= scr->scroll_bottom) {
+            memcpy(dst, scr->front + (row + n - 1) * scr->cols, sizeof(Cell) * scr->cols);
+        } else {
+            for (int col = 0; col < scr->cols; col++) {
+                dst[col] = blank;
+            }
+        }
+    }
+}
+
+/* Subir n filas la zona de scroll con DECSTBM + SU */
+static void emit_scroll(FlushState *fs, Screen *scr, int n) {
+    char seq[48];
+    int len;
+
+    /* Las filas nuevas se rellenan con el fondo activo: usar el estilo por defecto */
+    set_style(fs, &default_style);
+    len = snprintf(seq, sizeof(seq), "\033[%d;%dr\033[%dS\033[r",
+                   scr->scroll_top, scr->scroll_bottom, n);
+    emit(fs, seq, len);
+
+    /* DECSTBM devuelve el cursor al origen */
+    fs->row = -1;
+    fs->col = -1;
+}
+
+/* Marcar la zona de la pantalla cuyo contenido se desplaza (mensajes)
+ * Solo se comparan las columnas [col, col + cols); el desplazamiento se aplica a
+ * filas completas. Vale para el siguiente screen_flush().
+ */
+void screen_scroll_hint(Screen *scr, int top, int bottom, int col, int cols) {
+    if (!scr) return;
+    scr->scroll_top = top;
+    scr->scroll_bottom = bottom;
+    scr->scroll_col = col;
+    scr->scroll_cols = cols;
+}
+
+/* Volcar al terminal las diferencias entre el frame nuevo y el mostrado
+ * Si el contenido de la zona de scroll solo subió, se prueba también a
+ * desplazarla en el propio terminal y pintar lo que falte; se envía la
+ * variante más corta.
+ * Devuelve los bytes emitidos.
+ */
+size_t screen_flush(Screen *scr) {
+    if (!scr || !scr->back || !scr->front) return 0;
+
+    FlushState fs = { scr, scr->front, 0, -1, -1, default_style };
+
+    /* Sin cambios: solo recolocar el cursor */
+    bool changed = scr->full_redraw;
+    for (int i = 0; i < scr->rows * scr->cols && !changed; i++) {
+        changed = !cell_equal(&scr->back[i], &scr->front[i]);
+    }
+    if (!changed) {
+        move_to(&fs, scr, scr->cursor_row, scr->cursor_col);
+        scr->scroll_top = 0;
+        out_send(scr);
+        return fs.bytes;
+    }
+
+    emit_str(&fs, ANSI_HIDE_CURSOR);
+
+    int scroll = 0;
+    if (scr->full_redraw) {
+        /* Limpiar el terminal: a partir de aquí front está en blanco */
+        emit_str(&fs, ANSI_RESET ANSI_CLEAR_SCREEN);
+        Cell blank = blank_cell();
+        for (int i = 0; i < scr->rows * scr->cols; i++) {
+            scr->front[i] = blank;
+        }
+        scr->full_redraw = false;
+    } else {
+        scroll = find_scroll(scr);
+    }
+
+    if (scroll > 0) {
+        /* Generar las dos variantes una tras otra y quedarse con la más corta */
+        FlushState scrolled = fs;
+        size_t start = scr->out_len;
+
+        emit_diff(&fs, scr);
+        size_t mid = scr->out_len;
+
+        shift_rows(scr, scroll);
+        scrolled.shown = scr->scratch;
+        emit_scroll(&scrolled, scr, scroll);
+        emit_diff(&scrolled, scr);
+        size_t scrolled_len = scr->out_len - mid;
+
+        if (scrolled_len < mid - start) {
+            memmove(scr->out + start, scr->out + mid, scrolled_len);
+            scr->out_len = start + scrolled_len;
+            fs = scrolled;
+            scr->stats.scrolls++;
+        } else {
+            scr->out_len = mid;
+        }
+    } else {
+        emit_diff(&fs, scr);
+    }
+    scr->scroll_top = 0;
+
+    memcpy(scr->front, scr->back, sizeof(Cell) * scr->rows * scr->cols);
+
+    fs.shown = scr->front;
+    set_style(&fs, &default_style);
+    move_to(&fs, scr, scr->cursor_row, scr->cursor_col);
+    emit_str(&fs, ANSI_SHOW_CURSOR);
+    out_send(scr);
+
+    return fs.bytes;
+}
+
+/* Enviar una secuencia directamente al terminal, fuera de un frame */
+void screen_write(Screen *scr, const char *data) {
+    if (!scr || !data) return;
+    out_append(scr, data, strlen(data));
+    out_send(scr);
+}
@@ -0,0 +1,88 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include "common.h"
+#include <stdint.h>
+
+/* Atributos de celda */
+#define CELL_BOLD       0x01
+#define CELL_DIM        0x02
+#define CELL_ITALIC     0x04
+#define CELL_UNDERLINE  0x08
+#define CELL_BLINK      0x10
+#define CELL_REVERSE    0x20
+#define CELL_STRIKE     0x40
+
+/* Codificación de colores: 0 = por defecto, 1..256 = paleta (índice + 1),
+ * COLOR_RGB | 0xRRGGBB = color directo
+ */
+#define COLOR_DEFAULT   0
+#define COLOR_PALETTE(n) ((uint32_t)(n) + 1)
+#define COLOR_RGB       0x1000000u
+
+/* Estilo de una celda */
+typedef struct {
+    uint32_t fg;
+    uint32_t bg;
+    uint8_t attrs;
+} CellStyle;
+
+/* Celda de la pantalla */
+typedef struct {
+    uint32_t ch;                /* Codepoint (0 = continuación de un carácter ancho) */
+    CellStyle style;
+    uint8_t width;              /* Columnas que ocupa (0 en la continuación) */
+} Cell;
+
+/* Estadísticas de salida al terminal */
+typedef struct {
+    unsigned long frames;       /* Frames volcados */
+    size_t last_bytes;          /* Bytes del último frame */
+    unsigned last_syscalls;     /* Llamadas a write del último frame */
+    unsigned long long total_bytes;
+    unsigned long total_syscalls;
+    unsigned long scrolls;      /* Frames enviados desplazando la zona de scroll */
+} ScreenStats;
+
+/* Modelo de pantalla con doble buffer
+ * Los term_draw_* pintan en back; screen_flush() compara con front (lo que
+ * muestra el terminal) y solo emite las celdas que cambiaron.
+ */
+typedef struct {
+    int rows;
+    int cols;
+    Cell *front;
+    Cell *back;
+    Cell *scratch;              /* front desplazado al probar el scroll del terminal */
+    bool full_redraw;           /* front no es fiable: limpiar y repintar todo */
+    int cursor_row;             /* Posición final del cursor (1-based) */
+    int cursor_col;
+    char *out;                  /* Salida del frame (un solo write al final) */
+    size_t out_len;
+    size_t out_capacity;
+    int scroll_top;             /* Zona cuyo contenido se desplaza (0 = ninguna) */
+    int scroll_bottom;
+    int scroll_col;
+    int scroll_cols;
+    bool truecolor;             /* El terminal acepta color directo (si no, se aproxima a 256) */
+    ScreenStats stats;
+} Screen;
+
+/* Funciones del modelo de pantalla */
+void screen_init(Screen *scr);
+void screen_free(Screen *scr);
+void screen_resize(Screen *scr, int rows, int cols);
+void screen_invalidate(Screen *scr);
+void screen_clear(Screen *scr);
+void screen_clear_row(Screen *scr, int row);
+void screen_clear_area(Screen *scr, int row, int col, int rows, int cols);
+void screen_fill(Screen *scr, int row, int col, int count, uint32_t ch, const CellStyle *style);
+int screen_put_text(Screen *scr, int row, int col, int max_cols, const char *text, CellStyle *style);
+int screen_text_rows(const char *text, int width);
+int screen_put_wrapped(Screen *scr, int row, int col, int width, int skip, int max_rows, const char *text);
+void screen_set_cursor(Screen *scr, int row, int col);
+void screen_scroll_hint(Screen *scr, int top, int bottom, int col, int cols);
+size_t screen_flush(Screen *scr);
+void screen_write(Screen *scr, const char *data);
+
+#endif /* SCREEN_H */
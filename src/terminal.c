@@ -1,141 +1,106 @@
 #include "terminal.h"
+#include "width.h"
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
 #include <sys/ioctl.h>
+#include <time.h>
 
-/* Dividir texto en líneas según ancho máximo preservando formatos ANSI
- * Retorna número de líneas generadas
- * lines debe ser un array de punteros a char con espacio suficiente
- * max_lines es el número máximo de líneas a generar
- */
-static int wrap_text(const char *text, int max_width, char **lines, int max_lines) {
-    if (!text || !lines || max_width <= 0 || max_lines <= 0) return 0;
-
-    int line_count = 0;
-    int text_len = strlen(text);
-    int pos = 0;
-
-    /* Buffer para almacenar códigos ANSI activos */
-    char active_codes[512] = "";
-    int active_codes_len = 0;
-
-    while (pos < text_len && line_count < max_lines) {
-        int line_start = pos;
-        int line_end = pos;
-        int visible_chars = 0;
-
-        /* Avanzar hasta llenar el ancho máximo (contando solo caracteres visibles) */
-        while (pos < text_len && visible_chars < max_width) {
-            /* Detectar secuencia ANSI */
-            if (text[pos] == '\033' && pos + 1 < text_len && text[pos + 1] == '[') {
-                int ansi_start = pos;
-                /* Saltar secuencia ANSI completa */
-                pos += 2;
-                /* Limitar búsqueda de 'm' a máximo 20 caracteres para evitar bucles infinitos */
-                int search_limit = 20;
-                while (pos < text_len && text[pos] != 'm' && search_limit > 0) {
-                    pos++;
-                    search_limit--;
-                }
-
-                /* Si encontramos la 'm', avanzar; si no, resetear a posición segura */
-                if (pos < text_len && text[pos] == 'm') {
-                    pos++; /* Saltar 'm' */
-                } else {
-                    /* Secuencia ANSI malformada, volver atrás y tratar como texto normal */
-                    pos = ansi_start + 1;
-                    line_end = pos;
-                    continue;
-                }
-
-                int ansi_len = pos - ansi_start;
-
-                /* Verificar si es un código de reset */
-                if (ansi_len >= 4 && ansi_start + 3 < text_len &&
-                    text[ansi_start + 2] == '0' && text[ansi_start + 3] == 'm') {
-                    /* Reset: limpiar códigos activos */
-                    active_codes[0] = '\0';
-                    active_codes_len = 0;
-                } else {
-                    /* Guardar código ANSI en active_codes (evitar overflow) */
-                    if (ansi_len > 0 && ansi_len < 50 &&
-                        active_codes_len + ansi_len < (int)sizeof(active_codes) - 1) {
-                        memcpy(active_codes + active_codes_len, text + ansi_start, ansi_len);
-                        active_codes_len += ansi_len;
-                        active_codes[active_codes_len] = '\0';
-                    }
-                }
-
-                line_end = pos;
-                continue;
-            }
+/* Indicadores de actividad (máscara de status_mask) */
+#define STATUS_NOTIFY   0x01
+#define STATUS_MENTION  0x02
+#define STATUS_PRIVATE  0x04
+#define STATUS_UNREAD   0x08
 
-            /* Contar carácter visible UTF-8 */
-            unsigned char c = text[pos];
-            int char_bytes = 1;
+/* Ancho mínimo de un panel de canal para mostrar la lista de usuarios */
+#define USER_LIST_MIN_PANE_COLS 40
 
-            if ((c & 0x80) == 0x00) char_bytes = 1;
-            else if ((c & 0xE0) == 0xC0) char_bytes = 2;
-            else if ((c & 0xF0) == 0xE0) char_bytes = 3;
-            else if ((c & 0xF8) == 0xF0) char_bytes = 4;
+/* Estilo de las líneas separadoras */
+static const CellStyle separator_style = { COLOR_PALETTE(6), COLOR_DEFAULT, CELL_BOLD };
 
-            /* Verificar que no nos salgamos del buffer */
-            if (pos + char_bytes > text_len) {
-                char_bytes = text_len - pos;
-                if (char_bytes <= 0) break;
-            }
+/* Pintar los mensajes de la vista en las filas [top, bottom], desde la columna col con ancho width
+ * Se recorre el buffer hacia atrás desde la última línea visible solo hasta
+ * llenar las filas disponibles, y después se pintan de arriba abajo. Los
+ * mensajes largos ocupan las filas que necesiten; si el más antiguo no cabe
+ * entero se muestra su parte final. No usa memoria dinámica.
+ */
+static void term_draw_messages(TerminalState *term, Window *win, int top, int bottom, int col, int width) {
+    MessageBuffer *buf = win->buffer;
+    if (!buf) return;
+
+    int avail = bottom - top + 1;
+    int last = buf->count - 1 - buf->view_offset;
+    if (avail <= 0 || width <= 0 || last < 0) return;
+
+    /* Línea con la coincidencia de /search en vídeo inverso */
+    char highlighted[MAX_MSG_LEN * 4];
+
+    /* Maquetar hacia atrás hasta llenar la vista */
+    int first = last;
+    int used = 0;
+    for (int i = last; i >= 0 && used < avail; i--) {
+        const char *line = buffer_get_line(buf, i);
+        if (!line) break;
+        if (i == win->search.line && window_highlight_search(win, line, highlighted, sizeof(highlighted))) {
+            line = highlighted;
+        }
+        used += screen_text_rows(line, width);
+        first = i;
+    }
 
-            /* Verificar si el carácter cabe */
-            if (visible_chars + 1 > max_width) break;
+    /* Si la vista solo avanzó, screen_flush() puede desplazar estas filas en el terminal */
+    screen_scroll_hint(&term->screen, top, bottom, col, width);
 
-            pos += char_bytes;
-            visible_chars++;
-            line_end = pos;
-        }
+    /* Del mensaje más antiguo se omiten las filas que no caben */
+    int skip = used > avail ? used - avail : 0;
+    int row = top;
 
-        /* Crear línea */
-        int line_bytes = line_end - line_start;
-        if (line_bytes > 0 && line_bytes < MAX_MSG_LEN) {  /* Validar tamaño razonable */
-            /* Calcular tamaño total: códigos activos previos + contenido + reset ANSI */
-            int prefix_len = (line_count > 0 && active_codes_len > 0) ? active_codes_len : 0;
-            int total_size = prefix_len + line_bytes + 5; /* +5 para \033[0m + \0 */
-
-            /* Validar que el tamaño total sea razonable */
-            if (total_size > 0 && total_size < MAX_MSG_LEN * 2) {
-                lines[line_count] = malloc(total_size);
-                if (lines[line_count]) {
-                    char *ptr = lines[line_count];
-                    char *end_ptr = lines[line_count] + total_size;
-
-                    /* Si no es la primera línea, añadir códigos activos al inicio */
-                    if (line_count > 0 && active_codes_len > 0 && ptr + active_codes_len < end_ptr) {
-                        memcpy(ptr, active_codes, active_codes_len);
-                        ptr += active_codes_len;
-                    }
-
-                    /* Copiar contenido de la línea con verificación de límites */
-                    if (line_start >= 0 && line_end <= text_len &&
-                        line_bytes > 0 && ptr + line_bytes < end_ptr) {
-                        memcpy(ptr, text + line_start, line_bytes);
-                        ptr += line_bytes;
-                    }
-
-                    /* Añadir reset ANSI al final */
-                    if (ptr + 5 <= end_ptr) {
-                        memcpy(ptr, "\033[0m", 4);
-                        ptr += 4;
-                        *ptr = '\0';
-                    }
-
-                    line_count++;
-                }
-            }
+    for (int i = first; i <= last && row <= bottom; i++) {
+        const char *line = buffer_get_line(buf, i);
+        if (!line) break;
+        if (i == win->search.line && window_highlight_search(win, line, highlighted, sizeof(highlighted))) {
+            line = highlighted;
         }
+        row += screen_put_wrapped(&term->screen, row, col, width, skip, bottom - row + 1, line);
+        skip = 0;
+    }
+}
 
-        /* Si no avanzamos, salir para evitar loop infinito */
-        if (line_end == line_start) break;
+/* Extremo de escritura del aviso de redimensionado (self-pipe) */
+static int resize_pipe_write = -1;
+
+/* Manejador de SIGWINCH: solo avisa al bucle principal */
+static void term_sigwinch_handler(int sig) {
+    (void)sig;
+    int saved_errno = errno;
+    if (resize_pipe_write >= 0) {
+        char c = 0;
+        ssize_t n = write(resize_pipe_write, &c, 1);
+        (void)n;    /* Pipe lleno: ya hay un aviso pendiente */
     }
+    errno = saved_errno;
+}
+
+/* Crear el pipe de aviso e instalar el manejador de SIGWINCH */
+static void term_watch_resize(TerminalState *term) {
+    int fds[2];
+    term->resize_fd = -1;
+    if (pipe(fds) == -1) return;
 
-    return line_count;
+    for (int i = 0; i < 2; i++) {
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+    }
+    resize_pipe_write = fds[1];
+    term->resize_fd = fds[0];
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = term_sigwinch_handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGWINCH, &sa, NULL);
 }
 
 /* Inicializar terminal */
@@ -146,10 +111,23 @@ void term_init(TerminalState *term) {
     tcgetattr(STDIN_FILENO, &term->original_termios);
     term->raw_mode = false;
     term->blink_state = false;       /* Inicializar estado de parpadeo */
-    term->blink_frame_count = 0;     /* Inicializar contador de frames */
-
-    /* Obtener tamaño del terminal */
+    term->dirty = REDRAW_ALL;
+    memset(term->pane_dirty, 0, sizeof(term->pane_dirty));
+    term->status_mask = 0;
+    term->max_fps = DEFAULT_MAX_FPS;
+    term->last_frame_ms = 0;
+    term->coalesced = 0;
+    term->resizes = 0;
+    screen_init(&term->screen);
+
+    /* Color directo solo si el terminal lo anuncia (si no, paleta de 256) */
+    const char *colorterm = getenv("COLORTERM");
+    term->screen.truecolor = colorterm &&
+        (strcmp(colorterm, "truecolor") == 0 || strcmp(colorterm, "24bit") == 0);
+
+    /* Obtener tamaño del terminal y vigilar sus cambios */
     term_get_size(term);
+    term_watch_resize(term);
 
     /* Configurar locale para UTF-8 */
     setlocale(LC_ALL, "");
@@ -163,10 +141,16 @@ void term_cleanup(TerminalState *term) {
         term_exit_raw_mode(term);
     }
 
-    term_show_cursor();
-    term_clear_screen();
-    printf(ANSI_HOME);
-    fflush(stdout);
+    screen_write(&term->screen, ANSI_RESET ANSI_SHOW_CURSOR ANSI_CLEAR_SCREEN ANSI_HOME);
+    screen_free(&term->screen);
+
+    if (term->resize_fd >= 0) {
+        signal(SIGWINCH, SIG_DFL);
+        close(resize_pipe_write);
+        close(term->resize_fd);
+        resize_pipe_write = -1;
+        term->resize_fd = -1;
+    }
 }
 
 /* Entrar en modo raw (sin buffering, sin echo) */
@@ -209,281 +193,375 @@ void term_get_size(TerminalState *term) {
         term->rows = ws.ws_row;
         term->cols = ws.ws_col;
     }
+
+    /* Ajustar el modelo de pantalla (si cambió el tamaño se repinta todo) */
+    if (term->rows != term->screen.rows || term->cols != term->screen.cols) {
+        term->dirty |= REDRAW_ALL;
+    }
+    screen_resize(&term->screen, term->rows, term->cols);
 }
 
-/* Limpiar pantalla */
-void term_clear_screen(void) {
-    printf(ANSI_CLEAR_SCREEN);
-    printf(ANSI_HOME);
-    fflush(stdout);
+/* Atender los avisos de SIGWINCH pendientes
+ * Una ráfaga de señales se vacía de una vez y produce una sola consulta del
+ * tamaño; el repintado completo pasa por el planificador como cualquier
+ * otra región, así que los redimensionados seguidos se agrupan en un frame.
+ */
+void term_handle_resize(TerminalState *term) {
+    if (!term || term->resize_fd < 0) return;
+
+    char drain[64];
+    bool pending = false;
+    while (read(term->resize_fd, drain, sizeof(drain)) > 0) {
+        pending = true;
+    }
+    if (!pending) return;
+
+    term->resizes++;
+    term_get_size(term);
+
+    /* El terminal puede haber recolocado el texto aunque el tamaño final
+     * coincida con el anterior: no fiarse de lo que muestra */
+    screen_invalidate(&term->screen);
+    term->dirty |= REDRAW_ALL;
 }
 
-/* Mover cursor a una posición */
-void term_move_cursor(int row, int col) {
-    printf("\033[%d;%dH", row, col);
-    fflush(stdout);
+/* Reloj monotónico en milisegundos */
+static long long term_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
-/* Ocultar cursor */
-void term_hide_cursor(void) {
-    printf(ANSI_HIDE_CURSOR);
-    fflush(stdout);
+/* Indicadores de actividad que deben mostrarse */
+static unsigned term_status_mask(WindowManager *wm, bool notify_alert, bool mention_alert) {
+    unsigned mask = 0;
+    if (notify_alert) mask |= STATUS_NOTIFY;
+    if (mention_alert) mask |= STATUS_MENTION;
+    if (wm_has_new_privates(wm)) mask |= STATUS_PRIVATE;
+    if (wm_has_unread_messages(wm)) mask |= STATUS_UNREAD;
+    return mask;
 }
 
-/* Mostrar cursor */
-void term_show_cursor(void) {
-    printf(ANSI_SHOW_CURSOR);
-    fflush(stdout);
+/* Avanzar el parpadeo según el reloj (solo redibuja si hay indicadores) */
+static void term_update_blink(TerminalState *term, long long now) {
+    bool state = (now / TERM_BLINK_MS) % 2 != 0;
+    if (state != term->blink_state) {
+        term->blink_state = state;
+        if (term->status_mask) {
+            term->dirty |= REDRAW_STATUS;
+        }
+    }
 }
 
-/* Dibujar línea horizontal */
-void term_draw_horizontal_line(int row, int width) {
-    term_move_cursor(row, 1);
-    for (int i = 0; i < width; i++) {
-        printf(UNICODE_HLINE);
+/* Hay algo pendiente de dibujar (global o en algún panel) */
+static bool term_pending(TerminalState *term) {
+    if (term->dirty) return true;
+    for (int i = 0; i < MAX_PANES; i++) {
+        if (term->pane_dirty[i]) return true;
     }
-    fflush(stdout);
+    return false;
 }
 
-/* Dibujar línea vertical */
-void term_draw_vertical_line(int col, int start_row, int end_row) {
-    for (int row = start_row; row <= end_row; row++) {
-        term_move_cursor(row, col);
-        printf(UNICODE_VLINE);
+/* Marcar regiones de la pantalla para el próximo frame */
+void term_request_redraw(TerminalState *term, unsigned regions) {
+    if (!term) return;
+    term->dirty |= regions;
+}
+
+/* Milisegundos hasta el próximo frame permitido
+ * Devuelve -1 si no hay nada pendiente (ni parpadeo que animar).
+ */
+int term_redraw_timeout(TerminalState *term) {
+    if (!term) return -1;
+
+    long long now = term_now_ms();
+    term_update_blink(term, now);
+
+    if (!term_pending(term)) {
+        return term->status_mask ? (int)(TERM_BLINK_MS - now % TERM_BLINK_MS) : -1;
     }
-    fflush(stdout);
+    if (term->max_fps <= 0) return 0;
+
+    long long next = term->last_frame_ms + 1000 / term->max_fps;
+    return next > now ? (int)(next - now) : 0;
 }
 
-/* Dibujar separador horizontal */
-void term_draw_separator(int col_width) {
-    for (int i = 0; i < col_width; i++) {
-        printf(UNICODE_HLINE);
+/* Dibujar las regiones pendientes si toca
+ * Con immediate (eco de la entrada del usuario) se dibuja ya; si no, las
+ * peticiones se agrupan hasta que el límite de frames por segundo lo permita.
+ * Devuelve true si se dibujó un frame.
+ */
+bool term_redraw(TerminalState *term, WindowManager *wm, const char *input_line, int cursor_pos, bool notify_alert, bool mention_alert, bool immediate) {
+    if (!term || !wm) return false;
+
+    term->dirty |= wm_take_redraw(wm, term->pane_dirty);
+
+    unsigned mask = term_status_mask(wm, notify_alert, mention_alert);
+    if (mask != term->status_mask) {
+        term->status_mask = mask;
+        term->dirty |= REDRAW_STATUS;
+    }
+
+    if (!term_pending(term)) return false;
+    if (!immediate && term_redraw_timeout(term) > 0) {
+        term->coalesced++;
+        return false;
     }
+
+    term_draw_interface(term, wm, input_line, cursor_pos, notify_alert, mention_alert);
+    return true;
 }
 
-/* Dibujar interfaz completa */
-void term_draw_interface(TerminalState *term, WindowManager *wm, const char *input_line, int cursor_pos, bool notify_alert, bool mention_alert) {
-    if (!term || !wm) return;
+/* Dibujar línea horizontal */
+void term_draw_horizontal_line(TerminalState *term, int row, int width, const CellStyle *style) {
+    screen_fill(&term->screen, row, 1, width, UNICODE_HLINE_CP, style);
+}
+
+/* Dibujar línea vertical */
+void term_draw_vertical_line(TerminalState *term, int col, int start_row, int end_row) {
+    for (int row = start_row; row <= end_row; row++) {
+        screen_fill(&term->screen, row, col, 1, UNICODE_VLINE_CP, NULL);
+    }
+}
 
-    /* Alternar estado de parpadeo cada 10 frames (aproximadamente 1 segundo) */
-    term->blink_frame_count++;
-    if (term->blink_frame_count >= 10) {
-        term->blink_state = !term->blink_state;
-        term->blink_frame_count = 0;
+/* Calcular la zona de un panel
+ * Los paneles se reparten las filas entre el borde superior y la línea
+ * separadora (apilados) o las columnas, con una línea vertical entre ellos.
+ */
+static void term_pane_rect(TerminalState *term, WindowManager *wm, int pane, PaneRect *rect) {
+    int rows = term->rows - 2;
+    int count = wm->pane_count;
+
+    rect->row = 1;
+    rect->col = 1;
+    rect->rows = rows;
+    rect->cols = term->cols;
+    rect->focused = pane == wm->active_pane;
+
+    if (count <= 1) return;
+
+    if (wm->split == SPLIT_VERTICAL) {
+        int usable = term->cols - (count - 1);
+        rect->col = 1 + pane * usable / count + pane;
+        rect->cols = (pane + 1) * usable / count - pane * usable / count;
+    } else {
+        rect->row = 1 + pane * rows / count;
+        rect->rows = (pane + 1) * rows / count - pane * rows / count;
     }
+}
 
-    term_hide_cursor();
-    term_clear_screen();
+/* Dibujar las regiones pendientes de un panel */
+static void term_draw_pane(TerminalState *term, WindowManager *wm, int pane, unsigned regions) {
+    Screen *scr = &term->screen;
+    PaneRect rect;
+    term_pane_rect(term, wm, pane, &rect);
+    if (rect.rows < 2 || rect.cols < 4) return;
+
+    /* Panel completo: limpiar su zona y el tramo de separador que tiene debajo
+     * (la ventana anterior pudo dejar ahí una unión) */
+    if ((regions & REDRAW_WINDOW) == REDRAW_WINDOW) {
+        screen_clear_area(scr, rect.row, rect.col, rect.rows, rect.cols);
+        if (rect.row + rect.rows == term->rows - 1) {
+            screen_fill(scr, term->rows - 1, rect.col, rect.cols, UNICODE_HLINE_CP, &separator_style);
+        }
+    }
 
-    Window *active_win = wm_get_active_window(wm);
-    if (!active_win) {
-        term_show_cursor();
+    Window *win = wm_get_window(wm, wm->panes[pane]);
+    if (!win) {
+        /* Panel vacío: lo ocupará la próxima ventana que se abra */
+        if (regions & REDRAW_TITLE) {
+            screen_clear_area(scr, rect.row, rect.col, 1, rect.cols);
+            screen_put_text(scr, rect.row, rect.col, rect.cols, ANSI_GRAY "(panel vacío)" ANSI_RESET, NULL);
+        }
         return;
     }
 
     /* Dibujar contenido según el tipo de ventana */
-    switch (active_win->type) {
+    switch (win->type) {
         case WIN_SYSTEM:
         case WIN_PRIVATE:
         case WIN_LIST:
         case WIN_DEBUG:
-            term_draw_system_window(term, active_win);
+        case WIN_GREP:
+            term_draw_system_window(term, win, &rect, regions);
             break;
         case WIN_CHANNEL:
-            term_draw_channel_window(term, active_win);
+            term_draw_channel_window(term, win, &rect, regions);
             break;
     }
-
-    /* Dibujar línea separadora */
-    int separator_row = term->rows - 1;
-    term_move_cursor(separator_row, 1);
-    printf(ANSI_BOLD ANSI_CYAN);
-    term_draw_separator(term->cols);
-    printf(ANSI_RESET);
-
-    /* Dibujar prompt */
-    term_draw_prompt(term, wm, input_line, cursor_pos, notify_alert, mention_alert);
-
-    term_show_cursor();
-    fflush(stdout);
 }
 
-/* Dibujar ventana de sistema o privado */
-void term_draw_system_window(TerminalState *term, Window *win) {
-    if (!term || !win) return;
+/* Dibujar las regiones pendientes de la interfaz
+ * Las regiones no marcadas conservan lo pintado en frames anteriores y al
+ * final solo se envían al terminal las celdas que cambiaron. Cada panel se
+ * repinta solo si su ventana cambió; las regiones de term->dirty que son de
+ * ventana (scroll, etc.) se aplican al panel activo.
+ */
+void term_draw_interface(TerminalState *term, WindowManager *wm, const char *input_line, int cursor_pos, bool notify_alert, bool mention_alert) {
+    if (!term || !wm) return;
 
-    /* Título de la ventana */
-    term_move_cursor(1, 1);
-    printf(ANSI_BOLD ANSI_BLUE "[%s]" ANSI_RESET, win->title);
+    Window *active_win = wm_get_active_window(wm);
+    if (!active_win) return;
+
+    unsigned regions = term->dirty;
+    term->dirty = 0;
+    term->last_frame_ms = term_now_ms();
+
+    bool full = (regions & REDRAW_ALL) == REDRAW_ALL;
+    if (full) {
+        screen_clear(&term->screen);
+
+        /* Dibujar línea separadora (antes que las ventanas, que pueden añadir la unión) */
+        term_draw_horizontal_line(term, term->rows - 1, term->cols, &separator_style);
+
+        /* Líneas entre paneles lado a lado */
+        if (wm->split == SPLIT_VERTICAL) {
+            for (int i = 0; i < wm->pane_count - 1; i++) {
+                PaneRect rect;
+                term_pane_rect(term, wm, i, &rect);
+                int col = rect.col + rect.cols;
+                term_draw_vertical_line(term, col, 1, term->rows - 2);
+                screen_fill(&term->screen, term->rows - 1, col, 1, UNICODE_JUNCTION_CP, &separator_style);
+            }
+        }
+    }
 
-    int max_lines = term->rows - 3; /* Espacio disponible para mensajes */
-    int max_width = term->cols - 2;
+    for (int i = 0; i < MAX_PANES; i++) {
+        unsigned pane_regions = term->pane_dirty[i];
+        term->pane_dirty[i] = 0;
+        if (i >= wm->pane_count) continue;
 
-    /* Obtener una cantidad generosa de mensajes (200 o todos) */
-    int msg_count = 0;
-    char **messages = buffer_get_visible_messages(win->buffer, 200, &msg_count);
+        if (full) {
+            pane_regions = REDRAW_WINDOW;
+        } else if (i == wm->active_pane) {
+            pane_regions |= regions & REDRAW_WINDOW;
+        }
+        if (pane_regions) {
+            term_draw_pane(term, wm, i, pane_regions);
+        }
+    }
 
-    if (!messages || msg_count == 0) {
-        if (messages) free(messages);
-        return;
+    /* Dibujar prompt (comparte fila con los indicadores) */
+    if (regions & (REDRAW_PROMPT | REDRAW_STATUS)) {
+        screen_clear_row(&term->screen, term->rows);
+        term_draw_prompt(term, wm, input_line, cursor_pos, notify_alert, mention_alert);
     }
 
-    /* Primero: hacer word wrap de TODOS los mensajes y contar líneas totales */
-    char ***all_wrapped = malloc(sizeof(char**) * msg_count);
-    int *wrapped_counts = malloc(sizeof(int) * msg_count);
-    int total_lines = 0;
+    screen_flush(&term->screen);
+}
 
-    for (int i = 0; i < msg_count; i++) {
-        all_wrapped[i] = malloc(sizeof(char*) * 10);
-        wrapped_counts[i] = wrap_text(messages[i], max_width, all_wrapped[i], 10);
-        total_lines += wrapped_counts[i];
-    }
+/* Dibujar ventana de sistema o privado en un panel */
+void term_draw_system_window(TerminalState *term, Window *win, const PaneRect *pane, unsigned regions) {
+    if (!term || !win || !pane) return;
 
-    /* Calcular qué líneas mostrar (las últimas max_lines) */
-    int skip_lines = (total_lines > max_lines) ? (total_lines - max_lines) : 0;
+    Screen *scr = &term->screen;
 
-    /* Renderizar solo las líneas que caben en pantalla */
-    int current_row = 2;
-    int lines_skipped = 0;
+    /* Título de la ventana (atenuado si el panel no tiene el foco) */
+    if (regions & REDRAW_TITLE) {
+        char title[MAX_MSG_LEN];
+        snprintf(title, sizeof(title), "%s[%s]" ANSI_RESET,
+                 pane->focused ? ANSI_BOLD ANSI_BLUE : ANSI_GRAY, win->title);
 
-    for (int i = 0; i < msg_count && current_row < term->rows - 1; i++) {
-        for (int j = 0; j < wrapped_counts[i] && current_row < term->rows - 1; j++) {
-            if (lines_skipped < skip_lines) {
-                lines_skipped++;
-            } else {
-                term_move_cursor(current_row, 1);
-                printf(ANSI_CLEAR_LINE "%s", all_wrapped[i][j]);
-                current_row++;
-            }
+        /* Progreso de un LIST en curso */
+        if (win->type == WIN_LIST && win->list_receiving) {
+            size_t len = strlen(title);
+            snprintf(title + len, sizeof(title) - len, ANSI_GRAY " recibidos %d, coinciden %d..." ANSI_RESET,
+                     win->list_received, win->list_matched);
         }
+        screen_clear_area(scr, pane->row, pane->col, 1, pane->cols);
+        screen_put_text(scr, pane->row, pane->col, pane->cols, title, NULL);
     }
 
-    /* Liberar memoria */
-    for (int i = 0; i < msg_count; i++) {
-        for (int j = 0; j < wrapped_counts[i]; j++) {
-            free(all_wrapped[i][j]);
-        }
-        free(all_wrapped[i]);
-    }
-    free(all_wrapped);
-    free(wrapped_counts);
-    free(messages);
+    if (!(regions & REDRAW_MESSAGES)) return;
+    screen_clear_area(scr, pane->row + 1, pane->col, pane->rows - 1, pane->cols);
+
+    /* Mensajes bajo el título hasta el final del panel */
+    term_draw_messages(term, win, pane->row + 1, pane->row + pane->rows - 1, pane->col, pane->cols - 2);
 }
 
-/* Dibujar ventana de canal */
-void term_draw_channel_window(TerminalState *term, Window *win) {
-    if (!term || !win) return;
+/* Dibujar ventana de canal en un panel
+ * En paneles estrechos se omite la lista de usuarios.
+ */
+void term_draw_channel_window(TerminalState *term, Window *win, const PaneRect *pane, unsigned regions) {
+    if (!term || !win || !pane) return;
+
+    Screen *scr = &term->screen;
 
     /* Calcular anchos */
-    int user_list_width = 16;  /* Ancho de la lista de usuarios */
-    int separator_col = term->cols - user_list_width;
-    int chat_width = separator_col - 1;
+    int user_list_width = pane->cols >= USER_LIST_MIN_PANE_COLS ? 16 : 0;  /* Ancho de la lista de usuarios */
+    int separator_col = pane->col - 1 + pane->cols - user_list_width;
+    int chat_width = separator_col - pane->col;
+    if (user_list_width == 0) chat_width = pane->cols;
+    int list_top = pane->row + 1;
+    int list_bottom = pane->row + pane->rows - 1;
+    const char *title_color = pane->focused ? ANSI_BOLD ANSI_GREEN : ANSI_GRAY;
 
     /* Título de la ventana con topic */
-    term_move_cursor(1, 1);
-    printf(ANSI_CLEAR_LINE);
-
-    /* Calcular espacio disponible para el topic */
-    char header[MAX_MSG_LEN];
-    snprintf(header, sizeof(header), "[%s] (%d usuarios)", win->title, win->user_count);
-    int header_len = strlen(header);
-    int available_space = chat_width - header_len - 3;  /* -3 para " | " */
-
-    if (win->topic[0] != '\0' && available_space > 20) {
-        /* Truncar topic si es necesario */
-        char truncated_topic[256];
-        if ((int)strlen(win->topic) > available_space) {
-            strncpy(truncated_topic, win->topic, available_space - 3);
-            truncated_topic[available_space - 3] = '\0';
-            strcat(truncated_topic, "...");
+    if (regions & REDRAW_TITLE) {
+        /* Calcular espacio disponible para el topic */
+        char header[MAX_MSG_LEN];
+        snprintf(header, sizeof(header), "[%s] (%d usuarios)", win->title, win->user_count);
+        int header_len = text_width(header, -1);
+        int available_space = chat_width - header_len - 3;  /* -3 para " | " */
+
+        /* Título con el topic truncado al espacio disponible */
+        char title[MAX_MSG_LEN * 2];
+        if (win->topic[0] != '\0' && available_space > 20) {
+            /* Truncar topic si es necesario */
+            char truncated_topic[sizeof(win->topic) + 4];
+            if (text_width(win->topic, -1) > available_space) {
+                int len = text_fit(win->topic, available_space - 3);
+                memcpy(truncated_topic, win->topic, len);
+                strcpy(truncated_topic + len, "...");
+            } else {
+                strncpy(truncated_topic, win->topic, sizeof(truncated_topic) - 1);
+                truncated_topic[sizeof(truncated_topic) - 1] = '\0';
+            }
+
+            snprintf(title, sizeof(title), "%s[%s]" ANSI_RESET " (%d usuarios) " ANSI_GRAY "| %s" ANSI_RESET,
+                     title_color, win->title, win->user_count, truncated_topic);
         } else {
-            strncpy(truncated_topic, win->topic, sizeof(truncated_topic) - 1);
-            truncated_topic[sizeof(truncated_topic) - 1] = '\0';
+            snprintf(title, sizeof(title), "%s[%s]" ANSI_RESET " (%d usuarios)", title_color, win->title, win->user_count);
         }
-
-        printf(ANSI_BOLD ANSI_GREEN "[%s]" ANSI_RESET " (%d usuarios) " ANSI_GRAY "| %s" ANSI_RESET,
-               win->title, win->user_count, truncated_topic);
-    } else {
-        printf(ANSI_BOLD ANSI_GREEN "[%s]" ANSI_RESET " (%d usuarios)", win->title, win->user_count);
+        screen_clear_area(scr, pane->row, pane->col, 1, chat_width);
+        screen_put_text(scr, pane->row, pane->col, chat_width, title, NULL);
     }
 
-    int max_lines = term->rows - 3;
-    int max_msg_width = chat_width - 1;
-
-    /* Obtener una cantidad generosa de mensajes */
-    int msg_count = 0;
-    char **messages = buffer_get_visible_messages(win->buffer, 200, &msg_count);
-
-    if (messages && msg_count > 0) {
-        /* Hacer word wrap de TODOS los mensajes y contar líneas totales */
-        char ***all_wrapped = malloc(sizeof(char**) * msg_count);
-        int *wrapped_counts = malloc(sizeof(int) * msg_count);
-        int total_lines = 0;
-
-        for (int i = 0; i < msg_count; i++) {
-            all_wrapped[i] = malloc(sizeof(char*) * 10);
-            wrapped_counts[i] = wrap_text(messages[i], max_msg_width, all_wrapped[i], 10);
-            total_lines += wrapped_counts[i];
-        }
-
-        /* Calcular qué líneas mostrar (las últimas max_lines) */
-        int skip_lines = (total_lines > max_lines) ? (total_lines - max_lines) : 0;
-
-        /* Renderizar solo las líneas que caben */
-        int current_row = 2;
-        int lines_skipped = 0;
-
-        for (int i = 0; i < msg_count && current_row < term->rows - 1; i++) {
-            for (int j = 0; j < wrapped_counts[i] && current_row < term->rows - 1; j++) {
-                if (lines_skipped < skip_lines) {
-                    lines_skipped++;
-                } else {
-                    term_move_cursor(current_row, 1);
-                    printf(ANSI_CLEAR_LINE "%s", all_wrapped[i][j]);
-                    current_row++;
-                }
-            }
-        }
-
-        /* Liberar memoria */
-        for (int i = 0; i < msg_count; i++) {
-            for (int j = 0; j < wrapped_counts[i]; j++) {
-                free(all_wrapped[i][j]);
-            }
-            free(all_wrapped[i]);
-        }
-        free(all_wrapped);
-        free(wrapped_counts);
-        free(messages);
+    if (regions & REDRAW_MESSAGES) {
+        screen_clear_area(scr, list_top, pane->col, pane->rows - 1, chat_width);
+        term_draw_messages(term, win, list_top, list_bottom, pane->col, chat_width - 1);
     }
 
+    if (!(regions & REDRAW_USERS) || user_list_width == 0) return;
+    screen_clear_area(scr, list_top, separator_col, pane->rows - 1, user_list_width + 1);
+
     /* Dibujar línea vertical separadora */
-    term_draw_vertical_line(separator_col, 2, term->rows - 2);
+    term_draw_vertical_line(term, separator_col, list_top, list_bottom);
 
-    /* Dibujar unión en el separador horizontal */
-    term_move_cursor(term->rows - 1, separator_col);
-    printf(UNICODE_JUNCTION);
+    /* Dibujar unión en el separador horizontal (si el panel llega hasta él) */
+    if (list_bottom == term->rows - 2) {
+        screen_fill(scr, term->rows - 1, separator_col, 1, UNICODE_JUNCTION_CP, &separator_style);
+    }
 
     /* Dibujar lista de usuarios */
-    int user_row = 2;
-    int max_user_rows = term->rows - 3;
+    int user_row = list_top;
     int max_nick_display = user_list_width - 4; /* Espacio para nick (descontando márgenes) */
 
-    term_move_cursor(user_row, separator_col + 2);
-    printf(ANSI_BOLD "Usuarios:" ANSI_RESET);
+    int col = separator_col + 2;
+    col += screen_put_text(scr, user_row, col, 0, ANSI_BOLD "Usuarios:" ANSI_RESET, NULL);
 
     /* Verificar si hay nicks largos para mostrar indicador */
     UserNode *check = win->users;
     bool has_long_nicks = false;
     while (check) {
-        if ((int)strlen(check->nick) > max_nick_display) {
+        if (text_width(check->nick, -1) > max_nick_display) {
             has_long_nicks = true;
             break;
         }
         check = check->next;
     }
     if (has_long_nicks) {
-        printf(" " ANSI_YELLOW "→" ANSI_RESET);
+        screen_put_text(scr, user_row, col, 0, " " ANSI_YELLOW "→" ANSI_RESET, NULL);
     }
 
     user_row++;
@@ -497,9 +575,7 @@ void term_draw_channel_window(TerminalState *term, Window *win) {
     }
 
     /* Dibujar usuarios visibles */
-    while (user && user_row <= max_user_rows + 1) {
-        term_move_cursor(user_row, separator_col + 2);
-
+    while (user && user_row <= list_bottom) {
         /* Mostrar prefijo de modo si existe */
         const char *color = ANSI_GRAY;
         char prefix = ' ';
@@ -523,20 +599,17 @@ void term_draw_channel_window(TerminalState *term, Window *win) {
 
         /* Truncar nick si es más largo que el espacio disponible */
         char display_nick[MAX_NICK_LEN];
-        int nick_len = strlen(user->nick);
-        if (nick_len > max_nick_display) {
-            strncpy(display_nick, user->nick, max_nick_display);
-            display_nick[max_nick_display] = '\0';
-        } else {
-            strncpy(display_nick, user->nick, MAX_NICK_LEN - 1);
-            display_nick[MAX_NICK_LEN - 1] = '\0';
-        }
+        int nick_len = text_fit(user->nick, max_nick_display);
+        memcpy(display_nick, user->nick, nick_len);
+        display_nick[nick_len] = '\0';
 
+        char entry[MAX_NICK_LEN + 32];
         if (prefix != ' ') {
-            printf("%s%c%s" ANSI_RESET, color, prefix, display_nick);
+            snprintf(entry, sizeof(entry), "%s%c%s" ANSI_RESET, color, prefix, display_nick);
         } else {
-            printf("%s%s" ANSI_RESET, color, display_nick);
+            snprintf(entry, sizeof(entry), "%s%s" ANSI_RESET, color, display_nick);
         }
+        screen_put_text(scr, user_row, separator_col + 2, user_list_width - 2, entry, NULL);
 
         user = user->next;
         user_row++;
@@ -544,40 +617,90 @@ void term_draw_channel_window(TerminalState *term, Window *win) {
 
     /* Indicador de scroll si hay más usuarios */
     if (win->user_scroll_offset > 0) {
-        term_move_cursor(2, separator_col + user_list_width - 1);
-        printf(ANSI_YELLOW "↑" ANSI_RESET);
+        screen_put_text(scr, list_top, separator_col + user_list_width - 1, 1, ANSI_YELLOW "↑" ANSI_RESET, NULL);
     }
     if (user != NULL) {
-        term_move_cursor(max_user_rows + 1, separator_col + user_list_width - 1);
-        printf(ANSI_YELLOW "↓" ANSI_RESET);
+        screen_put_text(scr, list_bottom, separator_col + user_list_width - 1, 1, ANSI_YELLOW "↓" ANSI_RESET, NULL);
     }
 }
 
 /* Dibujar ventana privada (similar a sistema) */
-void term_draw_private_window(TerminalState *term, Window *win) {
-    term_draw_system_window(term, win);
+void term_draw_private_window(TerminalState *term, Window *win, const PaneRect *pane, unsigned regions) {
+    term_draw_system_window(term, win, pane, regions);
+}
+
+/* Barra de actividad: ventanas de fondo con mensajes sin leer
+ * Formato "[Act: 2:14 5:3(1) 7]" (ventana:mensajes(menciones)), en orden de
+ * ventana y con el color de su nivel. Ocupa como mucho media fila y termina
+ * en la columna last_col.
+ */
+static void term_draw_activity(TerminalState *term, WindowManager *wm, int last_col) {
+    int ids[MAX_WINDOWS];
+    int count = wm_activity_windows(wm, ids);
+    if (count == 0) return;
+
+    int budget = term->cols / 2;
+    char bar[1024];
+    size_t len = (size_t)snprintf(bar, sizeof(bar), ANSI_GRAY "[Act:" ANSI_RESET);
+    int width = 5;
+
+    for (int i = 0; i < count; i++) {
+        Window *win = wm->windows[ids[i]];
+        char entry[48];
+        int entry_width;
+        if (win->highlight_count > 0) {
+            entry_width = snprintf(entry, sizeof(entry), " %d:%d(%d)", win->id, win->unread_count, win->highlight_count);
+        } else if (win->unread_count > 0) {
+            entry_width = snprintf(entry, sizeof(entry), " %d:%d", win->id, win->unread_count);
+        } else {
+            entry_width = snprintf(entry, sizeof(entry), " %d", win->id);
+        }
+
+        /* Si no caben todas, se corta con una elipsis */
+        int reserve = (i < count - 1) ? 2 : 0;
+        if (width + entry_width + reserve + 1 > budget || len + 64 > sizeof(bar)) {
+            len += (size_t)snprintf(bar + len, sizeof(bar) - len, " …");
+            width += 2;
+            break;
+        }
+
+        const char *color = ANSI_YELLOW;
+        if (win->activity == ACTIVITY_HIGHLIGHT) {
+            color = ANSI_BOLD ANSI_MAGENTA;
+        } else if (win->activity == ACTIVITY_PRIVATE) {
+            color = ANSI_BOLD ANSI_RED;
+        }
+        len += (size_t)snprintf(bar + len, sizeof(bar) - len, "%s%s" ANSI_RESET, color, entry);
+        width += entry_width;
+    }
+    snprintf(bar + len, sizeof(bar) - len, ANSI_GRAY "]" ANSI_RESET);
+    width++;
+
+    int col = last_col - width + 1;
+    if (col < 1) return;
+    screen_put_text(&term->screen, term->rows, col, width, bar, NULL);
 }
 
 /* Dibujar prompt de entrada */
 void term_draw_prompt(TerminalState *term, WindowManager *wm, const char *input_line, int cursor_pos, bool notify_alert, bool mention_alert) {
     if (!term) return;
 
+    Screen *scr = &term->screen;
     int prompt_row = term->rows;
-    term_move_cursor(prompt_row, 1);
-    printf(ANSI_CLEAR_LINE);
 
     /* Mostrar prompt */
-    printf(ANSI_BOLD ANSI_YELLOW "> " ANSI_RESET);
+    int col = 1;
+    col += screen_put_text(scr, prompt_row, col, 0, ANSI_BOLD ANSI_YELLOW "> " ANSI_RESET, NULL);
 
     /* Mostrar línea de entrada */
     if (input_line) {
-        printf("%s", input_line);
+        screen_put_text(scr, prompt_row, col, 0, input_line, NULL);
     }
 
     /* Mostrar indicadores de actividad al final de la línea */
     if (wm) {
         /* Construir string con todos los indicadores activos */
-        char indicators[32] = "";
+        char indicators[64] = "";
         int ind_count = 0;
 
         /* C para nicks conectados (notify alert) - verde */
@@ -620,15 +743,19 @@ void term_draw_prompt(TerminalState *term, WindowManager *wm, const char *input_
             ind_count++;
         }
 
+        /* Calcular columna considerando número de indicadores (cada uno ocupa 2 espacios) */
+        int indicator_col = term->cols - (ind_count * 2);
+
+        /* Barra de actividad a la izquierda de los indicadores */
+        term_draw_activity(term, wm, indicator_col - 1);
+
         /* Mostrar todos los indicadores si hay alguno */
         if (ind_count > 0) {
-            /* Calcular columna considerando número de indicadores (cada uno ocupa 2 espacios) */
-            int indicator_col = term->cols - (ind_count * 2);
-            term_move_cursor(prompt_row, indicator_col);
-            printf("%s", indicators);
+            screen_put_text(scr, prompt_row, indicator_col, 0, indicators, NULL);
         }
     }
 
     /* Posicionar cursor */
-    term_move_cursor(prompt_row, 3 + cursor_pos);
+    /* cursor_pos es un offset en bytes: convertirlo a columnas */
+    screen_set_cursor(scr, prompt_row, 3 + text_width(input_line, cursor_pos));
 }
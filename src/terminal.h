@@ -3,8 +3,21 @@
 
 #include "common.h"
 #include "windows.h"
+#include "screen.h"
 #include <termios.h>
 
+/* Periodo de parpadeo de los indicadores de actividad */
+#define TERM_BLINK_MS 1000
+
+/* Zona de la pantalla de un panel (1-based): título en la primera fila */
+typedef struct {
+    int row;
+    int col;
+    int rows;
+    int cols;
+    bool focused;           /* Panel activo (título resaltado) */
+} PaneRect;
+
 /* Estado del terminal */
 typedef struct {
     struct termios original_termios;
@@ -12,7 +25,16 @@ typedef struct {
     int cols;
     bool raw_mode;
     bool blink_state;       /* Estado del parpadeo para notificaciones */
-    int blink_frame_count;  /* Contador de frames para controlar velocidad de parpadeo */
+    Screen screen;          /* Modelo de pantalla (frame anterior y frame en construcción) */
+    /* Planificador de redibujado */
+    unsigned dirty;         /* Regiones pendientes de redibujar (REDRAW_*) */
+    unsigned pane_dirty[MAX_PANES];     /* Regiones pendientes de cada panel */
+    unsigned status_mask;   /* Indicadores de actividad del último frame */
+    int max_fps;            /* Frames por segundo máximos (0 = sin límite) */
+    long long last_frame_ms;    /* Instante del último frame (reloj monotónico) */
+    unsigned long coalesced;    /* Peticiones de redibujado agrupadas en otro frame */
+    int resize_fd;          /* Aviso de SIGWINCH para select() (-1 si no hay) */
+    unsigned long resizes;  /* Ráfagas de redimensionado atendidas */
 } TerminalState;
 
 /* Funciones de control del terminal */
@@ -21,19 +43,20 @@ void term_cleanup(TerminalState *term);
 void term_enter_raw_mode(TerminalState *term);
 void term_exit_raw_mode(TerminalState *term);
 void term_get_size(TerminalState *term);
-void term_clear_screen(void);
-void term_move_cursor(int row, int col);
-void term_hide_cursor(void);
-void term_show_cursor(void);
+void term_handle_resize(TerminalState *term);
+
+/* Planificador de redibujado */
+void term_request_redraw(TerminalState *term, unsigned regions);
+int term_redraw_timeout(TerminalState *term);
+bool term_redraw(TerminalState *term, WindowManager *wm, const char *input_line, int cursor_pos, bool notify_alert, bool mention_alert, bool immediate);
 
 /* Funciones de dibujo */
 void term_draw_interface(TerminalState *term, WindowManager *wm, const char *input_line, int cursor_pos, bool notify_alert, bool mention_alert);
-void term_draw_separator(int col_width);
-void term_draw_system_window(TerminalState *term, Window *win);
-void term_draw_channel_window(TerminalState *term, Window *win);
-void term_draw_private_window(TerminalState *term, Window *win);
+void term_draw_system_window(TerminalState *term, Window *win, const PaneRect *pane, unsigned regions);
+void term_draw_channel_window(TerminalState *term, Window *win, const PaneRect *pane, unsigned regions);
+void term_draw_private_window(TerminalState *term, Window *win, const PaneRect *pane, unsigned regions);
 void term_draw_prompt(TerminalState *term, WindowManager *wm, const char *input_line, int cursor_pos, bool notify_alert, bool mention_alert);
-void term_draw_horizontal_line(int row, int width);
-void term_draw_vertical_line(int col, int start_row, int end_row);
+void term_draw_horizontal_line(TerminalState *term, int row, int width, const CellStyle *style);
+void term_draw_vertical_line(TerminalState *term, int col, int start_row, int end_row);
 
 #endif /* TERMINAL_H */
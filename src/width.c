@@ -0,0 +1,90 @@
+#include "width.h"
+#include "width_table.h"
+
+/* Columnas de un codepoint */
+int char_width(uint32_t cp) {
+    if (cp < 0x80) return cp >= 0x20 && cp != 0x7F ? 1 : 0;
+    if (cp >= 0x110000) return 1;
+
+    const uint8_t *block = width_stage2[width_stage1[cp >> WIDTH_BLOCK_SHIFT]];
+    unsigned index = cp & 0xFF;
+    return (block[index >> 2] >> ((index & 3) * 2)) & 3;
+}
+
+/* Decodificar un carácter UTF-8; devuelve los bytes consumidos */
+int utf8_decode(const char *s, uint32_t *cp) {
+    const unsigned char *u = (const unsigned char *)s;
+    int len;
+
+    if (u[0] < 0x80) {
+        *cp = u[0];
+        return 1;
+    } else if ((u[0] & 0xE0) == 0xC0) {
+        *cp = u[0] & 0x1F;
+        len = 2;
+    } else if ((u[0] & 0xF0) == 0xE0) {
+        *cp = u[0] & 0x0F;
+        len = 3;
+    } else if ((u[0] & 0xF8) == 0xF0) {
+        *cp = u[0] & 0x07;
+        len = 4;
+    } else {
+        *cp = 0xFFFD;
+        return 1;
+    }
+
+    for (int i = 1; i < len; i++) {
+        if ((u[i] & 0xC0) != 0x80) {
+            *cp = 0xFFFD;
+            return i;
+        }
+        *cp = (*cp << 6) | (u[i] & 0x3F);
+    }
+    return len;
+}
+
+/* Saltar una secuencia CSI (ESC [ ... final); devuelve los bytes saltados */
+static int skip_csi(const char *s) {
+    int i = 2;
+    while (s[i] && !(s[i] >= 0x40 && s[i] <= 0x7E)) i++;
+    return s[i] ? i + 1 : i;
+}
+
+/* Columnas de los primeros len bytes de un texto */
+int text_width(const char *text, int len) {
+    if (!text) return 0;
+
+    int cols = 0;
+    int pos = 0;
+    while (text[pos] && (len < 0 || pos < len)) {
+        if (text[pos] == '\033' && text[pos + 1] == '[') {
+            pos += skip_csi(text + pos);
+            continue;
+        }
+        uint32_t cp;
+        pos += utf8_decode(text + pos, &cp);
+        cols += char_width(cp);
+    }
+    return cols;
+}
+
+/* Bytes del prefijo más largo que cabe en max_cols columnas */
+int text_fit(const char *text, int max_cols) {
+    if (!text) return 0;
+
+    int cols = 0;
+    int pos = 0;
+    while (text[pos]) {
+        if (text[pos] == '\033' && text[pos + 1] == '[') {
+            pos += skip_csi(text + pos);
+            continue;
+        }
+        uint32_t cp;
+        int bytes = utf8_decode(text + pos, &cp);
+        int width = char_width(cp);
+        if (cols + width > max_cols) break;
+        cols += width;
+        pos += bytes;
+    }
+    return pos;
+}
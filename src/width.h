@@ -0,0 +1,28 @@
+#ifndef WIDTH_H
+#define WIDTH_H
+
+#include "common.h"
+#include <stdint.h>
+
+/* Ancho en columnas de caracteres y textos UTF-8
+ * La tabla se genera al compilar (gen_width.c) con un índice de dos niveles:
+ * un acceso por nivel, sin búsquedas.
+ */
+
+/* Columnas de un codepoint: 0 (combinantes, formato), 1 o 2 (CJK, emoji) */
+int char_width(uint32_t cp);
+
+/* Decodificar un carácter UTF-8; devuelve los bytes consumidos (U+FFFD si no es válido) */
+int utf8_decode(const char *s, uint32_t *cp);
+
+/* Columnas de los primeros len bytes de un texto (len < 0 = todo)
+ * Se ignoran las secuencias ANSI y los caracteres de control.
+ */
+int text_width(const char *text, int len);
+
+/* Bytes del prefijo más largo del texto que cabe en max_cols columnas
+ * (sin cortar caracteres; las secuencias ANSI no ocupan columnas)
+ */
+int text_fit(const char *text, int max_cols);
+
+#endif /* WIDTH_H */
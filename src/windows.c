@@ -1,9 +1,15 @@
 #include "windows.h"
+#include "screen.h"
+#include "logger.h"
+#include "clock.h"
 #include <strings.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
 #include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 /* Crear gestor de ventanas */
 WindowManager* wm_create(void) {
@@ -16,6 +22,21 @@ WindowManager* wm_create(void) {
 
     wm->active_window = 0;
     wm->window_count = 0;
+    wm->redraw = REDRAW_ALL;
+
+    /* Un solo panel, que ocupará la ventana de sistema */
+    wm->split = SPLIT_NONE;
+    for (int i = 0; i < MAX_PANES; i++) {
+        wm->panes[i] = -1;
+    }
+    wm->pane_count = 1;
+    wm->active_pane = 0;
+
+    /* Sin actividad pendiente */
+    wm->activity_count = 0;
+    wm->activity_clock = 0;
+    wm->new_privates = 0;
+    wm->unread_windows = 0;
 
     /* Crear ventana de sistema (ID 0) */
     wm_create_window(wm, WIN_SYSTEM, "Sistema");
@@ -31,6 +52,7 @@ void wm_destroy(WindowManager *wm) {
         if (wm->windows[i]) {
             buffer_destroy(wm->windows[i]->buffer);
             window_clear_users(wm->windows[i]);
+            window_clear_search(wm->windows[i]);
             free(wm->windows[i]);
         }
     }
@@ -38,6 +60,99 @@ void wm_destroy(WindowManager *wm) {
     free(wm);
 }
 
+/* La ventana a va antes que b en la cola de actividad
+ * Primero el nivel más alto; a igual nivel, la que lo alcanzó antes.
+ */
+static bool activity_before(WindowManager *wm, int a, int b) {
+    Window *wa = wm->windows[a];
+    Window *wb = wm->windows[b];
+    if (wa->activity != wb->activity) return wa->activity > wb->activity;
+    return wa->activity_seq < wb->activity_seq;
+}
+
+/* Intercambiar dos posiciones del montículo de actividad */
+static void activity_swap(WindowManager *wm, int i, int j) {
+    int a = wm->activity_heap[i];
+    int b = wm->activity_heap[j];
+    wm->activity_heap[i] = b;
+    wm->activity_heap[j] = a;
+    wm->windows[b]->activity_slot = i;
+    wm->windows[a]->activity_slot = j;
+}
+
+/* Subir una posición del montículo hasta su sitio */
+static void activity_sift_up(WindowManager *wm, int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!activity_before(wm, wm->activity_heap[i], wm->activity_heap[parent])) break;
+        activity_swap(wm, i, parent);
+        i = parent;
+    }
+}
+
+/* Bajar una posición del montículo hasta su sitio */
+static void activity_sift_down(WindowManager *wm, int i) {
+    for (;;) {
+        int best = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < wm->activity_count &&
+            activity_before(wm, wm->activity_heap[left], wm->activity_heap[best])) {
+            best = left;
+        }
+        if (right < wm->activity_count &&
+            activity_before(wm, wm->activity_heap[right], wm->activity_heap[best])) {
+            best = right;
+        }
+        if (best == i) break;
+        activity_swap(wm, i, best);
+        i = best;
+    }
+}
+
+/* Subir el nivel de actividad de una ventana (entra en la cola si no estaba) */
+static void wm_raise_activity(WindowManager *wm, Window *win, ActivityLevel level) {
+    if (level <= win->activity) return;
+
+    win->activity = level;
+    win->activity_seq = ++wm->activity_clock;
+    if (win->activity_slot < 0) {
+        win->activity_slot = wm->activity_count;
+        wm->activity_heap[wm->activity_count++] = win->id;
+    }
+    activity_sift_up(wm, win->activity_slot);
+    wm->redraw |= REDRAW_STATUS;
+}
+
+/* Borrar la actividad de una ventana (al verla o al cerrarla) */
+static void wm_clear_activity(WindowManager *wm, Window *win) {
+    if (win->is_new) {
+        wm->new_privates--;
+    } else if (win->has_unread) {
+        wm->unread_windows--;
+    }
+    win->has_unread = false;
+    win->is_new = false;
+    win->unread_count = 0;
+    win->highlight_count = 0;
+    win->activity = ACTIVITY_NONE;
+
+    int slot = win->activity_slot;
+    if (slot < 0) return;
+
+    /* Sacarla del montículo: el último ocupa su hueco y se recoloca */
+    win->activity_slot = -1;
+    int last = --wm->activity_count;
+    if (slot != last) {
+        int moved = wm->activity_heap[last];
+        wm->activity_heap[slot] = moved;
+        wm->windows[moved]->activity_slot = slot;
+        activity_sift_up(wm, slot);
+        activity_sift_down(wm, wm->windows[moved]->activity_slot);
+    }
+    wm->redraw |= REDRAW_STATUS;
+}
+
 /* Crear una nueva ventana */
 int wm_create_window(WindowManager *wm, WindowType type, const char *title) {
     if (!wm || wm->window_count >= MAX_WINDOWS) return -1;
@@ -66,45 +181,121 @@ int wm_create_window(WindowManager *wm, WindowType type, const char *title) {
     win->user_scroll_offset = 0;
     win->topic[0] = '\0';
     win->has_unread = false;
-    win->is_new = (type == WIN_PRIVATE); /* Mensajes privados son nuevos por defecto */
-    win->log_file = NULL;
+    win->is_new = false;
+    win->unread_count = 0;
+    win->highlight_count = 0;
+    win->activity = ACTIVITY_NONE;
+    win->activity_seq = 0;
+    win->activity_slot = -1;
+    win->log_id = -1;
     win->log_enabled = false;
-    win->last_log_day = 0;
     /* Inicializar campos de lista */
     win->channel_list = NULL;
     win->channel_count = 0;
+    win->channel_capacity = 0;
+    win->list_received = 0;
+    win->list_matched = 0;
     win->list_receiving = false;
-    win->list_ordered = false;
+    win->list_bytes = 0;
+    win->list_server_filtered = false;
+    win->list_server_total = 0;
+    win->list_cache = NULL;
+    win->list_cache_count = 0;
+    win->list_cache_capacity = 0;
+    win->list_cache_bytes = 0;
+    win->list_cache_time = 0;
+    win->list_cache_session = 0;
+    win->list_caching = false;
+    win->list_from_cache = false;
+    win->list_sort = LIST_SORT_NONE;
     win->list_filter[0] = '\0';
     win->list_limit = 0;
     win->list_min_users = 0;
     win->list_max_users = 0;
+    win->search.active = false;
+    win->search.pattern[0] = '\0';
+    win->search.use_regex = false;
+    win->search.line = -1;
+    win->redraw = 0;
 
     wm->windows[id] = win;
     wm->window_count++;
 
+    /* Las ventanas nuevas ocupan el primer panel vacío */
+    int pane = wm_find_pane(wm, -1);
+    if (pane >= 0) {
+        wm->panes[pane] = id;
+        win->redraw = REDRAW_WINDOW;
+    } else if (type == WIN_PRIVATE) {
+        /* Privado nuevo sin visitar */
+        win->is_new = true;
+        wm->new_privates++;
+        wm_raise_activity(wm, win, ACTIVITY_PRIVATE);
+    }
+
     return id;
 }
 
+/* Dar el foco al panel activo (o al primero con ventana si está vacío) */
+static void wm_fix_focus(WindowManager *wm) {
+    if (wm->active_pane >= wm->pane_count) {
+        wm->active_pane = wm->pane_count - 1;
+    }
+    if (wm->panes[wm->active_pane] < 0) {
+        for (int i = 0; i < wm->pane_count; i++) {
+            if (wm->panes[i] >= 0) {
+                wm->active_pane = i;
+                break;
+            }
+        }
+    }
+    if (wm->panes[wm->active_pane] < 0) {
+        wm->panes[wm->active_pane] = 0;
+        wm_clear_activity(wm, wm->windows[0]);
+    }
+    wm->active_window = wm->panes[wm->active_pane];
+}
+
+/* Quitar un panel (debe quedar al menos uno) */
+static void wm_remove_pane(WindowManager *wm, int pane) {
+    for (int i = pane; i < wm->pane_count - 1; i++) {
+        wm->panes[i] = wm->panes[i + 1];
+    }
+    wm->pane_count--;
+    wm->panes[wm->pane_count] = -1;
+
+    if (wm->active_pane > pane) {
+        wm->active_pane--;
+    }
+    if (wm->pane_count == 1) {
+        wm->split = SPLIT_NONE;
+    }
+    wm_fix_focus(wm);
+    wm->redraw |= REDRAW_ALL;
+}
+
 /* Cerrar una ventana */
 void wm_close_window(WindowManager *wm, int id) {
     if (!wm || id < 0 || id >= MAX_WINDOWS) return;
     if (!wm->windows[id]) return;
 
     Window *win = wm->windows[id];
+    wm_clear_activity(wm, win);
 
     /* Cerrar archivo de log si está abierto */
-    if (win->log_file) {
+    if (win->log_id >= 0) {
         window_close_log(win);
     }
 
     /* Destruir buffer y usuarios */
     buffer_destroy(win->buffer);
     window_clear_users(win);
+    window_clear_search(win);
 
     /* Limpiar lista de canales si existe */
     if (win->type == WIN_LIST) {
         window_clear_channel_list(win);
+        window_clear_list_cache(win);
     }
 
     free(win);
@@ -112,25 +303,42 @@ void wm_close_window(WindowManager *wm, int id) {
     wm->windows[id] = NULL;
     wm->window_count--;
 
-    /* Si cerramos la ventana activa, cambiar a la ventana de sistema */
-    if (wm->active_window == id) {
-        wm->active_window = 0;
+    /* Quitar su panel (o mostrar la ventana de sistema si era el único) */
+    int pane = wm_find_pane(wm, id);
+    if (pane >= 0) {
+        if (wm->pane_count > 1) {
+            wm_remove_pane(wm, pane);
+        } else {
+            wm->panes[0] = 0;
+            wm->active_window = 0;
+            wm_clear_activity(wm, wm->windows[0]);
+        }
+        wm->redraw |= REDRAW_ALL;
     }
 }
 
-/* Cambiar a una ventana */
+/* Cambiar a una ventana
+ * Si ya se ve en otro panel se le pasa el foco; si no, pasa a mostrarse en
+ * el panel activo y solo ese panel se repinta.
+ */
 void wm_switch_to(WindowManager *wm, int id) {
     if (!wm || id < 0 || id >= MAX_WINDOWS) return;
     if (!wm->windows[id]) return;
 
+    int pane = wm_find_pane(wm, id);
+    if (pane >= 0) {
+        wm_focus_pane(wm, pane);
+        return;
+    }
+
+    wm->panes[wm->active_pane] = id;
     wm->active_window = id;
+    wm->redraw |= REDRAW_PROMPT | REDRAW_STATUS;
 
-    /* Limpiar flags al cambiar a la ventana */
+    /* Limpiar la actividad al cambiar a la ventana */
     Window *win = wm->windows[id];
-    if (win) {
-        win->has_unread = false;
-        win->is_new = false;
-    }
+    win->redraw |= REDRAW_WINDOW;
+    wm_clear_activity(wm, win);
 }
 
 /* Obtener una ventana por ID */
@@ -151,38 +359,40 @@ void wm_add_message_with_timestamp(WindowManager *wm, int window_id, const char
 
     Window *win = wm->windows[window_id];
     if (win && win->buffer) {
-        /* Convertir códigos mIRC a ANSI */
-        char converted_msg[MAX_MSG_LEN * 2];
-        convert_mirc_to_ansi(converted_msg, msg, sizeof(converted_msg));
-
-        /* Añadir timestamp si está habilitado y la ventana es de canal o privado */
-        char final_msg[MAX_MSG_LEN * 2];
+        /* Timestamp si está habilitado y la ventana es de canal o privado */
+        char prefix[CLOCK_STRING_LEN + 16] = "";
         if (add_timestamp && (win->type == WIN_CHANNEL || win->type == WIN_PRIVATE)) {
-            time_t now = time(NULL);
-            struct tm *tm_info = localtime(&now);
-
-            char timestamp[16];
-            if (format && strcmp(format, "HH:MM") == 0) {
-                snprintf(timestamp, sizeof(timestamp), "%02d:%02d",
-                         tm_info->tm_hour, tm_info->tm_min);
-            } else {
-                /* Por defecto HH:MM:SS */
-                snprintf(timestamp, sizeof(timestamp), "%02d:%02d:%02d",
-                         tm_info->tm_hour, tm_info->tm_min, tm_info->tm_sec);
+            /* Hora ya formateada para este segundo (por defecto HH:MM:SS) */
+            const char *timestamp = clock_format(format ? format : "%H:%M:%S");
+            snprintf(prefix, sizeof(prefix), ANSI_GRAY "%s>" ANSI_RESET " ", timestamp);
+        }
+        size_t prefix_len = strlen(prefix);
+
+        /* Convertir códigos mIRC a ANSI justo detrás del timestamp; si el
+         * mensaje no cabe (muchos códigos), convertirlo en memoria dinámica */
+        char line_buf[MAX_MSG_LEN * 2];
+        char *final_msg = line_buf;
+        memcpy(final_msg, prefix, prefix_len);
+        size_t needed = convert_mirc_to_ansi(final_msg + prefix_len, msg, sizeof(line_buf) - prefix_len);
+        if (prefix_len + needed >= sizeof(line_buf)) {
+            char *big = malloc(prefix_len + needed + 1);
+            if (big) {
+                memcpy(big, prefix, prefix_len);
+                convert_mirc_to_ansi(big + prefix_len, msg, needed + 1);
+                final_msg = big;
             }
-
-            snprintf(final_msg, sizeof(final_msg), ANSI_GRAY "%s>" ANSI_RESET " %s",
-                     timestamp, converted_msg);
-        } else {
-            strncpy(final_msg, converted_msg, sizeof(final_msg) - 1);
-            final_msg[sizeof(final_msg) - 1] = '\0';
         }
 
         buffer_add_message(win->buffer, final_msg);
+        win->redraw |= REDRAW_MESSAGES;
 
         /* Escribir al log si está habilitado (siempre sin el timestamp de visualización) */
-        if (win->log_enabled && win->log_file) {
-            window_write_log(win, converted_msg);
+        if (win->log_enabled && win->log_id >= 0) {
+            window_write_log(win, final_msg + prefix_len);
+        }
+
+        if (final_msg != line_buf) {
+            free(final_msg);
         }
     }
 }
@@ -318,6 +528,7 @@ void window_add_user_with_mode(Window *win, const char *nick, char mode) {
     node->next = insert_curr;
 
     win->user_count++;
+    win->redraw |= REDRAW_USERS | REDRAW_TITLE;
 }
 
 /* Eliminar usuario de un canal */
@@ -336,6 +547,7 @@ void window_remove_user(Window *win, const char *nick) {
             }
             free(current);
             win->user_count--;
+            win->redraw |= REDRAW_USERS | REDRAW_TITLE;
             return;
         }
         prev = current;
@@ -357,6 +569,7 @@ void window_clear_users(Window *win) {
     win->users = NULL;
     win->user_count = 0;
     win->user_scroll_offset = 0;
+    win->redraw |= REDRAW_USERS | REDRAW_TITLE;
 }
 
 /* Scroll hacia arriba en la lista de usuarios */
@@ -366,6 +579,7 @@ void window_scroll_users_up(Window *win) {
     /* Incrementar offset (mostrar usuarios más arriba en la lista) */
     if (win->user_scroll_offset < win->user_count - 1) {
         win->user_scroll_offset++;
+        win->redraw |= REDRAW_USERS;
     }
 }
 
@@ -376,94 +590,282 @@ void window_scroll_users_down(Window *win) {
     /* Decrementar offset (volver hacia el final de la lista) */
     if (win->user_scroll_offset > 0) {
         win->user_scroll_offset--;
+        win->redraw |= REDRAW_USERS;
     }
 }
 
-/* Marcar ventana con actividad si no está activa */
-void wm_mark_window_activity(WindowManager *wm, int window_id) {
+/* Contar un mensaje nuevo en una ventana que no se ve
+ * highlight indica una mención del nick. Las ventanas visibles en algún
+ * panel no acumulan actividad.
+ */
+void wm_mark_window_activity(WindowManager *wm, int window_id, bool highlight) {
     if (!wm || window_id < 0 || window_id >= MAX_WINDOWS) return;
 
     Window *win = wm->windows[window_id];
     if (!win) return;
+    if (wm_find_pane(wm, window_id) >= 0) return;
+
+    if (!win->has_unread && !win->is_new) {
+        wm->unread_windows++;
+    }
+    win->has_unread = true;
+    win->unread_count++;
+    if (highlight) {
+        win->highlight_count++;
+    }
 
-    /* Solo marcar si no es la ventana activa */
-    if (window_id != wm->active_window) {
-        win->has_unread = true;
+    ActivityLevel level = ACTIVITY_MESSAGE;
+    if (highlight) {
+        level = ACTIVITY_HIGHLIGHT;
+    } else if (win->type == WIN_PRIVATE) {
+        level = ACTIVITY_PRIVATE;
     }
+    wm_raise_activity(wm, win, level);
+
+    /* Los contadores se muestran en la barra de estado */
+    wm->redraw |= REDRAW_STATUS;
 }
 
-/* Verificar si hay ventanas privadas nuevas */
-bool wm_has_new_privates(WindowManager *wm) {
-    if (!wm) return false;
+/* Borrar la actividad de todas las ventanas (/ok) */
+void wm_clear_all_activity(WindowManager *wm) {
+    if (!wm) return;
 
-    for (int i = 0; i < MAX_WINDOWS; i++) {
-        Window *win = wm->windows[i];
-        if (win && win->type == WIN_PRIVATE && win->is_new) {
-            return true;
+    /* Vaciando desde el final el montículo no se reordena */
+    while (wm->activity_count > 0) {
+        wm_clear_activity(wm, wm->windows[wm->activity_heap[wm->activity_count - 1]]);
+    }
+}
+
+/* Ventana con la actividad más importante (-1 si no hay ninguna) */
+int wm_next_activity(WindowManager *wm) {
+    if (!wm || wm->activity_count == 0) return -1;
+    return wm->activity_heap[0];
+}
+
+/* Ventanas con actividad ordenadas por número; devuelve cuántas hay */
+int wm_activity_windows(WindowManager *wm, int ids[MAX_WINDOWS]) {
+    if (!wm) return 0;
+
+    int count = wm->activity_count;
+    for (int i = 0; i < count; i++) {
+        int id = wm->activity_heap[i];
+        int j = i;
+        while (j > 0 && ids[j - 1] > id) {
+            ids[j] = ids[j - 1];
+            j--;
         }
+        ids[j] = id;
     }
-    return false;
+    return count;
+}
+
+/* Verificar si hay ventanas privadas nuevas */
+bool wm_has_new_privates(WindowManager *wm) {
+    return wm && wm->new_privates > 0;
 }
 
 /* Verificar si hay ventanas con mensajes sin leer */
 bool wm_has_unread_messages(WindowManager *wm) {
-    if (!wm) return false;
+    return wm && wm->unread_windows > 0;
+}
+
+/* Recoger las regiones a redibujar desde el último frame
+ * Lo que cambió en cada ventana visible se añade a pane_regions[] en su
+ * panel; los cambios en ventanas de fondo no se ven (su actividad ya marcó
+ * REDRAW_STATUS). Devuelve las regiones globales.
+ */
+unsigned wm_take_redraw(WindowManager *wm, unsigned pane_regions[MAX_PANES]) {
+    if (!wm) return 0;
+
+    unsigned regions = wm->redraw;
+    wm->redraw = 0;
 
     for (int i = 0; i < MAX_WINDOWS; i++) {
         Window *win = wm->windows[i];
-        if (win && win->has_unread && !win->is_new) {
-            return true;
+        if (!win) continue;
+        int pane = wm_find_pane(wm, i);
+        if (pane >= 0 && pane_regions) {
+            pane_regions[pane] |= win->redraw;
         }
+        win->redraw = 0;
     }
-    return false;
+    return regions;
 }
 
-/* Función auxiliar para remover códigos ANSI de una cadena */
-static void strip_ansi_codes(char *dest, const char *src, size_t dest_size) {
-    size_t j = 0;
-    for (size_t i = 0; src[i] && j < dest_size - 1; i++) {
-        if (src[i] == '\033' && src[i+1] == '[') {
-            /* Saltar secuencia ANSI */
-            i += 2;
-            while (src[i] && !isalpha((unsigned char)src[i])) {
-                i++;
+/* Panel que muestra una ventana (-1 si no se ve; con -1 busca un panel vacío) */
+int wm_find_pane(WindowManager *wm, int window_id) {
+    if (!wm) return -1;
+
+    for (int i = 0; i < wm->pane_count; i++) {
+        if (wm->panes[i] == window_id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Añadir un panel al final mostrando window_id
+ * Con window_id < 0 se muestra la primera ventana que no esté a la vista,
+ * o ninguna (la ocupará la próxima ventana que se cree). El foco no cambia.
+ */
+bool wm_split(WindowManager *wm, SplitMode mode, int window_id) {
+    if (!wm || mode == SPLIT_NONE || wm->pane_count >= MAX_PANES) return false;
+
+    if (window_id >= 0) {
+        if (window_id >= MAX_WINDOWS || !wm->windows[window_id]) return false;
+        if (wm_find_pane(wm, window_id) >= 0) return false;
+    } else {
+        for (int i = 0; i < MAX_WINDOWS; i++) {
+            if (wm->windows[i] && wm_find_pane(wm, i) < 0) {
+                window_id = i;
+                break;
             }
-        } else {
-            dest[j++] = src[i];
         }
     }
-    dest[j] = '\0';
+
+    wm->split = mode;
+    wm->panes[wm->pane_count++] = window_id;
+    wm->redraw |= REDRAW_ALL;
+
+    if (window_id >= 0) {
+        wm_clear_activity(wm, wm->windows[window_id]);
+    }
+    return true;
 }
 
-/* Abrir archivo de log para una ventana */
-void window_open_log(Window *win) {
-    if (!win || win->log_file) return;
+/* Cerrar el panel activo (la ventana sigue abierta) */
+void wm_close_pane(WindowManager *wm) {
+    if (!wm || wm->pane_count <= 1) return;
+    wm_remove_pane(wm, wm->active_pane);
+}
 
-    /* Obtener HOME */
-    const char *home = getenv("HOME");
-    if (!home) return;
+/* Volver a un solo panel con la ventana activa */
+void wm_unsplit(WindowManager *wm) {
+    if (!wm || wm->pane_count <= 1) return;
 
-    /* Crear directorio ~/.irclogs/ si no existe */
-    char logdir[512];
-    snprintf(logdir, sizeof(logdir), "%s/.irclogs", home);
-    mkdir(logdir, 0755);
+    for (int i = 1; i < MAX_PANES; i++) {
+        wm->panes[i] = -1;
+    }
+    wm->panes[0] = wm->active_window;
+    wm->pane_count = 1;
+    wm->active_pane = 0;
+    wm->split = SPLIT_NONE;
+    wm->redraw |= REDRAW_ALL;
+}
+
+/* Pasar el foco a un panel (los vacíos no lo reciben) */
+void wm_focus_pane(WindowManager *wm, int pane) {
+    if (!wm || pane < 0 || pane >= wm->pane_count) return;
+    if (wm->panes[pane] < 0 || pane == wm->active_pane) return;
+
+    /* El título marca el panel activo: repintarlo en los dos */
+    Window *old = wm->windows[wm->active_window];
+    if (old) old->redraw |= REDRAW_TITLE;
+
+    wm->active_pane = pane;
+    wm->active_window = wm->panes[pane];
+    wm->redraw |= REDRAW_PROMPT | REDRAW_STATUS;
+
+    Window *win = wm->windows[wm->active_window];
+    win->redraw |= REDRAW_TITLE;
+    wm_clear_activity(wm, win);
+}
+
+/* Pasar el foco al siguiente panel con ventana (cíclico) */
+void wm_focus_next_pane(WindowManager *wm) {
+    if (!wm) return;
+
+    for (int i = 1; i < wm->pane_count; i++) {
+        int pane = (wm->active_pane + i) % wm->pane_count;
+        if (wm->panes[pane] >= 0) {
+            wm_focus_pane(wm, pane);
+            return;
+        }
+    }
+}
+
+/* Comprimir bloques fríos pendientes de los buffers (hasta max_blocks en total) */
+void wm_compact_buffers(WindowManager *wm, int max_blocks) {
+    if (!wm) return;
+
+    for (int i = 0; i < MAX_WINDOWS && max_blocks > 0; i++) {
+        Window *win = wm->windows[i];
+        if (win && win->buffer) {
+            max_blocks -= buffer_compact(win->buffer, max_blocks);
+        }
+    }
+}
+
+/* Iniciar una búsqueda en la ventana (compila la regex si hace falta) */
+bool window_set_search(Window *win, const char *pattern, bool use_regex) {
+    if (!win || !pattern) return false;
+
+    window_clear_search(win);
+
+    if (use_regex && regcomp(&win->search.regex, pattern, REG_EXTENDED | REG_ICASE) != 0) {
+        return false;
+    }
+
+    strncpy(win->search.pattern, pattern, sizeof(win->search.pattern) - 1);
+    win->search.pattern[sizeof(win->search.pattern) - 1] = '\0';
+    win->search.use_regex = use_regex;
+    win->search.active = true;
+    win->search.line = -1;
+    win->redraw |= REDRAW_MESSAGES;
+    return true;
+}
+
+/* Terminar la búsqueda de la ventana */
+void window_clear_search(Window *win) {
+    if (!win) return;
+
+    if (win->search.active && win->search.use_regex) {
+        regfree(&win->search.regex);
+    }
+    win->search.active = false;
+    win->search.use_regex = false;
+    win->search.line = -1;
+    win->redraw |= REDRAW_MESSAGES;
+}
+
+/* Buscar la coincidencia anterior a from y llevar la vista hasta ella */
+bool window_search_next(Window *win, int from) {
+    if (!win || !win->search.active) return false;
+
+    int line = buffer_search(win->buffer, win->search.pattern,
+                             win->search.use_regex ? &win->search.regex : NULL, from);
+    if (line < 0) return false;
+
+    /* La coincidencia queda en la última fila visible */
+    win->search.line = line;
+    win->buffer->view_offset = win->buffer->count - 1 - line;
+    win->redraw |= REDRAW_MESSAGES;
+    return true;
+}
 
-    /* Obtener fecha y hora actual */
-    time_t now = time(NULL);
-    struct tm *tm_info = localtime(&now);
+/* Copiar en dest la línea con la coincidencia en vídeo inverso
+ * Devuelve false si la línea no coincide o no cabe en dest.
+ */
+bool window_highlight_search(Window *win, const char *line, char *dest, size_t size) {
+    if (!win || !win->search.active || !line || !dest) return false;
+
+    int start, end;
+    if (!buffer_match_span(line, win->search.pattern,
+                           win->search.use_regex ? &win->search.regex : NULL, &start, &end)) {
+        return false;
+    }
 
-    /* Formatear nombre de archivo basado en tipo de ventana */
-    char logpath[1024];
-    char safe_title[MAX_CHANNEL_LEN];
-    
-    /* Limpiar el título para usarlo como nombre de archivo */
-    strncpy(safe_title, win->title, MAX_CHANNEL_LEN - 1);
-    safe_title[MAX_CHANNEL_LEN - 1] = '\0';
-    
-    /* Reemplazar # por nada si es canal */
-    char *title_ptr = safe_title;
-    if (safe_title[0] == '#') {
-        title_ptr = safe_title + 1;
+    int len = snprintf(dest, size, "%.*s" ANSI_REVERSE "%.*s" ANSI_NO_REVERSE "%s",
+                       start, line, end - start, line + start, line + end);
+    return len >= 0 && (size_t)len < size;
+}
+
+/* Prefijo del nombre de los logs de una ventana: tipo_nombre */
+static void log_file_prefix(const Window *win, char *prefix, size_t size) {
+    /* Quitar # si es canal */
+    const char *title_ptr = win->title;
+    if (title_ptr[0] == '#') {
+        title_ptr++;
     }
 
     /* Determinar prefijo según tipo */
@@ -476,170 +878,633 @@ void window_open_log(Window *win) {
         type_prefix = "sistema_";
     }
 
-    /* Crear nombre de archivo: tipo_nombre_DD-MM-YY_HH:MM.txt */
-    snprintf(logpath, sizeof(logpath), "%s/%s%s_%02d-%02d-%02d_%02d:%02d.txt",
-             logdir, type_prefix, title_ptr,
-             tm_info->tm_mday, tm_info->tm_mon + 1, tm_info->tm_year % 100,
-             tm_info->tm_hour, tm_info->tm_min);
+    snprintf(prefix, size, "%s%s", type_prefix, title_ptr);
+}
+
+/* Archivo de log candidato para la precarga */
+typedef struct {
+    char name[256];
+    long key;                   /* AAAAMMDDHHMM para ordenar por fecha */
+    struct tm date;
+    bool json;                  /* Formato JSON lines */
+} LogFileEntry;
+
+/* Ordenar logs del más reciente al más antiguo */
+static int compare_log_files(const void *a, const void *b) {
+    long ka = ((const LogFileEntry *)a)->key;
+    long kb = ((const LogFileEntry *)b)->key;
+    return (ka < kb) - (ka > kb);
+}
+
+/* Leer como mucho las últimas max_lines líneas de un archivo
+ * Se lee hacia atrás desde el final con pread, en bloques, hasta encontrar
+ * suficientes saltos de línea; nunca se recorre el archivo entero.
+ * Devuelve el texto (malloc) o NULL.
+ */
+static char* read_log_tail(const char *path, int max_lines) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    /* No contar el salto de línea final */
+    off_t end = st.st_size;
+    off_t pos = end;
+    char last;
+    if (pread(fd, &last, 1, end - 1) == 1 && last == '\n') {
+        pos--;
+    }
+
+    char chunk[8192];
+    off_t start = 0;
+    int newlines = 0;
+    bool found = false;
+
+    while (pos > 0 && !found) {
+        size_t n = (pos > (off_t)sizeof(chunk)) ? sizeof(chunk) : (size_t)pos;
+        pos -= n;
+        if (pread(fd, chunk, n, pos) != (ssize_t)n) break;
+
+        for (int i = (int)n - 1; i >= 0; i--) {
+            if (chunk[i] == '\n' && ++newlines == max_lines) {
+                start = pos + i + 1;
+                found = true;
+                break;
+            }
+        }
+    }
+
+    size_t size = end - start;
+    char *text = malloc(size + 1);
+    if (text && pread(fd, text, size, start) != (ssize_t)size) {
+        free(text);
+        text = NULL;
+    }
+    if (text) {
+        text[size] = '\0';
+    }
+
+    close(fd);
+    return text;
+}
+
+/* Contar las líneas no vacías de un texto */
+static int count_log_lines(const char *text) {
+    int lines = 0;
+    bool empty = true;
+    for (const char *p = text; *p; p++) {
+        if (*p == '\n') {
+            if (!empty) lines++;
+            empty = true;
+        } else {
+            empty = false;
+        }
+    }
+    return empty ? lines : lines + 1;
+}
+
+/* Añadir al buffer las líneas de un log, reconstruyendo su hora de recepción */
+static void preload_log_text(Window *win, char *text, struct tm date, bool json) {
+    char *saveptr = NULL;
+    time_t when = mktime(&date);
+
+    for (char *line = strtok_r(text, "\n", &saveptr); line; line = strtok_r(NULL, "\n", &saveptr)) {
+        int day, month, year, hour, minute, second;
+        char msg[MAX_MSG_LEN];
+
+        /* JSON lines: cada línea trae su hora; se muestra como en texto */
+        if (json) {
+            LogEntry entry;
+            if (!logfile_parse_json(line, &entry)) continue;
+            size_t len = strlen(ANSI_GRAY);
+            memcpy(msg, ANSI_GRAY, len);
+            logfile_format_entry(&entry, msg + len, sizeof(msg) - len - strlen(ANSI_RESET));
+            strcat(msg, ANSI_RESET);
+            buffer_add_message_at(win->buffer, msg, entry.when);
+            continue;
+        }
+
+        if (sscanf(line, "=== Cambio de día: %d/%d/%d", &day, &month, &year) == 3 ||
+            sscanf(line, "=== Sesión iniciada: %d/%d/%d", &day, &month, &year) == 3) {
+            date.tm_mday = day;
+            date.tm_mon = month - 1;
+            date.tm_year = year - 1900;
+        } else if (sscanf(line, "[%d:%d:%d]", &hour, &minute, &second) == 3) {
+            struct tm stamp = date;
+            stamp.tm_hour = hour;
+            stamp.tm_min = minute;
+            stamp.tm_sec = second;
+            stamp.tm_isdst = -1;
+            when = mktime(&stamp);
+        }
 
-    /* Abrir archivo en modo append */
-    win->log_file = fopen(logpath, "a");
-    if (win->log_file) {
-        win->log_enabled = true;
-        win->last_log_day = tm_info->tm_mday;
-        /* Escribir marca de inicio */
-        fprintf(win->log_file, "=== Sesión iniciada: %02d/%02d/%04d %02d:%02d:%02d ===\n",
-                tm_info->tm_mday, tm_info->tm_mon + 1, tm_info->tm_year + 1900,
-                tm_info->tm_hour, tm_info->tm_min, tm_info->tm_sec);
-        fflush(win->log_file);
+        snprintf(msg, sizeof(msg), ANSI_GRAY "%s" ANSI_RESET, line);
+        buffer_add_message_at(win->buffer, msg, when);
     }
 }
 
+/* Precargar en la ventana las últimas max_lines líneas de sus logs
+ * Se usan los archivos de ~/.irclogs de la ventana, empezando por el más
+ * reciente y pasando al anterior si no tiene suficientes líneas. Los días
+ * ya comprimidos (.txt.gz) no se leen.
+ * Debe llamarse antes de window_open_log(), que añade la marca de sesión.
+ * Devuelve el número de líneas cargadas.
+ */
+int window_preload_log(Window *win, int max_lines) {
+    if (!win || !win->buffer || !win->buffer->enabled || max_lines <= 0) return 0;
+
+    char logdir[512];
+    if (!logger_dir(logdir, sizeof(logdir))) return 0;
+
+    char prefix[MAX_CHANNEL_LEN + 16];
+    log_file_prefix(win, prefix, sizeof(prefix));
+    size_t prefix_len = strlen(prefix);
+
+    /* Buscar los logs de la ventana: prefijo_AAAA-MM-DD.txt o .jsonl (uno
+     * por día) y los de versiones anteriores, prefijo_DD-MM-YY_HH:MM.txt
+     * (uno por sesión) */
+    DIR *dir = opendir(logdir);
+    if (!dir) return 0;
+
+    LogFileEntry *files = NULL;
+    int file_count = 0;
+    int file_capacity = 0;
+    struct dirent *entry;
+
+    while ((entry = readdir(dir)) != NULL) {
+        const char *name = entry->d_name;
+        if (strncmp(name, prefix, prefix_len) != 0 || name[prefix_len] != '_') continue;
+
+        const char *date_part = name + prefix_len + 1;
+        LogFileName info;
+        int day, month, year, hour = 0, minute = 0;
+        bool json = false;
+        if (logfile_parse_name(name, &info) && info.prefix_len == prefix_len && !info.compressed) {
+            year = info.date / 10000;
+            month = info.date / 100 % 100;
+            day = info.date % 100;
+            json = info.format == LOG_FORMAT_JSONL;
+        } else if (strlen(date_part) == 18 && strcmp(date_part + 14, ".txt") == 0 &&
+                   sscanf(date_part, "%2d-%2d-%2d_%2d:%2d", &day, &month, &year, &hour, &minute) == 5) {
+            year += 2000;
+        } else {
+            continue;
+        }
+
+        if (file_count == file_capacity) {
+            int new_capacity = file_capacity ? file_capacity * 2 : 16;
+            LogFileEntry *new_files = realloc(files, sizeof(LogFileEntry) * new_capacity);
+            if (!new_files) break;
+            files = new_files;
+            file_capacity = new_capacity;
+        }
+
+        LogFileEntry *file = &files[file_count++];
+        snprintf(file->name, sizeof(file->name), "%s", name);
+        file->key = ((((long)year * 100 + month) * 100 + day) * 100 + hour) * 100 + minute;
+        memset(&file->date, 0, sizeof(file->date));
+        file->date.tm_mday = day;
+        file->date.tm_mon = month - 1;
+        file->date.tm_year = year - 1900;
+        file->date.tm_hour = hour;
+        file->date.tm_min = minute;
+        file->date.tm_isdst = -1;
+        file->json = json;
+    }
+    closedir(dir);
+
+    if (file_count == 0) {
+        free(files);
+        return 0;
+    }
+
+    qsort(files, file_count, sizeof(LogFileEntry), compare_log_files);
+
+    /* Leer colas de archivo, del más reciente hacia atrás */
+    char **texts = calloc(file_count, sizeof(char *));
+    int remaining = max_lines;
+    int used = 0;
+
+    while (texts && used < file_count && remaining > 0) {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", logdir, files[used].name);
+        texts[used] = read_log_tail(path, remaining);
+        if (texts[used]) {
+            remaining -= count_log_lines(texts[used]);
+        }
+        used++;
+    }
+
+    /* Añadir en orden cronológico */
+    for (int i = used - 1; i >= 0; i--) {
+        if (texts[i]) {
+            preload_log_text(win, texts[i], files[i].date, files[i].json);
+            free(texts[i]);
+        }
+    }
+
+    free(texts);
+    free(files);
+
+    int loaded = max_lines - (remaining > 0 ? remaining : 0);
+    if (loaded > 0) {
+        buffer_add_message(win->buffer, ANSI_GRAY "--- Fin del historial cargado de ~/.irclogs ---" ANSI_RESET);
+    }
+    return loaded;
+}
+
+/* Abrir archivo de log para una ventana
+ * El archivo lo abre y lo escribe el hilo del logger; aquí solo se elige
+ * la ruta base (el logger añade _AAAA-MM-DD.txt y cambia de archivo cada
+ * día) y se reserva su identificador.
+ */
+void window_open_log(Window *win) {
+    if (!win || win->log_id >= 0) return;
+
+    /* Los resultados de /grep y /list no son conversación: el log de
+     * /grep, además, haría que cada búsqueda encontrase las anteriores */
+    if (win->type == WIN_GREP || win->type == WIN_LIST) return;
+
+    /* Crear directorio ~/.irclogs/ si no existe */
+    char logdir[512];
+    if (!logger_dir(logdir, sizeof(logdir))) return;
+    mkdir(logdir, 0755);
+
+    /* Ruta base según el tipo de ventana: ~/.irclogs/tipo_nombre */
+    char base[LOG_PATH_MAX];
+    char prefix[MAX_CHANNEL_LEN + 16];
+    log_file_prefix(win, prefix, sizeof(prefix));
+    snprintf(base, sizeof(base), "%s/%s", logdir, prefix);
+
+    /* El logger escribe la marca de inicio */
+    win->log_id = logger_open(base, win->title, clock_now());
+    win->log_enabled = win->log_id >= 0;
+}
+
 /* Cerrar archivo de log para una ventana */
 void window_close_log(Window *win) {
-    if (!win || !win->log_file) return;
+    if (!win || win->log_id < 0) return;
 
-    /* Escribir marca de cierre */
-    time_t now = time(NULL);
-    struct tm *tm_info = localtime(&now);
-    fprintf(win->log_file, "=== Sesión cerrada: %02d/%02d/%04d %02d:%02d:%02d ===\n\n",
-            tm_info->tm_mday, tm_info->tm_mon + 1, tm_info->tm_year + 1900,
-            tm_info->tm_hour, tm_info->tm_min, tm_info->tm_sec);
-
-    fclose(win->log_file);
-    win->log_file = NULL;
+    /* El logger escribe la marca de cierre */
+    logger_close(win->log_id, clock_now());
+    win->log_id = -1;
     win->log_enabled = false;
 }
 
-/* Escribir mensaje al log de una ventana */
+/* Escribir mensaje al log de una ventana
+ * Solo se encola: la hora, el cambio de archivo a medianoche y la limpieza
+ * de códigos ANSI los hace el hilo del logger.
+ */
 void window_write_log(Window *win, const char *msg) {
-    if (!win || !win->log_file || !win->log_enabled || !msg) return;
-
-    /* Obtener timestamp */
-    time_t now = time(NULL);
-    struct tm *tm_info = localtime(&now);
-
-    /* Detectar cambio de día */
-    if (win->last_log_day != 0 && tm_info->tm_mday != win->last_log_day) {
-        fprintf(win->log_file, "\n=== Cambio de día: %02d/%02d/%04d ===\n\n",
-                tm_info->tm_mday, tm_info->tm_mon + 1, tm_info->tm_year + 1900);
-        win->last_log_day = tm_info->tm_mday;
-    }
-
-    /* Remover códigos ANSI del mensaje */
-    char clean_msg[MAX_MSG_LEN];
-    strip_ansi_codes(clean_msg, msg, sizeof(clean_msg));
-
-    /* Escribir al log con timestamp (siempre en formato HH:MM:SS) */
-    fprintf(win->log_file, "[%02d:%02d:%02d] %s\n",
-            tm_info->tm_hour, tm_info->tm_min, tm_info->tm_sec, clean_msg);
-    fflush(win->log_file);
-}
-
-/* Mapeo de colores mIRC a ANSI */
-static const char* mirc_color_to_ansi(int color) {
-    switch (color) {
-        case 0: return "\033[37m";      /* White */
-        case 1: return "\033[30m";      /* Black */
-        case 2: return "\033[34m";      /* Blue */
-        case 3: return "\033[32m";      /* Green */
-        case 4: return "\033[31m";      /* Red */
-        case 5: return "\033[31m";      /* Brown/Maroon (Red oscuro) */
-        case 6: return "\033[35m";      /* Purple/Magenta */
-        case 7: return "\033[33m";      /* Orange (Yellow) */
-        case 8: return "\033[93m";      /* Yellow (bright) */
-        case 9: return "\033[92m";      /* Light Green */
-        case 10: return "\033[36m";     /* Cyan */
-        case 11: return "\033[96m";     /* Light Cyan */
-        case 12: return "\033[94m";     /* Light Blue */
-        case 13: return "\033[95m";     /* Pink/Magenta (bright) */
-        case 14: return "\033[90m";     /* Grey */
-        case 15: return "\033[37m";     /* Light Grey (White) */
-        default: return "\033[0m";      /* Reset */
-    }
-}
-
-/* Convertir códigos mIRC a ANSI 
+    if (!win || win->log_id < 0 || !win->log_enabled || !msg) return;
+
+    logger_write(win->log_id, msg, clock_now());
+}
+
+/* Acciones de los códigos de formato mIRC (indexadas por byte) */
+enum {
+    MIRC_TEXT = 0,
+    MIRC_BOLD,
+    MIRC_ITALIC,
+    MIRC_UNDERLINE,
+    MIRC_STRIKE,
+    MIRC_REVERSE,
+    MIRC_MONOSPACE,
+    MIRC_COLOR,
+    MIRC_HEX_COLOR,
+    MIRC_RESET,
+    MIRC_ESCAPE,
+    MIRC_END
+};
+
+static const uint8_t mirc_codes[256] = {
+    [0x00] = MIRC_END,
+    [0x02] = MIRC_BOLD,
+    [0x03] = MIRC_COLOR,
+    [0x04] = MIRC_HEX_COLOR,
+    [0x0F] = MIRC_RESET,
+    [0x11] = MIRC_MONOSPACE,
+    [0x16] = MIRC_REVERSE,
+    [0x1B] = MIRC_ESCAPE,
+    [0x1D] = MIRC_ITALIC,
+    [0x1E] = MIRC_STRIKE,
+    [0x1F] = MIRC_UNDERLINE
+};
+
+/* Atributos que alternan los códigos de formato, con sus parámetros SGR de
+ * activar y desactivar (de ancho fijo: se copian siempre 4 bytes) */
+static const struct {
+    uint8_t attr;
+    char on[4];
+    char off[4];
+} mirc_attrs[] = {
+    [MIRC_BOLD]      = { CELL_BOLD,      ";1", ";22" },
+    [MIRC_ITALIC]    = { CELL_ITALIC,    ";3", ";23" },
+    [MIRC_UNDERLINE] = { CELL_UNDERLINE, ";4", ";24" },
+    [MIRC_STRIKE]    = { CELL_STRIKE,    ";9", ";29" },
+    [MIRC_REVERSE]   = { CELL_REVERSE,   ";7", ";27" }
+};
+
+/* Colores mIRC 0-98 en la paleta de 256 (99 = color por defecto)
+ * 0-15 usan los 16 colores básicos; 16-98 siguen la tabla extendida de mIRC.
+ */
+static const uint8_t mirc_palette[99] = {
+     15,   0,   4,   2,   9,   1,   5,   3,  11,  10,   6,  14,  12,  13,   8,   7,
+     52,  94, 100,  58,  22,  29,  23,  24,  17,  54,  53,  89,
+     88, 130, 142,  64,  28,  35,  30,  25,  18,  91,  90, 125,
+    124, 166, 184, 106,  34,  49,  37,  33,  19, 129, 127, 161,
+    196, 208, 226, 154,  46,  86,  51,  75,  21, 171, 201, 198,
+    203, 215, 227, 191,  83, 122,  87, 111,  63, 177, 207, 205,
+    217, 223, 229, 193, 157, 158, 159, 153, 147, 183, 219, 212,
+     16, 233, 235, 237, 239, 241, 244, 247, 250, 254, 231
+};
+
+/* Color desconocido: lo fijó una secuencia ANSI del propio mensaje */
+#define MIRC_COLOR_UNKNOWN 0xFFFFFFFFu
+
+/* Estado de formato (colores codificados como en screen.h) */
+typedef struct {
+    uint8_t attrs;
+    uint32_t fg;
+    uint32_t bg;
+} MircStyle;
+
+/* Añadir a seq el parámetro SGR ";n" (n < 1000) */
+static int mirc_sgr_param(char *seq, unsigned n) {
+    int len = 0;
+    seq[len++] = ';';
+    if (n >= 100) seq[len++] = (char)('0' + n / 100);
+    if (n >= 10) seq[len++] = (char)('0' + n / 10 % 10);
+    seq[len++] = (char)('0' + n % 10);
+    return len;
+}
+
+/* Añadir a seq los parámetros SGR de un color */
+static int mirc_sgr_color(char *seq, uint32_t color, bool background) {
+    if (color == COLOR_DEFAULT) {
+        return mirc_sgr_param(seq, background ? 49 : 39);
+    }
+
+    int len = 0;
+    if (color & COLOR_RGB) {
+        len += mirc_sgr_param(seq + len, background ? 48 : 38);
+        len += mirc_sgr_param(seq + len, 2);
+        len += mirc_sgr_param(seq + len, (color >> 16) & 0xFF);
+        len += mirc_sgr_param(seq + len, (color >> 8) & 0xFF);
+        len += mirc_sgr_param(seq + len, color & 0xFF);
+        return len;
+    }
+
+    unsigned n = color - 1;
+    if (n < 8) return mirc_sgr_param(seq, (background ? 40 : 30) + n);
+    if (n < 16) return mirc_sgr_param(seq, (background ? 100 : 90) + n - 8);
+    len += mirc_sgr_param(seq + len, background ? 48 : 38);
+    len += mirc_sgr_param(seq + len, 5);
+    len += mirc_sgr_param(seq + len, n);
+    return len;
+}
+
+/* Parámetros SGR del color por defecto y de los 16 básicos (indexados por
+ * el color de screen.h), de ancho fijo para copiarlos con un solo
+ * movimiento de 4 bytes */
+static const char mirc_basic_params[2][17][4] = {
+    { ";39", ";30", ";31", ";32", ";33", ";34", ";35", ";36", ";37",
+      ";90", ";91", ";92", ";93", ";94", ";95", ";96", ";97" },
+    { ";49", ";40", ";41", ";42", ";43", ";44", ";45", ";46", ";47",
+      ";100", ";101", ";102", ";103", ";104", ";105", ";106", ";107" }
+};
+
+/* Añadir a seq los parámetros SGR de un color (los básicos, de la tabla) */
+static int mirc_color_params(char *seq, uint32_t color, bool background) {
+    if (color <= 16) {
+        memcpy(seq, mirc_basic_params[background][color], 4);
+        return (background && color > 8) ? 4 : 3;
+    }
+    return mirc_sgr_color(seq, color, background);
+}
+
+/* Sitio que se deja para los parámetros de un código (dos colores RGB) */
+#define MIRC_SGR_MAX 64
+
+/* Leer hasta max_digits dígitos decimales (-1 si no hay ninguno) */
+static int mirc_read_number(const char **p, int max_digits) {
+    int value = -1;
+    for (int i = 0; i < max_digits && (unsigned)(**p - '0') < 10; i++) {
+        value = (value < 0 ? 0 : value * 10) + (**p - '0');
+        (*p)++;
+    }
+    return value;
+}
+
+/* Leer un color hexadecimal RRGGBB (false si no hay seis dígitos) */
+static bool mirc_read_hex(const char **p, uint32_t *color) {
+    uint32_t value = 0;
+    for (int i = 0; i < 6; i++) {
+        char c = (*p)[i];
+        if (!isxdigit((unsigned char)c)) return false;
+        value = (value << 4) | (uint32_t)(isdigit((unsigned char)c) ? c - '0' : (tolower((unsigned char)c) - 'a' + 10));
+    }
+    *p += 6;
+    *color = COLOR_RGB | value;
+    return true;
+}
+
+/* Color mIRC numérico a la codificación de screen.h */
+static uint32_t mirc_color(int n) {
+    return n < 99 ? COLOR_PALETTE(mirc_palette[n]) : COLOR_DEFAULT;
+}
+
+/* Convertir códigos de formato mIRC a ANSI
  * Soporta:
- * - ^C (0x03) + números para colores
- * - ^B (0x02) para negrita
- * - ^U (0x1F) para subrayado
- * - ^R (0x0F) para reset
+ * - ^C (0x03) NN[,NN] colores 0-98 de texto y fondo (99 = por defecto)
+ * - ^D (0x04) RRGGBB[,RRGGBB] color hexadecimal
+ * - ^B (0x02) negrita, ^] (0x1D) cursiva, ^_ (0x1F) subrayado,
+ *   ^^ (0x1E) tachado, ^V (0x16) inverso (alternan)
+ * - ^Q (0x11) monoespaciado (se descarta: el terminal ya lo es)
+ * - ^O (0x0F) reset
+ * Cada código emite solo lo que cambia y los códigos seguidos comparten una
+ * sola secuencia SGR. Los colores salen como paleta de 256 o color directo;
+ * el modelo de pantalla los adapta a lo que acepte el terminal.
+ * La salida se trunca solo entre elementos completos. Devuelve los bytes que
+ * ocupa la conversión completa (como snprintf): si es >= dest_size, no cupo.
  */
-void convert_mirc_to_ansi(char *dest, const char *src, size_t dest_size) {
-    if (!dest || !src || dest_size == 0) return;
-
-    size_t j = 0;
-    for (size_t i = 0; src[i] && j < dest_size - 50; i++) {  /* -50 para espacio de códigos ANSI */
-        /* Color code: ^C */
-        if (src[i] == 0x03) {
-            i++;
-            if (isdigit((unsigned char)src[i])) {
-                int fg = src[i] - '0';
-                i++;
-                if (isdigit((unsigned char)src[i])) {
-                    fg = fg * 10 + (src[i] - '0');
-                    i++;
+size_t convert_mirc_to_ansi(char *dest, const char *src, size_t dest_size) {
+    if (!dest || !src || dest_size == 0) return 0;
+
+    /* La salida se lleva en variables locales para que el compilador no
+     * tenga que releerla tras cada byte escrito */
+    char *d = dest;
+    char *end = dest + dest_size - 1;   /* Hueco del '\0' */
+    size_t lost = 0;                    /* Bytes que no cupieron: ya no se escribe nada */
+    size_t sgr_end = SIZE_MAX;          /* Dónde acaba la última secuencia SGR */
+
+    MircStyle style = { 0, COLOR_DEFAULT, COLOR_DEFAULT };
+
+    const char *p = src;
+    const char *src_end = src + strlen(src);
+    for (;;) {
+        int code = mirc_codes[(unsigned char)*p];
+
+        if (code == MIRC_TEXT) {
+            /* Tramo de texto sin códigos: se copia mientras se recorre, de
+             * 8 en 8 bytes mientras ninguno sea menor que 0x20 (los códigos
+             * lo son todos) y byte a byte el resto */
+            const char *run = p;
+            if (lost == 0) {
+                while (src_end - p >= 8 && end - d >= 8) {
+                    uint64_t word;
+                    memcpy(&word, p, 8);
+                    if ((word - 0x2020202020202020ull) & ~word & 0x8080808080808080ull) break;
+                    memcpy(d, &word, 8);
+                    p += 8;
+                    d += 8;
                 }
-
-                /* Aplicar color foreground */
-                const char *color = mirc_color_to_ansi(fg);
-                while (*color && j < dest_size - 1) {
-                    dest[j++] = *color++;
+                while (d < end && mirc_codes[(unsigned char)*p] == MIRC_TEXT) *d++ = *p++;
+            }
+            if (mirc_codes[(unsigned char)*p] == MIRC_TEXT) {
+                /* No cabe: cortar entre caracteres UTF-8 y contar el resto */
+                if (lost == 0) {
+                    while (p > run && ((unsigned char)*p & 0xC0) == 0x80) {
+                        p--;
+                        d--;
+                    }
                 }
+                const char *rest = p;
+                while (mirc_codes[(unsigned char)*p] == MIRC_TEXT) p++;
+                lost += (size_t)(p - rest);
+            }
+            continue;
+        }
+
+        if (code == MIRC_END) break;
+        p++;
+
+        /* Cada código añade sus parámetros (";1", ";31"...) solo si cambian
+         * algo. Los códigos seguidos comparten secuencia: si la salida acaba
+         * en la anterior, el ';' del primer parámetro sustituye a su 'm'.
+         * Con sitio de sobra se escriben directamente en dest. */
+        bool joined = (size_t)(d - dest) + lost == sgr_end;
+        bool direct = lost == 0 && (size_t)(end - d) >= MIRC_SGR_MAX;
+        char tmp[MIRC_SGR_MAX];
+        char *params = !direct ? tmp : joined ? d - 1 : d + 1;
+        int len = 0;
+
+        switch (code) {
+            case MIRC_BOLD:
+            case MIRC_ITALIC:
+            case MIRC_UNDERLINE:
+            case MIRC_STRIKE:
+            case MIRC_REVERSE: {
+                style.attrs ^= mirc_attrs[code].attr;
+                bool on = style.attrs & mirc_attrs[code].attr;
+                memcpy(params, on ? mirc_attrs[code].on : mirc_attrs[code].off, 4);
+                len = on ? 2 : 3;
+                break;
+            }
 
-                /* Verificar si hay color de fondo (,NN) */
-                if (src[i] == ',' && isdigit((unsigned char)src[i+1])) {
-                    i++;  /* Saltar coma */
-                    i++;  /* Por ahora ignoramos color de fondo */
-                    if (isdigit((unsigned char)src[i])) {
-                        i++;
+            case MIRC_COLOR:
+            case MIRC_HEX_COLOR: {
+                uint32_t fg = COLOR_DEFAULT;
+                uint32_t bg = style.bg;
+                if (code == MIRC_COLOR) {
+                    int n = mirc_read_number(&p, 2);
+                    if (n < 0) {
+                        /* ^C sin número: colores por defecto */
+                        bg = COLOR_DEFAULT;
+                    } else {
+                        fg = mirc_color(n);
+                        if (p[0] == ',' && (unsigned)(p[1] - '0') < 10) {
+                            p++;
+                            bg = mirc_color(mirc_read_number(&p, 2));
+                        }
                     }
+                } else if (mirc_read_hex(&p, &fg)) {
+                    const char *q = p + 1;
+                    if (p[0] == ',' && mirc_read_hex(&q, &bg)) p = q;
+                } else {
+                    fg = COLOR_DEFAULT;
+                    bg = COLOR_DEFAULT;
                 }
-                i--;  /* Ajustar porque el for hará i++ */
-            } else {
-                /* ^C sin número = reset color */
-                const char *reset = "\033[0m";
-                while (*reset && j < dest_size - 1) {
-                    dest[j++] = *reset++;
-                }
-                i--;
+                if (fg != style.fg) len += mirc_color_params(params + len, fg, false);
+                if (bg != style.bg) len += mirc_color_params(params + len, bg, true);
+                style.fg = fg;
+                style.bg = bg;
+                break;
             }
-        }
-        /* Bold: ^B */
-        else if (src[i] == 0x02) {
-            const char *bold = "\033[1m";
-            while (*bold && j < dest_size - 1) {
-                dest[j++] = *bold++;
+
+            case MIRC_RESET:
+                if (style.attrs == 0 && style.fg == COLOR_DEFAULT && style.bg == COLOR_DEFAULT) continue;
+                style.attrs = 0;
+                style.fg = COLOR_DEFAULT;
+                style.bg = COLOR_DEFAULT;
+                memcpy(params, ";0", 2);
+                len = 2;
+                break;
+
+            case MIRC_ESCAPE: {
+                /* Secuencia ANSI ya presente en el mensaje: copiarla tal cual */
+                const char *seq = p - 1;
+                if (*p == '[') {
+                    p++;
+                    while (*p && (*p < 0x40 || *p > 0x7E)) p++;
+                    if (*p) p++;
+                }
+                size_t n = (size_t)(p - seq);
+                if (lost == 0 && n <= (size_t)(end - d)) {
+                    memcpy(d, seq, n);
+                    d += n;
+                } else {
+                    lost += n;
+                }
+
+                /* A partir de aquí no se sabe qué colores tiene el terminal:
+                 * el siguiente código de color los fija siempre (los de
+                 * atributos ya emiten el valor, no la alternancia) */
+                style.fg = MIRC_COLOR_UNKNOWN;
+                style.bg = MIRC_COLOR_UNKNOWN;
+                continue;
             }
+
+            case MIRC_MONOSPACE:
+            default:
+                continue;
         }
-        /* Underline: ^U o ^_ */
-        else if (src[i] == 0x1F) {
-            const char *underline = "\033[4m";
-            while (*underline && j < dest_size - 1) {
-                dest[j++] = *underline++;
+        if (len == 0) continue;
+
+        if (direct) {
+            if (!joined) {
+                d[0] = '\033';
+                d[1] = '[';
             }
-        }
-        /* Reset: ^R o ^O */
-        else if (src[i] == 0x0F) {
-            const char *reset = "\033[0m";
-            while (*reset && j < dest_size - 1) {
-                dest[j++] = *reset++;
+            d += joined ? len - 1 : len + 1;
+            *d++ = 'm';
+        } else {
+            /* Sin sitio seguro: copiarlos si caben, si no contarlos */
+            if (joined) {
+                if (lost > 0) lost--;
+                else d--;
             }
-        }
-        /* Reverse: ^V */
-        else if (src[i] == 0x16) {
-            const char *reverse = "\033[7m";
-            while (*reverse && j < dest_size - 1) {
-                dest[j++] = *reverse++;
+            size_t n = joined ? (size_t)len + 1 : (size_t)len + 2;
+            if (lost == 0 && n <= (size_t)(end - d)) {
+                if (!joined) {
+                    *d++ = '\033';
+                    *d++ = '[';
+                }
+                for (int i = joined ? 0 : 1; i < len; i++) *d++ = tmp[i];
+                *d++ = 'm';
+            } else {
+                lost += n;
             }
         }
-        /* Carácter normal */
-        else {
-            dest[j++] = src[i];
-        }
+        sgr_end = (size_t)(d - dest) + lost;
     }
-    dest[j] = '\0';
+
+    *d = '\0';
+    return (size_t)(d - dest) + lost;
 }
 
 /* Función para matching de wildcards (* y ?) */
@@ -673,66 +1538,242 @@ static bool wildcard_match(const char *pattern, const char *text) {
     return *p == '\0';
 }
 
-/* Añadir canal a la lista */
-void window_add_channel_to_list(Window *win, const char *name, int users, const char *topic) {
-    if (!win || win->type != WIN_LIST || !name) return;
-
-    ChannelListItem *item = malloc(sizeof(ChannelListItem));
-    if (!item) return;
+/* Crear un item con el topic justo a medida */
+static ChannelListItem* channel_item_create(const char *name, int users, const char *topic) {
+    if (!topic) topic = "";
+    size_t topic_len = strlen(topic);
+    ChannelListItem *item = malloc(sizeof(ChannelListItem) + topic_len + 1);
+    if (!item) return NULL;
 
     strncpy(item->name, name, MAX_CHANNEL_LEN - 1);
     item->name[MAX_CHANNEL_LEN - 1] = '\0';
     item->user_count = users;
-    strncpy(item->topic, topic ? topic : "", sizeof(item->topic) - 1);
-    item->topic[sizeof(item->topic) - 1] = '\0';
-    item->next = win->channel_list;
+    memcpy(item->topic, topic, topic_len + 1);
+    return item;
+}
+
+/* Comparadores para qsort (sobre ChannelListItem *); los empates se
+ * deshacen por nombre para que el orden no dependa del de llegada */
+static int compare_channel_name(const void *a, const void *b) {
+    const ChannelListItem *ca = *(ChannelListItem *const *)a;
+    const ChannelListItem *cb = *(ChannelListItem *const *)b;
+    int cmp = strcasecmp(ca->name, cb->name);
+    return cmp ? cmp : strcmp(ca->name, cb->name);
+}
 
-    win->channel_list = item;
+static int compare_channel_users(const void *a, const void *b) {
+    const ChannelListItem *ca = *(ChannelListItem *const *)a;
+    const ChannelListItem *cb = *(ChannelListItem *const *)b;
+    if (ca->user_count != cb->user_count) return (ca->user_count < cb->user_count) - (ca->user_count > cb->user_count);
+    return compare_channel_name(a, b);
+}
+
+static int compare_channel_topic(const void *a, const void *b) {
+    const ChannelListItem *ca = *(ChannelListItem *const *)a;
+    const ChannelListItem *cb = *(ChannelListItem *const *)b;
+    int cmp = strcasecmp(ca->topic, cb->topic);
+    return cmp ? cmp : compare_channel_name(a, b);
+}
+
+static int (*channel_comparator(ListSort sort))(const void *, const void *) {
+    switch (sort) {
+        case LIST_SORT_NAME: return compare_channel_name;
+        case LIST_SORT_TOPIC: return compare_channel_topic;
+        default: return compare_channel_users;
+    }
+}
+
+/* Montículo con num y order: la raíz es el canal que iría el último de los
+ * guardados, el primero en salir cuando llega uno que va antes */
+static void list_top_sift_down(ChannelListItem **heap, int count, int i, int (*cmp)(const void *, const void *)) {
+    for (;;) {
+        int last = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < count && cmp(&heap[left], &heap[last]) > 0) last = left;
+        if (right < count && cmp(&heap[right], &heap[last]) > 0) last = right;
+        if (last == i) return;
+
+        ChannelListItem *tmp = heap[i];
+        heap[i] = heap[last];
+        heap[last] = tmp;
+        i = last;
+    }
+}
+
+static void list_top_sift_up(ChannelListItem **heap, int i, int (*cmp)(const void *, const void *)) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (cmp(&heap[parent], &heap[i]) >= 0) return;
+
+        ChannelListItem *tmp = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = tmp;
+        i = parent;
+    }
+}
+
+/* Añadir canal a la lista
+ * Los filtros (usuarios y patrón) se aplican al llegar cada 322, así solo se
+ * reserva memoria para los canales que se van a mostrar. Con num y order se
+ * guardan solo los list_limit primeros según el orden; con num sin order,
+ * los primeros list_limit que lleguen.
+ */
+void window_add_channel_to_list(Window *win, const char *name, int users, const char *topic) {
+    if (!win || win->type != WIN_LIST || !name) return;
+
+    win->list_received++;
+    win->redraw |= REDRAW_TITLE;    /* Contador de progreso */
+
+    if (win->list_min_users > 0 && users < win->list_min_users) return;
+    if (win->list_max_users > 0 && users > win->list_max_users) return;
+    if (win->list_filter[0] != '\0' && !wildcard_match(win->list_filter, name)) return;
+    win->list_matched++;
+
+    bool top = win->list_sort != LIST_SORT_NONE && win->list_limit > 0;
+    if (!top && win->list_limit > 0 && win->channel_count >= win->list_limit) return;
+
+    /* Montículo lleno: el nuevo solo entra si va antes que la raíz */
+    if (top && win->channel_count == win->list_limit) {
+        if (win->list_sort == LIST_SORT_USERS && users < win->channel_list[0]->user_count) return;
+
+        int (*cmp)(const void *, const void *) = channel_comparator(win->list_sort);
+        ChannelListItem *item = channel_item_create(name, users, topic);
+        if (!item) return;
+        if (cmp(&item, &win->channel_list[0]) >= 0) {
+            free(item);
+            return;
+        }
+        free(win->channel_list[0]);
+        win->channel_list[0] = item;
+        list_top_sift_down(win->channel_list, win->channel_count, 0, cmp);
+        return;
+    }
+
+    if (win->channel_count == win->channel_capacity) {
+        int capacity = win->channel_capacity ? win->channel_capacity * 2 : 256;
+        if (top && capacity > win->list_limit) capacity = win->list_limit;
+        ChannelListItem **list = realloc(win->channel_list, sizeof(ChannelListItem *) * capacity);
+        if (!list) return;
+        win->channel_list = list;
+        win->channel_capacity = capacity;
+    }
+
+    ChannelListItem *item = channel_item_create(name, users, topic);
+    if (!item) return;
+
+    win->channel_list[win->channel_count] = item;
+    if (top) {
+        list_top_sift_up(win->channel_list, win->channel_count, channel_comparator(win->list_sort));
+    }
     win->channel_count++;
 }
 
+/* Guardar un canal en la caché (todos los que llegan, sin filtros) */
+static void list_cache_add(Window *win, const char *name, int users, const char *topic) {
+    if (win->list_cache_count == win->list_cache_capacity) {
+        int capacity = win->list_cache_capacity ? win->list_cache_capacity * 2 : 256;
+        ChannelListItem **cache = realloc(win->list_cache, sizeof(ChannelListItem *) * capacity);
+        if (!cache) return;
+        win->list_cache = cache;
+        win->list_cache_capacity = capacity;
+    }
+
+    ChannelListItem *item = channel_item_create(name, users, topic);
+    if (!item) return;
+    win->list_cache[win->list_cache_count++] = item;
+}
+
+/* Añadir una respuesta 322 (:server 322 nick #canal usuarios :topic)
+ * Va a la caché si el LIST en curso la está llenando y a la vista si se
+ * está esperando la lista */
+void window_add_list_reply(Window *win, const char *line) {
+    if (!win || !line) return;
+
+    size_t line_bytes = strlen(line) + 2;
+    if (win->list_receiving) win->list_bytes += line_bytes;
+    if (win->list_caching) win->list_cache_bytes += line_bytes;
+
+    /* Saltar :server 322 nick */
+    const char *ptr = line;
+    for (int i = 0; i < 3 && ptr; i++) {
+        ptr = strchr(ptr, ' ');
+        if (ptr) ptr++;
+    }
+    if (!ptr) return;
+
+    char channel[MAX_CHANNEL_LEN];
+    int users = 0;
+    if (sscanf(ptr, "%63s %d", channel, &users) != 2) return;
+
+    /* Topic después de " :" (sin \r\n) */
+    char topic[512] = "";
+    const char *topic_ptr = strstr(ptr, " :");
+    if (topic_ptr) {
+        topic_ptr += 2;
+        size_t len = strcspn(topic_ptr, "\r\n");
+        if (len >= sizeof(topic)) len = sizeof(topic) - 1;
+        memcpy(topic, topic_ptr, len);
+        topic[len] = '\0';
+    }
+
+    if (win->list_caching) list_cache_add(win, channel, users, topic);
+    if (win->list_receiving) window_add_channel_to_list(win, channel, users, topic);
+}
+
+/* Volver a pasar por los filtros actuales los canales de la caché (completa
+ * o lo que haya llegado del LIST en curso) */
+void window_replay_list_cache(Window *win) {
+    if (!win || win->type != WIN_LIST) return;
+
+    for (int i = 0; i < win->list_cache_count; i++) {
+        const ChannelListItem *item = win->list_cache[i];
+        window_add_channel_to_list(win, item->name, item->user_count, item->topic);
+    }
+    win->list_bytes = win->list_caching ? win->list_cache_bytes : 0;
+    win->list_from_cache = !win->list_caching;
+}
+
+/* Vaciar la caché de LIST */
+void window_clear_list_cache(Window *win) {
+    if (!win || win->type != WIN_LIST) return;
+
+    for (int i = 0; i < win->list_cache_count; i++) {
+        free(win->list_cache[i]);
+    }
+    free(win->list_cache);
+
+    win->list_cache = NULL;
+    win->list_cache_count = 0;
+    win->list_cache_capacity = 0;
+    win->list_cache_bytes = 0;
+    win->list_cache_time = 0;
+    win->list_caching = false;
+}
+
 /* Limpiar lista de canales */
 void window_clear_channel_list(Window *win) {
     if (!win || win->type != WIN_LIST) return;
 
-    ChannelListItem *current = win->channel_list;
-    while (current) {
-        ChannelListItem *next = current->next;
-        free(current);
-        current = next;
+    for (int i = 0; i < win->channel_count; i++) {
+        free(win->channel_list[i]);
     }
+    free(win->channel_list);
 
     win->channel_list = NULL;
     win->channel_count = 0;
+    win->channel_capacity = 0;
+    win->list_received = 0;
+    win->list_matched = 0;
+    win->list_bytes = 0;
+    win->list_from_cache = false;
 }
 
-/* Ordenar lista de canales por número de usuarios (mayor a menor) */
+/* Ordenar la lista de canales según list_sort (qsort, O(n log n)) */
 void window_sort_channel_list(Window *win) {
-    if (!win || win->type != WIN_LIST || !win->channel_list) return;
-
-    /* Bubble sort simple - suficiente para listas de canales */
-    bool swapped;
-    do {
-        swapped = false;
-        ChannelListItem **ptr = &win->channel_list;
-
-        while (*ptr && (*ptr)->next) {
-            ChannelListItem *current = *ptr;
-            ChannelListItem *next = current->next;
-
-            if (current->user_count < next->user_count) {
-                /* Swap */
-                current->next = next->next;
-                next->next = current;
-                *ptr = next;
-                swapped = true;
-            }
-
-            ptr = &((*ptr)->next);
-        }
-    } while (swapped);
+    if (!win || win->type != WIN_LIST || win->channel_count < 2 || win->list_sort == LIST_SORT_NONE) return;
 
-    win->list_ordered = true;
+    qsort(win->channel_list, win->channel_count, sizeof(ChannelListItem *), channel_comparator(win->list_sort));
 }
 
 /* Filtrar lista de canales según patrón con wildcards */
@@ -748,106 +1789,27 @@ void window_filter_channel_list(Window *win, const char *filter) {
 void window_finalize_channel_list(Window *win) {
     if (!win || win->type != WIN_LIST) return;
 
-    win->list_receiving = false;
-
-    /* Aplicar filtro por rango de usuarios si existe */
-    if (win->list_min_users > 0 || win->list_max_users > 0) {
-        ChannelListItem **ptr = &win->channel_list;
-        int count = 0;
-
-        while (*ptr) {
-            bool keep = true;
-
-            /* Verificar mínimo de usuarios */
-            if (win->list_min_users > 0 && (*ptr)->user_count < win->list_min_users) {
-                keep = false;
-            }
-
-            /* Verificar máximo de usuarios */
-            if (win->list_max_users > 0 && (*ptr)->user_count > win->list_max_users) {
-                keep = false;
-            }
-
-            if (!keep) {
-                /* No cumple el rango, eliminar */
-                ChannelListItem *to_remove = *ptr;
-                *ptr = (*ptr)->next;
-                free(to_remove);
-            } else {
-                /* Cumple el rango, mantener */
-                ptr = &((*ptr)->next);
-                count++;
-            }
-        }
-
-        win->channel_count = count;
+    /* 323 de un LIST que llenaba la caché: ya está completa */
+    if (win->list_caching) {
+        win->list_caching = false;
+        win->list_cache_time = time(NULL);
     }
+    if (!win->list_receiving) return;
 
-    /* Aplicar filtro si existe */
-    if (win->list_filter[0] != '\0') {
-        ChannelListItem **ptr = &win->channel_list;
-        int count = 0;
-
-        while (*ptr) {
-            if (!wildcard_match(win->list_filter, (*ptr)->name)) {
-                /* No coincide, eliminar */
-                ChannelListItem *to_remove = *ptr;
-                *ptr = (*ptr)->next;
-                free(to_remove);
-            } else {
-                /* Coincide, mantener */
-                ptr = &((*ptr)->next);
-                count++;
-            }
-        }
-
-        win->channel_count = count;
-    }
-
-    /* Ordenar si se solicitó */
-    if (win->list_ordered) {
-        window_sort_channel_list(win);
-    }
-
-    /* Aplicar límite si se especificó - DESPUÉS de ordenar para obtener el top N */
-    if (win->list_limit > 0 && win->channel_count > win->list_limit) {
-        ChannelListItem *item = win->channel_list;
-        int count = 0;
-
-        /* Avanzar hasta el límite */
-        while (item && count < win->list_limit) {
-            item = item->next;
-            count++;
-        }
-
-        /* Liberar el resto de elementos */
-        if (item) {
-            /* Cortar la lista */
-            ChannelListItem *prev = win->channel_list;
-            for (int i = 0; i < win->list_limit - 1 && prev; i++) {
-                prev = prev->next;
-            }
-            if (prev) {
-                prev->next = NULL;
-            }
-
-            /* Liberar elementos sobrantes */
-            while (item) {
-                ChannelListItem *to_free = item;
-                item = item->next;
-                free(to_free);
-            }
+    win->list_receiving = false;
+    win->redraw |= REDRAW_MESSAGES | REDRAW_TITLE;
 
-            win->channel_count = win->list_limit;
-        }
-    }
+    /* Los filtros y el límite ya se aplicaron al llegar cada canal; queda
+     * ordenar (con num, solo los num del montículo) */
+    window_sort_channel_list(win);
 
     /* Mostrar resumen en el buffer */
     char msg[MAX_MSG_LEN];
     snprintf(msg, sizeof(msg), ANSI_BOLD ANSI_CYAN "=== Lista de canales completada ===" ANSI_RESET);
     buffer_add_message(win->buffer, msg);
 
-    snprintf(msg, sizeof(msg), ANSI_GREEN "Total: %d canales" ANSI_RESET, win->channel_count);
+    snprintf(msg, sizeof(msg), ANSI_GREEN "Total: %d canales" ANSI_RESET " (%d coinciden de %d recibidos)",
+             win->channel_count, win->list_matched, win->list_received);
     buffer_add_message(win->buffer, msg);
 
     if (win->list_filter[0] != '\0') {
@@ -855,8 +1817,10 @@ void window_finalize_channel_list(Window *win) {
         buffer_add_message(win->buffer, msg);
     }
 
-    if (win->list_ordered) {
-        snprintf(msg, sizeof(msg), ANSI_YELLOW "Ordenado por usuarios (mayor a menor)" ANSI_RESET);
+    if (win->list_sort != LIST_SORT_NONE) {
+        const char *order = win->list_sort == LIST_SORT_NAME ? "nombre" :
+                            win->list_sort == LIST_SORT_TOPIC ? "topic" : "usuarios (mayor a menor)";
+        snprintf(msg, sizeof(msg), ANSI_YELLOW "Ordenado por %s" ANSI_RESET, order);
         buffer_add_message(win->buffer, msg);
     }
 
@@ -876,14 +1840,31 @@ void window_finalize_channel_list(Window *win) {
         buffer_add_message(win->buffer, msg);
     }
 
+    /* Tráfico de la respuesta; con ELIST se estima lo que se ha ahorrado con
+     * el tamaño medio de cada 322 y el total de canales de la red */
+    if (win->list_from_cache) {
+        snprintf(msg, sizeof(msg), ANSI_GRAY "Sin tráfico: desde la caché de hace %lds (la descarga ocupó %lu bytes; /list refresh la actualiza)" ANSI_RESET,
+                 (long)(time(NULL) - win->list_cache_time), win->list_cache_bytes);
+    } else if (win->list_server_filtered && win->list_received > 0 && win->list_server_total > win->list_received) {
+        unsigned long saved = win->list_bytes / win->list_received *
+                              (unsigned long)(win->list_server_total - win->list_received);
+        snprintf(msg, sizeof(msg), ANSI_GRAY "Recibidos %lu bytes; el filtro en el servidor ahorró ~%lu bytes (%d canales no enviados)" ANSI_RESET,
+                 win->list_bytes, saved, win->list_server_total - win->list_received);
+    } else if (win->list_server_filtered) {
+        snprintf(msg, sizeof(msg), ANSI_GRAY "Recibidos %lu bytes (filtrado en el servidor)" ANSI_RESET, win->list_bytes);
+    } else {
+        snprintf(msg, sizeof(msg), ANSI_GRAY "Recibidos %lu bytes" ANSI_RESET, win->list_bytes);
+    }
+    buffer_add_message(win->buffer, msg);
+
     buffer_add_message(win->buffer, "");
 
     /* Añadir canales al buffer - limitar a 500 para no saturar la memoria */
-    ChannelListItem *item = win->channel_list;
     int displayed = 0;
     int max_display = 500;
 
-    while (item && displayed < max_display) {
+    while (displayed < win->channel_count && displayed < max_display) {
+        const ChannelListItem *item = win->channel_list[displayed];
         /* Truncar topic si es muy largo para que quepa en una línea */
         char truncated_topic[256];
         /* Calcular espacio: nombre_canal + " [" + num_usuarios + "] " ≈ 30 chars */
@@ -901,11 +1882,10 @@ void window_finalize_channel_list(Window *win) {
         snprintf(msg, sizeof(msg), ANSI_CYAN "%s" ANSI_RESET " [" ANSI_GREEN "%d" ANSI_RESET "] %s",
                  item->name, item->user_count, truncated_topic);
         buffer_add_message(win->buffer, msg);
-        item = item->next;
         displayed++;
     }
 
-    if (displayed >= max_display && item) {
+    if (displayed < win->channel_count) {
         snprintf(msg, sizeof(msg), ANSI_YELLOW "... y %d canales más (usa /list con filtros o límite)" ANSI_RESET,
                  win->channel_count - displayed);
         buffer_add_message(win->buffer, msg);
@@ -4,6 +4,23 @@
 #include "common.h"
 #include "buffer.h"
 
+/* Regiones de la pantalla para el redibujado incremental */
+#define REDRAW_MESSAGES 0x01    /* Área de mensajes */
+#define REDRAW_USERS    0x02    /* Lista de usuarios */
+#define REDRAW_TITLE    0x04    /* Título y topic */
+#define REDRAW_PROMPT   0x08    /* Línea de entrada */
+#define REDRAW_STATUS   0x10    /* Indicadores de actividad */
+#define REDRAW_ALL      0x1F
+#define REDRAW_WINDOW   (REDRAW_MESSAGES | REDRAW_USERS | REDRAW_TITLE)  /* Todo un panel */
+
+/* Nivel de actividad de una ventana de fondo (mayor = más importante) */
+typedef enum {
+    ACTIVITY_NONE,
+    ACTIVITY_MESSAGE,           /* Mensajes sin leer */
+    ACTIVITY_PRIVATE,           /* Privado nuevo o con mensajes sin leer */
+    ACTIVITY_HIGHLIGHT          /* Mención del nick */
+} ActivityLevel;
+
 /* Lista de usuarios en un canal */
 typedef struct UserNode {
     char nick[MAX_NICK_LEN];
@@ -12,13 +29,29 @@ typedef struct UserNode {
 } UserNode;
 
 /* Item de lista de canales para ventana LIST */
-typedef struct ChannelListItem {
+typedef struct {
     char name[MAX_CHANNEL_LEN];
     int user_count;
-    char topic[512];
-    struct ChannelListItem *next;
+    char topic[];                   /* Reservado a medida con el item */
 } ChannelListItem;
 
+/* Orden de la lista de canales (/list order [users|name|topic]) */
+typedef enum {
+    LIST_SORT_NONE,                 /* Orden de llegada */
+    LIST_SORT_USERS,                /* Usuarios, de mayor a menor */
+    LIST_SORT_NAME,
+    LIST_SORT_TOPIC
+} ListSort;
+
+/* Búsqueda activa en el scrollback (/search) */
+typedef struct {
+    bool active;
+    char pattern[256];
+    bool use_regex;
+    regex_t regex;              /* Compilada solo si use_regex */
+    int line;                   /* Índice global de la coincidencia actual (-1 = ninguna) */
+} SearchState;
+
 /* Estructura de ventana */
 typedef struct {
     int id;
@@ -31,25 +64,61 @@ typedef struct {
     char topic[512];            /* Topic del canal (solo para WIN_CHANNEL) */
     bool has_unread;            /* Tiene mensajes sin leer */
     bool is_new;                /* Es una ventana nueva sin visitar */
-    FILE *log_file;             /* Archivo de log si logging está habilitado */
+    int unread_count;           /* Mensajes recibidos mientras no se veía */
+    int highlight_count;        /* Menciones entre ellos */
+    ActivityLevel activity;     /* Prioridad en la cola de actividad */
+    unsigned long activity_seq; /* Orden en que alcanzó ese nivel */
+    int activity_slot;          /* Posición en la cola de actividad (-1 = fuera) */
+    int log_id;                 /* Log abierto en el logger (-1 = sin log) */
     bool log_enabled;           /* Indica si el logging está habilitado para esta ventana */
-    int last_log_day;           /* Último día en que se escribió al log (día del mes) */
     /* Campos para ventana LIST */
-    ChannelListItem *channel_list;  /* Lista de canales (solo para WIN_LIST) */
+    ChannelListItem **channel_list; /* Canales (solo para WIN_LIST); con num y order, un montículo hasta 323 */
     int channel_count;              /* Número de canales en la lista */
+    int channel_capacity;
+    int list_received;              /* Respuestas 322 recibidas */
+    int list_matched;               /* Canales que pasan los filtros */
     bool list_receiving;            /* Indica si está recibiendo datos de LIST */
-    bool list_ordered;              /* Indica si la lista está ordenada */
+    unsigned long list_bytes;       /* Bytes de las respuestas 322 (con \r\n) */
+    bool list_server_filtered;      /* El servidor ya aplicó usuarios o máscara (ELIST) */
+    int list_server_total;          /* Canales en la red (254) para estimar el ahorro, 0 = no se sabe */
+    ChannelListItem **list_cache;   /* Último LIST completo (sin filtrar en el servidor) */
+    int list_cache_count;
+    int list_cache_capacity;
+    unsigned long list_cache_bytes; /* Bytes que ocupó su descarga */
+    time_t list_cache_time;         /* Cuándo llegó el 323 (0 = no hay caché completa) */
+    unsigned int list_cache_session;/* Conexión de la que viene (IRCConnection.session) */
+    bool list_caching;              /* El LIST en curso está llenando la caché */
+    bool list_from_cache;           /* La vista actual sale de la caché, sin tráfico */
+    ListSort list_sort;             /* Orden pedido */
     char list_filter[256];          /* Filtro de búsqueda (con wildcards) */
     int list_limit;                 /* Límite de resultados (0 = sin límite) */
     int list_min_users;             /* Filtro mínimo de usuarios (0 = sin mínimo) */
     int list_max_users;             /* Filtro máximo de usuarios (0 = sin máximo) */
+    SearchState search;             /* Búsqueda en el scrollback */
+    unsigned redraw;                /* Regiones que cambiaron (REDRAW_*) */
 } Window;
 
-/* Gestor de ventanas */
+/* Gestor de ventanas
+ * La pantalla se reparte en pane_count paneles; cada uno muestra una ventana
+ * (o ninguna, -1). active_window es siempre la del panel activo.
+ * Las ventanas de fondo con actividad forman una cola de prioridad (montículo
+ * por nivel y antigüedad) y los contadores globales se mantienen al marcar y
+ * al visitar ventanas, sin recorrerlas.
+ */
 typedef struct {
     Window *windows[MAX_WINDOWS];
     int active_window;
     int window_count;
+    unsigned redraw;                /* Regiones a redibujar por cambios globales */
+    SplitMode split;                /* Disposición de los paneles */
+    int panes[MAX_PANES];           /* Ventana mostrada en cada panel (-1 = vacío) */
+    int pane_count;
+    int active_pane;
+    int activity_heap[MAX_WINDOWS]; /* Ventanas con actividad (la más importante primero) */
+    int activity_count;
+    unsigned long activity_clock;
+    int new_privates;               /* Privados nuevos sin visitar */
+    int unread_windows;             /* Ventanas con mensajes sin leer (no nuevas) */
 } WindowManager;
 
 /* Funciones de gestión de ventanas */
@@ -63,17 +132,37 @@ Window* wm_get_active_window(WindowManager *wm);
 void wm_add_message(WindowManager *wm, int window_id, const char *msg);
 void wm_add_message_to_active(WindowManager *wm, const char *msg);
 void wm_add_message_with_timestamp(WindowManager *wm, int window_id, const char *msg, bool add_timestamp, const char *format);
-void wm_mark_window_activity(WindowManager *wm, int window_id);
+void wm_mark_window_activity(WindowManager *wm, int window_id, bool highlight);
+void wm_clear_all_activity(WindowManager *wm);
+int wm_next_activity(WindowManager *wm);
+int wm_activity_windows(WindowManager *wm, int ids[MAX_WINDOWS]);
 bool wm_has_new_privates(WindowManager *wm);
 bool wm_has_unread_messages(WindowManager *wm);
+unsigned wm_take_redraw(WindowManager *wm, unsigned pane_regions[MAX_PANES]);
+void wm_compact_buffers(WindowManager *wm, int max_blocks);
+
+/* Funciones de paneles */
+int wm_find_pane(WindowManager *wm, int window_id);
+bool wm_split(WindowManager *wm, SplitMode mode, int window_id);
+void wm_close_pane(WindowManager *wm);
+void wm_unsplit(WindowManager *wm);
+void wm_focus_pane(WindowManager *wm, int pane);
+void wm_focus_next_pane(WindowManager *wm);
+
+/* Funciones de búsqueda */
+bool window_set_search(Window *win, const char *pattern, bool use_regex);
+void window_clear_search(Window *win);
+bool window_search_next(Window *win, int from);
+bool window_highlight_search(Window *win, const char *line, char *dest, size_t size);
 
 /* Funciones de logging */
 void window_open_log(Window *win);
 void window_close_log(Window *win);
 void window_write_log(Window *win, const char *msg);
+int window_preload_log(Window *win, int max_lines);
 
 /* Funciones de conversión de colores */
-void convert_mirc_to_ansi(char *dest, const char *src, size_t dest_size);
+size_t convert_mirc_to_ansi(char *dest, const char *src, size_t dest_size);
 
 /* Funciones para gestión de usuarios en canales */
 void window_add_user(Window *win, const char *nick);
@@ -85,9 +174,12 @@ void window_scroll_users_down(Window *win);
 
 /* Funciones para ventana LIST */
 void window_add_channel_to_list(Window *win, const char *name, int users, const char *topic);
+void window_add_list_reply(Window *win, const char *line);
 void window_clear_channel_list(Window *win);
 void window_sort_channel_list(Window *win);
 void window_filter_channel_list(Window *win, const char *filter);
 void window_finalize_channel_list(Window *win);
+void window_replay_list_cache(Window *win);
+void window_clear_list_cache(Window *win);
 
 #endif /* WINDOWS_H */